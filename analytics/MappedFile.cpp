@@ -0,0 +1,43 @@
+#include "MappedFile.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+bool MappedFile::open(const std::string& path, std::string& error) {
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        error = strerror(errno);
+        return false;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        error = strerror(errno);
+        ::close(fd);
+        return false;
+    }
+    size_ = (size_t)st.st_size;
+    if (size_ > 0) {
+        void* data = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            error = strerror(errno);
+            size_ = 0;
+            ::close(fd);
+            return false;
+        }
+        // Read ahead aggressively; every page is visited once, in order
+        madvise(data, size_, MADV_SEQUENTIAL);
+        data_ = (const char*)data;
+    }
+    ::close(fd);   // The mapping keeps the file open
+    return true;
+}
+
+void MappedFile::close() {
+    if (data_) munmap((void*)data_, size_);
+    data_ = nullptr;
+    size_ = 0;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <stddef.h>
+#include <string>
+
+// Description: A whole file mapped read-only into memory, for one sequential pass.
+class MappedFile {
+public:
+    MappedFile() {}
+    ~MappedFile() { close(); }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // Returns false and sets `error` if the file cannot be opened or mapped. An empty
+    // file maps to an empty range.
+    bool open(const std::string& path, std::string& error);
+    void close();
+
+    const char* begin() const { return data_; }
+    const char* end() const { return data_ + size_; }
+    size_t size() const { return size_; }
+
+private:
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+};
@@ -0,0 +1,91 @@
+#pragma once
+// Parses the "timestamp,value" lines of moisture log exports eight bytes at a time
+// (SWAR: SIMD within a register), which works on any 64-bit host without intrinsics.
+
+#include <stdint.h>
+#include <string.h>
+
+#if !defined(__BYTE_ORDER__) || __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "NumberParser assumes a little-endian host"
+#endif
+
+namespace numberparser {
+
+static const uint64_t ONES = 0x0101010101010101ull;
+
+// Description: Bit mask with the high bit of every byte of `chunk` that is not an ASCII
+// digit set. A byte of 0xFA or more carries into the next one, which can only misreport
+// bytes after a non-digit, so the first non-digit is always found.
+inline uint64_t nonDigits(uint64_t chunk) {
+    uint64_t high = (chunk & (0xF0 * ONES)) ^ (0x30 * ONES);
+    uint64_t over = ((chunk + 0x06 * ONES) & (0xF0 * ONES)) ^ (0x30 * ONES);
+    uint64_t bad = high | over;
+    // Fold each byte's nonzero bits into its high bit
+    return (((bad & (0x7F * ONES)) + 0x7F * ONES) | bad) & (0x80 * ONES);
+}
+
+// Description: Value of eight ASCII digits, the first in the lowest byte. Zero bytes
+// count as leading zeros.
+inline uint32_t eightDigits(uint64_t chunk) {
+    chunk = (chunk & (0x0F * ONES)) * 2561 >> 8;
+    chunk = (chunk & 0x00FF00FF00FF00FFull) * 6553601 >> 16;
+    return (uint32_t)((chunk & 0x0000FFFF0000FFFFull) * 42949672960001ull >> 32);
+}
+
+static const uint64_t POW10[9] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000};
+
+// Description: Parses the unsigned decimal number at `p`, reading no further than `end`.
+// Returns the first byte after it, or nullptr if there is no digit at `p` or the number
+// does not fit 32 bits.
+inline const char* parseUnsigned(const char* p, const char* end, uint32_t& out) {
+    const char* start = p;
+    uint64_t value = 0;
+    while (end - p >= 8) {
+        uint64_t chunk;
+        memcpy(&chunk, p, 8);
+        uint64_t bad = nonDigits(chunk);
+        if (bad == 0) {
+            value = value * 100000000 + eightDigits(chunk);
+            p += 8;
+            if (value > UINT32_MAX) return nullptr;
+            continue;
+        }
+        unsigned n = __builtin_ctzll(bad) / 8;
+        if (n > 0) value = value * POW10[n] + eightDigits(chunk << (8 * (8 - n)));
+        p += n;
+        goto done;
+    }
+    while (p < end && (unsigned)(*p - '0') < 10 && value <= UINT32_MAX) value = value * 10 + (*p++ - '0');
+done:
+    if (p == start || value > UINT32_MAX) return nullptr;
+    out = (uint32_t)value;
+    return p;
+}
+
+}  // namespace numberparser
+
+// Description: Calls fn(timestamp, value) for every "timestamp,value" line in [p, end).
+// Lines may end in LF, CRLF or the CR CR LF that trimLogFile() used to write. Lines that
+// do not parse are skipped and counted in `badLines`; blank lines are ignored.
+template <typename Fn>
+void parseLogLines(const char* p, const char* end, uint64_t& badLines, Fn fn) {
+    while (p < end) {
+        uint32_t timestamp, value;
+        const char* q = numberparser::parseUnsigned(p, end, timestamp);
+        if (q && q < end && *q == ',' && (q = numberparser::parseUnsigned(q + 1, end, value))) {
+            while (q < end && *q == '\r') q++;
+            if (q == end || *q == '\n') {
+                fn(timestamp, value);
+                p = q + 1;
+                continue;
+            }
+        }
+        // Resynchronise on the next line
+        const char* nl = (const char*)memchr(p, '\n', end - p);
+        const char* lineEnd = nl ? nl : end;
+        bool blank = true;
+        for (const char* c = p; c < lineEnd && blank; ++c) blank = *c == '\r' || *c == ' ';
+        if (!blank) badLines++;
+        p = lineEnd + 1;
+    }
+}
@@ -0,0 +1,66 @@
+#include "PlantAnalyzer.h"
+
+void PlantAnalyzer::closeWatering() {
+    if (!watering_) return;
+    waterings_.push_back(open_);
+    watering_ = false;
+}
+
+void PlantAnalyzer::add(uint32_t timestamp, uint32_t value) {
+    if (value == 0 || value >= (uint32_t)ADC_MAX) {
+        dropouts_++;
+        return;
+    }
+    if (accepted_ > 0) {
+        if (timestamp <= last_) {
+            stale_++;
+            return;
+        }
+        if (timestamp - last_ > MAX_GAP_SECONDS) {
+            closeWatering();
+            window_.clear();
+        }
+    } else {
+        first_ = timestamp;
+    }
+    accepted_++;
+    last_ = timestamp;
+    uint16_t reading = (uint16_t)value;
+
+    int32_t day = (int32_t)(((int64_t)timestamp + utcOffset_) / 86400);
+    if (days_.empty() || days_.back().day != day) {
+        DailyRollup rollup = {day, 0, 0, reading, reading, 0};
+        days_.push_back(rollup);
+    }
+    DailyRollup& today = days_.back();
+    today.count++;
+    today.sum += reading;
+    if (reading < today.min) today.min = reading;
+    if (reading > today.max) today.max = reading;
+
+    if (watering_) {
+        if (timestamp - open_.end <= WINDOW_SECONDS) {
+            if (reading < open_.after) {
+                open_.after = reading;
+                open_.end = timestamp;
+            }
+            return;
+        }
+        closeWatering();
+    }
+
+    while (!window_.empty() && window_.front().timestamp + WINDOW_SECONDS < timestamp) window_.pop_front();
+    if (!window_.empty() && window_.front().value - reading >= WATERING_DROP) {
+        open_ = {window_.front().timestamp, timestamp, window_.front().value, reading};
+        watering_ = true;
+        today.waterings++;
+        window_.clear();
+        return;
+    }
+    while (!window_.empty() && window_.back().value <= reading) window_.pop_back();
+    window_.push_back({timestamp, reading});
+}
+
+void PlantAnalyzer::finish() {
+    closeWatering();
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <stdint.h>
+#include <deque>
+#include <vector>
+#include "AlertEngine.h"
+
+// Description: Aggregate of one plant's readings over one calendar day.
+struct DailyRollup {
+    int32_t day;           // Days since the epoch, in the analysis time zone
+    uint32_t count;
+    int64_t sum;
+    uint16_t min;
+    uint16_t max;
+    uint16_t waterings;    // Watering events detected on this day
+};
+
+// Description: A watering, seen as the reading falling by at least WATERING_DROP counts.
+struct WateringEvent {
+    uint32_t start;        // Timestamp of the last dry reading before the drop
+    uint32_t end;          // Timestamp of the wettest reading of the drop
+    uint16_t before;       // Reading at `start`
+    uint16_t after;        // Reading at `end`
+};
+
+// Description: One plant's history, fed in time order, reduced to daily rollups and
+// watering events in a single pass. Readings at the ADC rails are dropped as dropouts,
+// and readings not newer than the last accepted one are dropped as well, so dumps that
+// overlap in time can be fed one after the other.
+//
+// A watering is a reading at least WATERING_DROP counts below the highest reading of
+// the preceding WINDOW_SECONDS, found with a monotonic deque in O(1) amortized time per
+// reading, so it also shows in fast logs where a watering soaks in over many samples.
+// The event lasts while the reading keeps falling; detection resumes afterwards.
+class PlantAnalyzer {
+public:
+    static const uint32_t WINDOW_SECONDS = 3600;
+    static const uint32_t MAX_GAP_SECONDS = AlertEngine::MAX_GAP_SECONDS;   // A longer gap starts over
+    static const int16_t WATERING_DROP = AlertEngine::WATERING_DROP;
+    static const int16_t ADC_MAX = AlertEngine::ADC_MAX;
+
+    // `utcOffsetSeconds` moves day boundaries from UTC midnight to local midnight.
+    explicit PlantAnalyzer(int32_t utcOffsetSeconds = 0) : utcOffset_(utcOffsetSeconds) {}
+
+    void add(uint32_t timestamp, uint32_t value);
+
+    // Closes a watering still in progress; call once after the last reading.
+    void finish();
+
+    const std::vector<DailyRollup>& days() const { return days_; }
+    const std::vector<WateringEvent>& waterings() const { return waterings_; }
+
+    uint64_t accepted() const { return accepted_; }
+    uint64_t dropouts() const { return dropouts_; }
+    uint64_t stale() const { return stale_; }
+    uint32_t firstTimestamp() const { return first_; }
+    uint32_t lastTimestamp() const { return last_; }
+
+private:
+    struct Reading {
+        uint32_t timestamp;
+        uint16_t value;
+    };
+
+    void closeWatering();
+
+    int32_t utcOffset_;
+    std::deque<Reading> window_;   // Values strictly falling from front to back
+    std::vector<DailyRollup> days_;
+    std::vector<WateringEvent> waterings_;
+    WateringEvent open_ = {};
+    bool watering_ = false;
+    uint64_t accepted_ = 0;
+    uint64_t dropouts_ = 0;
+    uint64_t stale_ = 0;
+    uint32_t first_ = 0;
+    uint32_t last_ = 0;
+};
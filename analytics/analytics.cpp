@@ -0,0 +1,417 @@
+// Offline analytics for archived moisture logs: the /data1.csv and /data2.csv files of
+// older firmware and saved /log responses, all "timestamp,value" lines. Files are mapped
+// into memory, parsed eight bytes at a time and analysed per plant on a thread pool.
+// Built by the `analytics` environment:
+//   pio run -e analytics
+//   .pio/build/analytics/program [options] PATH...
+//
+// Each PATH is a log file, or a directory searched recursively for *.csv files. A plant
+// is named by the first directory below the PATH it was found in and the file name
+// without extension, so archive/board-a/2024-05/data1.csv belongs to plant
+// "board-a/data1" when run on archive/. A plant's files are read in the order of their
+// first timestamp; readings already seen in an earlier, overlapping dump are skipped.
+//
+// Options:
+//   --threads N       worker threads (default: one per core)
+//   --utc-offset H    hours to add to UTC for day boundaries (default 0)
+//   --daily FILE      write daily rollups as plant,date,count,min,max,mean,waterings
+//   --events FILE     write watering events as plant,start,end,before,after
+//
+// Synthetic archive, for benchmarks:
+//   --generate DIR    write an archive of synthetic traces to DIR instead, then exit
+//   --boards N        boards, each with two plants (default 50)
+//   --days D          days per plant (default 365)
+//   --interval S      seconds between readings (default 600)
+//   --dump-days D     days per dump file; each dump repeats the last third of the
+//                     previous one, as periodic downloads of a ring buffer do (default 90)
+//   --seed N          trace seed (default 1)
+//
+// Results are JSON lines: one per plant, then the totals:
+//   {"plant":"board-a/data1","files":4,"samples":52560,...,"waterings":48,
+//    "interval_days_p50":7.1,"drying_per_day_p50":190.2,...}
+//   {"files":400,"bytes":1800000000,"lines":105000000,...,"seconds":1.9,"mb_per_s":950.0}
+
+#include <dirent.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+#include "MappedFile.h"
+#include "NumberParser.h"
+#include "PlantAnalyzer.h"
+#include "TraceGenerator.h"
+
+struct Options {
+    unsigned threads = 0;
+    int32_t utcOffset = 0;
+    const char* dailyFile = nullptr;
+    const char* eventsFile = nullptr;
+    std::vector<std::string> paths;
+
+    const char* generateDir = nullptr;
+    uint32_t boards = 50;
+    uint32_t days = 365;
+    uint32_t interval = 600;
+    uint32_t dumpDays = 90;
+    uint32_t seed = 1;
+};
+
+struct LogFile {
+    std::string path;
+    size_t bytes;
+    uint32_t firstTimestamp;
+};
+
+// Description: One plant's files and, once analysed, its results.
+struct Plant {
+    std::string name;
+    std::vector<LogFile> files;
+    size_t bytes = 0;
+
+    uint64_t lines = 0;
+    uint64_t badLines = 0;
+    std::vector<DailyRollup> days;
+    std::vector<WateringEvent> waterings;
+    uint64_t samples = 0;
+    uint64_t dropouts = 0;
+    uint64_t stale = 0;
+    uint32_t first = 0;
+    uint32_t last = 0;
+    std::string error;
+};
+
+static double nowSeconds() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        const char* name = argv[i];
+        if (strncmp(name, "--", 2) != 0) {
+            options.paths.push_back(name);
+            continue;
+        }
+        const char* value = i + 1 < argc ? argv[++i] : nullptr;
+        if (!value) return false;
+        if (strcmp(name, "--threads") == 0) options.threads = strtoul(value, nullptr, 10);
+        else if (strcmp(name, "--utc-offset") == 0) options.utcOffset = (int32_t)(strtod(value, nullptr) * 3600);
+        else if (strcmp(name, "--daily") == 0) options.dailyFile = value;
+        else if (strcmp(name, "--events") == 0) options.eventsFile = value;
+        else if (strcmp(name, "--generate") == 0) options.generateDir = value;
+        else if (strcmp(name, "--boards") == 0) options.boards = strtoul(value, nullptr, 10);
+        else if (strcmp(name, "--days") == 0) options.days = strtoul(value, nullptr, 10);
+        else if (strcmp(name, "--interval") == 0) options.interval = strtoul(value, nullptr, 10);
+        else if (strcmp(name, "--dump-days") == 0) options.dumpDays = strtoul(value, nullptr, 10);
+        else if (strcmp(name, "--seed") == 0) options.seed = strtoul(value, nullptr, 10);
+        else return false;
+    }
+    if (options.generateDir) return options.boards > 0 && options.days > 0 && options.interval > 0 && options.dumpDays > 0;
+    return !options.paths.empty();
+}
+
+static std::string stem(const std::string& path) {
+    size_t slash = path.rfind('/');
+    std::string name = slash == std::string::npos ? path : path.substr(slash + 1);
+    size_t dot = name.rfind('.');
+    return dot == std::string::npos || dot == 0 ? name : name.substr(0, dot);
+}
+
+static bool endsWith(const std::string& s, const char* suffix) {
+    size_t n = strlen(suffix);
+    return s.size() >= n && s.compare(s.size() - n, n, suffix) == 0;
+}
+
+// Description: Reads the first timestamp of a log, or 0 if its first line has none.
+static uint32_t firstTimestamp(const std::string& path) {
+    char head[32];
+    FILE* f = fopen(path.c_str(), "rb");
+    if (!f) return 0;
+    size_t n = fread(head, 1, sizeof(head), f);
+    fclose(f);
+    uint32_t timestamp = 0;
+    return numberparser::parseUnsigned(head, head + n, timestamp) ? timestamp : 0;
+}
+
+// Description: Adds the *.csv files below `dir` to their plants. `group` is the first
+// directory below the PATH argument, empty while still in it.
+static void collect(const std::string& dir, const std::string& group, bool top, std::map<std::string, Plant>& plants) {
+    DIR* d = opendir(dir.c_str());
+    if (!d) {
+        perror(dir.c_str());
+        return;
+    }
+    while (struct dirent* entry = readdir(d)) {
+        if (entry->d_name[0] == '.') continue;
+        std::string path = dir + "/" + entry->d_name;
+        struct stat st;
+        if (stat(path.c_str(), &st) != 0) continue;
+        if (S_ISDIR(st.st_mode)) {
+            collect(path, top ? std::string(entry->d_name) : group, false, plants);
+        } else if (S_ISREG(st.st_mode) && endsWith(path, ".csv")) {
+            std::string name = group.empty() ? stem(path) : group + "/" + stem(path);
+            Plant& plant = plants[name];
+            plant.name = name;
+            plant.files.push_back({path, (size_t)st.st_size, firstTimestamp(path)});
+            plant.bytes += st.st_size;
+        }
+    }
+    closedir(d);
+}
+
+// Description: Reads a plant's files in time order into a PlantAnalyzer.
+static void analyse(Plant& plant, int32_t utcOffset) {
+    std::sort(plant.files.begin(), plant.files.end(),
+              [](const LogFile& a, const LogFile& b) { return a.firstTimestamp < b.firstTimestamp; });
+    PlantAnalyzer analyzer(utcOffset);
+    uint64_t lines = 0;
+    for (const LogFile& file : plant.files) {
+        MappedFile mapped;
+        std::string error;
+        if (!mapped.open(file.path, error)) {
+            plant.error = file.path + ": " + error;
+            continue;
+        }
+        parseLogLines(mapped.begin(), mapped.end(), plant.badLines, [&](uint32_t timestamp, uint32_t value) {
+            lines++;
+            analyzer.add(timestamp, value);
+        });
+    }
+    analyzer.finish();
+
+    plant.lines = lines;
+    plant.days = analyzer.days();
+    plant.waterings = analyzer.waterings();
+    plant.samples = analyzer.accepted();
+    plant.dropouts = analyzer.dropouts();
+    plant.stale = analyzer.stale();
+    plant.first = analyzer.firstTimestamp();
+    plant.last = analyzer.lastTimestamp();
+}
+
+static double percentile(std::vector<double>& values, double p) {
+    if (values.empty()) return 0;
+    size_t k = (size_t)(p * (values.size() - 1) + 0.5);
+    std::nth_element(values.begin(), values.begin() + k, values.end());
+    return values[k];
+}
+
+// Description: Prints one plant's summary. Between two waterings the plant dries for
+// a spell, whose length and drying rate (counts per day, from the wettest reading after
+// one watering to the driest before the next) are summarised as percentiles.
+static void printPlant(const Plant& plant) {
+    std::vector<double> intervals, rates;
+    for (size_t i = 1; i < plant.waterings.size(); ++i) {
+        const WateringEvent& previous = plant.waterings[i - 1];
+        const WateringEvent& current = plant.waterings[i];
+        intervals.push_back((current.start - previous.start) / 86400.0);
+        if (current.start > previous.end) {
+            rates.push_back(((double)current.before - previous.after) * 86400.0 / (current.start - previous.end));
+        }
+    }
+    double sum = 0;
+    uint64_t count = 0;
+    for (const DailyRollup& day : plant.days) {
+        sum += day.sum;
+        count += day.count;
+    }
+
+    printf("{\"plant\":\"%s\",\"files\":%u,\"bytes\":%zu,\"lines\":%llu,\"bad_lines\":%llu,\"samples\":%llu,"
+           "\"dropouts\":%llu,\"duplicates\":%llu,\"first\":%lu,\"last\":%lu,\"days\":%u,\"mean\":%.1f,"
+           "\"waterings\":%u,\"interval_days_p10\":%.2f,\"interval_days_p50\":%.2f,\"interval_days_p90\":%.2f,"
+           "\"drying_per_day_p10\":%.1f,\"drying_per_day_p50\":%.1f,\"drying_per_day_p90\":%.1f",
+           plant.name.c_str(), (unsigned)plant.files.size(), plant.bytes, (unsigned long long)plant.lines,
+           (unsigned long long)plant.badLines, (unsigned long long)plant.samples,
+           (unsigned long long)plant.dropouts, (unsigned long long)plant.stale, (unsigned long)plant.first,
+           (unsigned long)plant.last, (unsigned)plant.days.size(), count ? sum / count : 0,
+           (unsigned)plant.waterings.size(), percentile(intervals, 0.1), percentile(intervals, 0.5),
+           percentile(intervals, 0.9), percentile(rates, 0.1), percentile(rates, 0.5), percentile(rates, 0.9));
+    if (!plant.error.empty()) printf(",\"error\":\"%s\"", plant.error.c_str());
+    printf("}\n");
+}
+
+static void writeDaily(const char* path, const std::vector<Plant*>& plants) {
+    FILE* out = fopen(path, "w");
+    if (!out) {
+        perror(path);
+        return;
+    }
+    fprintf(out, "plant,date,count,min,max,mean,waterings\n");
+    for (const Plant* plant : plants) {
+        for (const DailyRollup& day : plant->days) {
+            time_t t = (time_t)day.day * 86400;
+            struct tm date;
+            gmtime_r(&t, &date);
+            fprintf(out, "%s,%04d-%02d-%02d,%u,%u,%u,%.1f,%u\n", plant->name.c_str(), date.tm_year + 1900,
+                    date.tm_mon + 1, date.tm_mday, day.count, day.min, day.max, (double)day.sum / day.count,
+                    day.waterings);
+        }
+    }
+    fclose(out);
+}
+
+static void writeEvents(const char* path, const std::vector<Plant*>& plants) {
+    FILE* out = fopen(path, "w");
+    if (!out) {
+        perror(path);
+        return;
+    }
+    fprintf(out, "plant,start,end,before,after\n");
+    for (const Plant* plant : plants) {
+        for (const WateringEvent& event : plant->waterings) {
+            fprintf(out, "%s,%lu,%lu,%u,%u\n", plant->name.c_str(), (unsigned long)event.start,
+                    (unsigned long)event.end, event.before, event.after);
+        }
+    }
+    fclose(out);
+}
+
+// Description: Writes an archive of synthetic traces, two plants per board, in the
+// three line endings the firmware has written over time, and prints the true number of
+// waterings to compare the analysis against.
+static int generate(const Options& options) {
+    static const uint32_t FIRST_TIMESTAMP = 1600000000;
+    static const char* const LINE_ENDINGS[] = {"\n", "\r\n", "\r\r\n"};
+    mkdir(options.generateDir, 0755);
+
+    uint64_t bytes = 0, lines = 0, waterings = 0;
+    uint32_t files = 0;
+    uint32_t rounds = (uint32_t)((uint64_t)options.days * TraceGenerator::SECONDS_PER_DAY / options.interval);
+    uint32_t overlap = options.dumpDays / 3 * TraceGenerator::SECONDS_PER_DAY;
+    uint32_t dumpSeconds = options.dumpDays * TraceGenerator::SECONDS_PER_DAY;
+    TraceOptions traceOptions;
+    traceOptions.seed = options.seed;
+
+    for (uint32_t board = 0; board < options.boards; ++board) {
+        char dir[512];
+        snprintf(dir, sizeof(dir), "%s/board-%03u", options.generateDir, (unsigned)board);
+        mkdir(dir, 0755);
+        const char* eol = LINE_ENDINGS[board % 3];
+
+        for (uint32_t sensor = 0; sensor < 2; ++sensor) {
+            SensorConfig config = {"plant", 0, 2000, 3200, 1300, ""};
+            TraceGenerator trace(config, board * 2 + sensor, traceOptions);
+            FILE* dumps[2] = {nullptr, nullptr};   // The current dump and the next, which repeats its end
+            uint32_t dumpIndex = UINT32_MAX;
+
+            for (uint32_t round = 0; round < rounds; ++round) {
+                uint32_t offset = round * options.interval;
+                uint32_t index = offset / dumpSeconds;
+                if (index != dumpIndex) {
+                    if (dumps[0]) fclose(dumps[0]);
+                    dumps[0] = dumps[1];
+                    dumps[1] = nullptr;
+                    dumpIndex = index;
+                }
+                for (uint32_t k = 0; k < 2; ++k) {
+                    if (k == 1 && offset % dumpSeconds < dumpSeconds - overlap) break;
+                    if (!dumps[k]) {
+                        char path[600];
+                        snprintf(path, sizeof(path), "%s/dump-%03u", dir, (unsigned)(index + k));
+                        mkdir(path, 0755);
+                        snprintf(path, sizeof(path), "%s/dump-%03u/data%u.csv", dir, (unsigned)(index + k), (unsigned)(sensor + 1));
+                        dumps[k] = fopen(path, "w");
+                        if (!dumps[k]) {
+                            perror(path);
+                            return 1;
+                        }
+                        setvbuf(dumps[k], nullptr, _IOFBF, 1 << 20);
+                        files++;
+                    }
+                }
+                uint32_t timestamp = FIRST_TIMESTAMP + offset;
+                int value = trace.next(timestamp, options.interval);
+                for (FILE* dump : dumps) {
+                    if (!dump) continue;
+                    int n = fprintf(dump, "%lu,%d%s", (unsigned long)timestamp, value, eol);
+                    bytes += n;
+                    lines++;
+                }
+            }
+            for (FILE* dump : dumps) {
+                if (dump) fclose(dump);
+            }
+            waterings += trace.waterings();
+        }
+    }
+    printf("{\"generated\":\"%s\",\"plants\":%u,\"files\":%u,\"bytes\":%llu,\"lines\":%llu,\"waterings\":%llu}\n",
+           options.generateDir, (unsigned)options.boards * 2, (unsigned)files, (unsigned long long)bytes,
+           (unsigned long long)lines, (unsigned long long)waterings);
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        fprintf(stderr,
+                "usage: %s [--threads N] [--utc-offset H] [--daily FILE] [--events FILE] PATH...\n"
+                "       %s --generate DIR [--boards N] [--days D] [--interval S] [--dump-days D] [--seed N]\n",
+                argv[0], argv[0]);
+        return 2;
+    }
+    if (options.generateDir) return generate(options);
+
+    std::map<std::string, Plant> byName;
+    for (const std::string& path : options.paths) {
+        struct stat st;
+        if (stat(path.c_str(), &st) != 0) {
+            perror(path.c_str());
+            return 1;
+        }
+        if (S_ISDIR(st.st_mode)) {
+            collect(path, "", true, byName);
+        } else {
+            Plant& plant = byName[stem(path)];
+            plant.name = stem(path);
+            plant.files.push_back({path, (size_t)st.st_size, firstTimestamp(path)});
+            plant.bytes += st.st_size;
+        }
+    }
+
+    // Largest plants first, so no thread is left with a big one at the end
+    std::vector<Plant*> plants;
+    for (auto& entry : byName) plants.push_back(&entry.second);
+    std::vector<Plant*> queue = plants;
+    std::sort(queue.begin(), queue.end(), [](const Plant* a, const Plant* b) { return a->bytes > b->bytes; });
+
+    unsigned threads = options.threads ? options.threads : std::max(1u, std::thread::hardware_concurrency());
+    threads = std::min<unsigned>(threads, std::max<size_t>(queue.size(), 1));
+    std::atomic<size_t> next(0);
+    double start = nowSeconds();
+    std::vector<std::thread> pool;
+    for (unsigned t = 0; t < threads; ++t) {
+        pool.emplace_back([&]() {
+            for (size_t i; (i = next++) < queue.size();) analyse(*queue[i], options.utcOffset);
+        });
+    }
+    for (std::thread& t : pool) t.join();
+    double seconds = nowSeconds() - start;
+
+    uint64_t bytes = 0, lines = 0, badLines = 0, waterings = 0;
+    uint32_t files = 0;
+    for (const Plant* plant : plants) {
+        printPlant(*plant);
+        bytes += plant->bytes;
+        lines += plant->lines;
+        badLines += plant->badLines;
+        waterings += plant->waterings.size();
+        files += plant->files.size();
+    }
+    if (options.dailyFile) writeDaily(options.dailyFile, plants);
+    if (options.eventsFile) writeEvents(options.eventsFile, plants);
+
+    printf("{\"plants\":%u,\"files\":%u,\"bytes\":%llu,\"lines\":%llu,\"bad_lines\":%llu,\"waterings\":%llu,"
+           "\"threads\":%u,\"seconds\":%.3f,\"mb_per_s\":%.1f,\"lines_per_s\":%.0f}\n",
+           (unsigned)plants.size(), (unsigned)files, (unsigned long long)bytes, (unsigned long long)lines,
+           (unsigned long long)badLines, (unsigned long long)waterings, threads, seconds,
+           bytes / 1e6 / seconds, lines / seconds);
+    return 0;
+}
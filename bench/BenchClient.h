@@ -0,0 +1,150 @@
+#pragma once
+// Minimal blocking HTTP/1.1 client for the benchmarks and the load test. It keeps its
+// connection alive between requests and reads the two body framings HttpServer uses:
+// Content-Length and chunked.
+
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <string>
+
+class BenchClient {
+public:
+    BenchClient() {}
+    BenchClient(const BenchClient&) = delete;
+    BenchClient& operator=(const BenchClient&) = delete;
+    ~BenchClient() { close(); }
+
+    bool connect(uint16_t port) {
+        close();
+        fd_ = socket(AF_INET, SOCK_STREAM, 0);
+        if (fd_ < 0) return false;
+        int one = 1;
+        setsockopt(fd_, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = htons(port);
+        if (::connect(fd_, (sockaddr*)&addr, sizeof(addr)) < 0) {
+            close();
+            return false;
+        }
+        port_ = port;
+        return true;
+    }
+
+    void close() {
+        if (fd_ >= 0) ::close(fd_);
+        fd_ = -1;
+        buf_.clear();
+        pos_ = 0;
+    }
+
+    // Sends one GET and reads the whole response, reconnecting first if the server closed
+    // the connection. Returns the body length, or -1 on failure; `status` gets the code.
+    // A non-empty `ifNoneMatch` is sent as If-None-Match; etag() is the response's ETag.
+    long get(const std::string& target, int* status = nullptr, const std::string& ifNoneMatch = "") {
+        // The server may close an idle connection just as it is reused. Like a browser,
+        // retry once on a new connection if nothing at all came back.
+        bool reused = fd_ >= 0;
+        if (!reused && (port_ == 0 || !connect(port_))) return -1;
+
+        std::string request = "GET " + target + " HTTP/1.1\r\nHost: bench\r\n";
+        if (!ifNoneMatch.empty()) request += "If-None-Match: " + ifNoneMatch + "\r\n";
+        request += "\r\n";
+        std::string line;
+        if (::send(fd_, request.data(), request.size(), MSG_NOSIGNAL) != (ssize_t)request.size() ||
+            !readLine(line)) {
+            close();
+            return reused ? get(target, status, ifNoneMatch) : -1;
+        }
+        if (line.compare(0, 9, "HTTP/1.1 ") != 0) return fail();
+        if (status) *status = atoi(line.c_str() + 9);
+
+        long contentLength = -1;
+        bool chunked = false;
+        bool keepAlive = true;
+        etag_.clear();
+        while (readLine(line) && !line.empty()) {
+            if (strncasecmp(line.c_str(), "ETag: ", 6) == 0) etag_ = line.substr(6);
+            if (strncasecmp(line.c_str(), "Content-Length:", 15) == 0) contentLength = atol(line.c_str() + 15);
+            if (strncasecmp(line.c_str(), "Transfer-Encoding: chunked", 26) == 0) chunked = true;
+            if (strncasecmp(line.c_str(), "Connection: close", 17) == 0) keepAlive = false;
+        }
+        if (!line.empty()) return fail();
+
+        long body = 0;
+        if (chunked) {
+            for (;;) {
+                if (!readLine(line)) return fail();
+                long size = strtol(line.c_str(), nullptr, 16);
+                if (!skip(size + 2)) return fail();
+                body += size;
+                if (size == 0) break;
+            }
+        } else if (contentLength >= 0) {
+            if (!skip(contentLength)) return fail();
+            body = contentLength;
+        } else {
+            while (fill()) {}
+            body = buf_.size() - pos_;
+            keepAlive = false;
+        }
+
+        if (!keepAlive) close();
+        return body;
+    }
+
+    const std::string& etag() const { return etag_; }
+
+private:
+    long fail() {
+        close();
+        return -1;
+    }
+
+    bool fill() {
+        char chunk[16384];
+        if (pos_ > 0 && (pos_ == buf_.size() || pos_ > sizeof(chunk))) {
+            buf_.erase(0, pos_);
+            pos_ = 0;
+        }
+        ssize_t n = recv(fd_, chunk, sizeof(chunk), 0);
+        if (n <= 0) return false;
+        buf_.append(chunk, n);
+        return true;
+    }
+
+    bool readLine(std::string& line) {
+        for (;;) {
+            size_t end = buf_.find("\r\n", pos_);
+            if (end != std::string::npos) {
+                line.assign(buf_, pos_, end - pos_);
+                pos_ = end + 2;
+                return true;
+            }
+            if (!fill()) return false;
+        }
+    }
+
+    bool skip(long n) {
+        while ((long)(buf_.size() - pos_) < n) {
+            n -= buf_.size() - pos_;
+            pos_ = buf_.size();
+            if (!fill()) return false;
+        }
+        pos_ += n;
+        return true;
+    }
+
+    int fd_ = -1;
+    uint16_t port_ = 0;
+    std::string buf_;
+    std::string etag_;
+    size_t pos_ = 0;
+};
@@ -0,0 +1,324 @@
+// Microbenchmarks for the firmware core, built by the `native` environment against the
+// host stand-ins in host/. Each result is printed as one JSON object per line:
+//   {"bench":"append","entries":1000,"iterations":1000,"ns_per_op":812.4,"bytes_per_op":14.2}
+// `entries` is the history size, `bytes_per_op` is flash bytes written for appends and
+// response body bytes for HTTP requests. `append` covers the raw log and the rollup
+// tiers, `append_raw` the raw log on its own. Requests go over loopback TCP to the firmware's
+// HttpServer, run by loop() on its own thread, on one keep-alive connection.
+//
+// A load test follows the sweep: 1, 4 and 8 clients each send requests back to back on
+// their own connection for LOAD_SECONDS, and the throughput and latency percentiles are
+// printed as
+//   {"bench":"load","entries":1000,"clients":4,"requests":41000,"rps":20500.0,"p50_us":150.2,"p99_us":610.8}
+//
+// The ADC filter is measured on 30 days of synthetic traces with conversion noise and
+// spikes, against a single conversion per reading:
+//   {"bench":"adc_filter","readings":8640,"ns_per_reading":410.2,"single_rms":96.0,"filtered_rms":3.0,...}
+// `*_false_dry` counts readings above the dry threshold while the soil was below it.
+//
+// Pass history sizes as arguments to override the default sweep.
+
+#include <Arduino.h>
+#include <SPIFFS.h>
+#include <freertos/task.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <stdlib.h>
+#include <thread>
+#include <vector>
+#include "AdcFilter.h"
+#include "HttpServer.h"
+#include "SensorHistory.h"
+#include "BenchClient.h"
+#include "TraceGenerator.h"
+
+void setup();
+void loop();
+void logMoisture(size_t sensor, uint32_t timestamp, int moisture);
+extern HttpServer server;
+extern SensorHistory histories[];
+
+static const uint32_t DEFAULT_SIZES[] = {10, 100, 1000, 10000, 100000};
+static const uint32_t SAMPLE_INTERVAL = 600;   // Production logging interval, seconds
+static const uint32_t FIRST_TIMESTAMP = 1700000000;
+static const uint64_t TARGET_RESPONSE_BYTES = 8000000;   // Bounds the repeats of each query
+static const uint32_t LOAD_ENTRIES = 1000;
+static const uint32_t LOAD_CLIENTS[] = {1, 4, 8};
+static const double LOAD_SECONDS = 2.0;
+static const uint32_t ADC_TRACE_DAYS = 30;
+
+// What a dashboard and a scraper ask for, requested in turn by every load test client
+static const char* const LOAD_MIX[] = {
+    "/",
+    "/config.json",
+    "/log?sensor=1&limit=100",
+    "/series?sensor=1",
+    "/metrics",
+};
+
+// Production retention, so rollup maintenance costs what it does on the device
+static const RollupTierConfig BENCH_TIERS[ROLLUP_TIER_COUNT] = {
+    {600, 1008, "10m"},
+    {3600, 2160, "1h"},
+    {86400, 730, "1d"},
+};
+
+// The open block, with the production write-back age
+static SampleBlock benchBlock;
+static const uint32_t BENCH_WRITE_BACK_AGE = 3600;
+
+static BenchClient client;
+
+static double nowNanos() {
+    return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static void report(const char* name, uint32_t entries, uint32_t iterations, double nanos, double bytes) {
+    printf("{\"bench\":\"%s\",\"entries\":%u,\"iterations\":%u,\"ns_per_op\":%.1f,\"bytes_per_op\":%.1f}\n",
+           name, (unsigned)entries, (unsigned)iterations, nanos / iterations, bytes / iterations);
+    fflush(stdout);
+}
+
+// Description: Times one HTTP request against the current history, repeating it until
+// about TARGET_RESPONSE_BYTES have been received. Repeats of small query responses come
+// from the firmware's response cache, as for a dashboard polling an idle history. With
+// `conditional` the repeats send the first response's ETag, as a browser revalidating
+// its copy does, and get 304.
+static void benchRequest(const char* name, uint32_t entries, const char* uri,
+                         const std::map<std::string, std::string>& args, bool conditional = false) {
+    std::string target = uri;
+    for (const auto& arg : args) {
+        target += (target == uri ? "?" : "&") + arg.first + "=" + arg.second;
+    }
+
+    long first = client.get(target);
+    if (first < 0) {
+        fprintf(stderr, "%s: request failed\n", name);
+        return;
+    }
+    std::string etag = conditional ? client.etag() : "";
+    if (conditional) first = 0;
+    uint32_t iterations = first > 0 ? (uint32_t)(TARGET_RESPONSE_BYTES / first) : 1000;
+    if (iterations < 3) iterations = 3;
+    if (iterations > 1000) iterations = 1000;
+
+    double bytes = 0;
+    double start = nowNanos();
+    for (uint32_t i = 0; i < iterations; ++i) {
+        bytes += client.get(target, nullptr, etag);
+    }
+    report(name, entries, iterations, nowNanos() - start, bytes);
+}
+
+// Description: Opens an empty history with room for `entries` samples as sensor 1.
+static void openHistory(const char* path, uint32_t entries) {
+    memset(&benchBlock, 0, sizeof(benchBlock));   // Not a soft reset: start without a kept block
+    histories[0].raw().setWriteBack(&benchBlock, BENCH_WRITE_BACK_AGE);
+    histories[0].begin(SPIFFS, path, entries / SampleLog::MIN_SAMPLES_PER_BLOCK + 2, BENCH_TIERS);
+}
+
+// Description: Slow drift plus up to ±16 counts of noise, like a real sensor.
+static int benchSample(uint32_t i) {
+    return 1500 + (int)(i / 50 % 500) + (int)(i * 7919 % 33) - 16;
+}
+
+// Description: Appends `entries` samples to sensor 1 through logMoisture(): raw ring,
+// rollups and the event broadcast. Returns the time taken.
+static double fillHistory(uint32_t entries) {
+    double start = nowNanos();
+    for (uint32_t i = 0; i < entries; ++i) {
+        logMoisture(0, FIRST_TIMESTAMP + i * SAMPLE_INTERVAL, benchSample(i));
+    }
+    return nowNanos() - start;
+}
+
+// Description: Appends the same samples to a bare SampleLog with the production
+// write-back age, so the flash cost of the raw log shows apart from the rollups.
+static void benchRawLog(uint32_t entries) {
+    static SampleBlock block;
+    memset(&block, 0, sizeof(block));
+    SampleLog log;
+    log.setWriteBack(&block, BENCH_WRITE_BACK_AGE);
+    log.begin(SPIFFS, "/bench_raw", entries / SampleLog::MIN_SAMPLES_PER_BLOCK + 2);
+
+    size_t written = SPIFFS.bytesWritten;
+    double start = nowNanos();
+    for (uint32_t i = 0; i < entries; ++i) {
+        log.append(FIRST_TIMESTAMP + i * SAMPLE_INTERVAL, (int16_t)benchSample(i));
+    }
+    report("append_raw", entries, entries, nowNanos() - start, (double)(SPIFFS.bytesWritten - written));
+    SPIFFS.remove("/bench_raw");
+}
+
+// Description: Drops a history's files so memory use does not add up across the sweep.
+static void removeHistory(const char* path) {
+    const char* suffixes[] = {"log", "10m", "1h", "1d"};
+    for (const char* suffix : suffixes) {
+        char file[32];
+        snprintf(file, sizeof(file), "%s.%s", path, suffix);
+        SPIFFS.remove(file);
+    }
+}
+
+static void benchHistorySize(uint32_t entries) {
+    char path[24];
+    snprintf(path, sizeof(path), "/bench%u", (unsigned)entries);
+
+    openHistory(path, entries);
+    size_t written = SPIFFS.bytesWritten;
+    double nanos = fillHistory(entries);
+    report("append", entries, entries, nanos, (double)(SPIFFS.bytesWritten - written));
+    benchRawLog(entries);
+
+    benchRequest("log_full", entries, "/log", {{"sensor", "1"}});
+    benchRequest("log_full_not_modified", entries, "/log", {{"sensor", "1"}}, true);
+    benchRequest("log_limit_100", entries, "/log", {{"sensor", "1"}, {"limit", "100"}});
+    benchRequest("series_buckets", entries, "/series", {{"sensor", "1"}});
+    benchRequest("series_lttb", entries, "/series", {{"sensor", "1"}, {"mode", "lttb"}});
+
+    // Zoomed-in queries: the newest hour, and a 4-hour window from the middle of the history
+    uint32_t last = FIRST_TIMESTAMP + (entries - 1) * SAMPLE_INTERVAL;
+    uint32_t middle = FIRST_TIMESTAMP + entries / 2 * SAMPLE_INTERVAL;
+    benchRequest("log_since_1h", entries, "/log", {{"sensor", "1"}, {"since", std::to_string(last - 3600)}});
+    benchRequest("series_range_4h", entries, "/series",
+                 {{"sensor", "1"}, {"from", std::to_string(middle)}, {"to", std::to_string(middle + 4 * 3600)}});
+    benchRequest("dashboard", entries, "/", {});
+    benchRequest("stats", entries, "/stats", {});
+
+    // Collectors: a full binary dump, then a poll that only fetches the newest 10 samples
+    benchRequest("export_full", entries, "/export", {{"sensor", "1"}});
+    benchRequest("export_after", entries, "/export",
+                 {{"sensor", "1"}, {"after", std::to_string(entries > 11 ? entries - 11 : 0)}});
+
+    removeHistory(path);
+}
+
+// Description: Captures a burst of conversions per sensor and round from synthetic traces,
+// then times AdcFilter::reduce() over them and compares its error with that of the first
+// conversion alone. Dropouts read the same either way and are left out.
+static void benchAdcFilter() {
+    TraceOptions options;
+    std::vector<uint16_t> bursts;
+    std::vector<int> levels, thresholds;
+    for (size_t i = 0; i < SENSOR_COUNT; ++i) {
+        TraceGenerator trace(SENSORS[i], i, options);
+        for (uint32_t t = 0; t < ADC_TRACE_DAYS * TraceGenerator::SECONDS_PER_DAY; t += SAMPLE_INTERVAL) {
+            trace.step(FIRST_TIMESTAMP + t, SAMPLE_INTERVAL);
+            int level = trace.level();
+            if (level <= 0 || level >= AdcFilter::ADC_MAX) continue;
+            for (size_t k = 0; k < AdcFilter::BURST_SIZE; ++k) bursts.push_back((uint16_t)trace.read());
+            levels.push_back(level);
+            thresholds.push_back(SENSORS[i].dryThreshold);
+        }
+    }
+    size_t readings = levels.size();
+    if (readings == 0) return;
+
+    std::vector<uint16_t> scratch(bursts);
+    std::vector<int16_t> filtered(readings);
+    double start = nowNanos();
+    for (size_t r = 0; r < readings; ++r) {
+        filtered[r] = AdcFilter::reduce(&scratch[r * AdcFilter::BURST_SIZE], AdcFilter::BURST_SIZE).value;
+    }
+    double nanos = nowNanos() - start;
+
+    double singleSquares = 0, filteredSquares = 0;
+    int singleMax = 0, filteredMax = 0;
+    uint32_t singleFalseDry = 0, filteredFalseDry = 0;
+    for (size_t r = 0; r < readings; ++r) {
+        int single = bursts[r * AdcFilter::BURST_SIZE];
+        int singleError = single - levels[r];
+        int filteredError = filtered[r] - levels[r];
+        singleSquares += (double)singleError * singleError;
+        filteredSquares += (double)filteredError * filteredError;
+        singleMax = std::max(singleMax, abs(singleError));
+        filteredMax = std::max(filteredMax, abs(filteredError));
+        if (levels[r] <= thresholds[r]) {
+            if (single > thresholds[r]) singleFalseDry++;
+            if (filtered[r] > thresholds[r]) filteredFalseDry++;
+        }
+    }
+    printf("{\"bench\":\"adc_filter\",\"readings\":%u,\"conversions\":%u,\"ns_per_reading\":%.1f,"
+           "\"ns_per_conversion\":%.1f,\"single_rms\":%.1f,\"filtered_rms\":%.1f,\"single_max\":%d,"
+           "\"filtered_max\":%d,\"single_false_dry\":%u,\"filtered_false_dry\":%u}\n",
+           (unsigned)readings, (unsigned)AdcFilter::BURST_SIZE, nanos / readings,
+           nanos / readings / AdcFilter::BURST_SIZE, sqrt(singleSquares / readings), sqrt(filteredSquares / readings),
+           singleMax, filteredMax, (unsigned)singleFalseDry, (unsigned)filteredFalseDry);
+    fflush(stdout);
+}
+
+// Description: Runs `clients` connections side by side for LOAD_SECONDS, each cycling
+// through LOAD_MIX, and reports the combined throughput and latency percentiles.
+static void benchLoad(uint32_t entries, uint32_t clients) {
+    std::atomic<bool> stop(false);
+    std::vector<std::vector<double>> latencies(clients);
+    std::vector<std::thread> threads;
+    std::atomic<uint32_t> failures(0);
+
+    for (uint32_t c = 0; c < clients; ++c) {
+        threads.emplace_back([&, c]() {
+            BenchClient load;
+            if (!load.connect(server.port())) {
+                failures++;
+                return;
+            }
+            for (size_t i = c; !stop; ++i) {
+                double start = nowNanos();
+                if (load.get(LOAD_MIX[i % (sizeof(LOAD_MIX) / sizeof(LOAD_MIX[0]))]) < 0) failures++;
+                latencies[c].push_back(nowNanos() - start);
+            }
+        });
+    }
+
+    double start = nowNanos();
+    std::this_thread::sleep_for(std::chrono::milliseconds((long)(LOAD_SECONDS * 1000)));
+    stop = true;
+    for (std::thread& t : threads) t.join();
+    double elapsed = nowNanos() - start;
+
+    std::vector<double> all;
+    for (const auto& l : latencies) all.insert(all.end(), l.begin(), l.end());
+    std::sort(all.begin(), all.end());
+    if (all.empty()) return;
+
+    printf("{\"bench\":\"load\",\"entries\":%u,\"clients\":%u,\"requests\":%u,\"failures\":%u,"
+           "\"rps\":%.1f,\"p50_us\":%.1f,\"p99_us\":%.1f}\n",
+           (unsigned)entries, (unsigned)clients, (unsigned)all.size(), (unsigned)failures,
+           all.size() / (elapsed / 1e9), all[all.size() / 2] / 1e3, all[all.size() * 99 / 100] / 1e3);
+    fflush(stdout);
+}
+
+int main(int argc, char** argv) {
+    Serial.quiet = true;
+    hostTasksEnabled = false;   // Only loop() runs, on the server thread below
+    setup();
+
+    // Listen on a free port before loop() would start the server on port 80
+    if (!server.begin(0)) return 1;
+    std::atomic<bool> done(false);
+    std::thread serverThread([&done]() {
+        while (!done) loop();
+    });
+    client.connect(server.port());
+
+    if (argc > 1) {
+        for (int i = 1; i < argc; ++i) benchHistorySize(strtoul(argv[i], nullptr, 10));
+    } else {
+        for (uint32_t entries : DEFAULT_SIZES) benchHistorySize(entries);
+    }
+
+    benchAdcFilter();
+
+    openHistory("/load", LOAD_ENTRIES);
+    fillHistory(LOAD_ENTRIES);
+    for (uint32_t clients : LOAD_CLIENTS) benchLoad(LOAD_ENTRIES, clients);
+    removeHistory("/load");
+
+    client.close();
+    done = true;
+    serverThread.join();
+    return 0;
+}
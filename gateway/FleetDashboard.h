@@ -0,0 +1,115 @@
+#pragma once
+
+// Description: The gateway's combined dashboard: one small chart per sensor of every
+// monitor, over a selectable window. Chart.js is served from the firmware's own bundled
+// copy (WEB_ASSETS). Charts are re-fetched once a minute; the gateway answers unchanged
+// views from its cache or with 304.
+static const char FLEET_DASHBOARD[] = R"HTML(<!DOCTYPE html>
+<html>
+<head>
+    <title>Plant Fleet</title>
+    <meta charset="utf-8">
+    <meta name="viewport" content="width=device-width, initial-scale=1">
+    <script src="/chart.umd.min.js"></script>
+    <style>
+        body {
+            font-family: Inter, system-ui, -apple-system, 'Segoe UI', Roboto, sans-serif;
+            background-color: #f4f4f8;
+            margin: 0;
+            padding: 20px;
+        }
+        header { display: flex; gap: 16px; align-items: baseline; margin-bottom: 16px; }
+        h1 { margin: 0; font-weight: 600; color: #333; font-size: 22px; }
+        .grid { display: grid; grid-template-columns: repeat(auto-fill, minmax(320px, 1fr)); gap: 16px; }
+        .card {
+            background: #fff;
+            border-radius: 16px;
+            box-shadow: 0 4px 20px rgba(0,0,0,0.05);
+            padding: 12px 16px;
+        }
+        .card h2 { margin: 0 0 4px; font-size: 16px; font-weight: 600; color: #333; }
+        .status { font-size: 12px; color: #777; margin-bottom: 6px; }
+        .status.down { color: #c62828; }
+    </style>
+</head>
+<body>
+    <header>
+        <h1>🌱 Plant fleet</h1>
+        <select id="window">
+            <option value="24">Last 24 hours</option>
+            <option value="168">Last 7 days</option>
+            <option value="720">Last 30 days</option>
+        </select>
+        <span id="summary" class="status"></span>
+    </header>
+    <div id="grid" class="grid"></div>
+
+    <script>
+        const POINTS = 120;
+        const REFRESH_MS = 60000;
+        const charts = {};
+
+        function formatLabel(ts) {
+            const date = new Date(ts * 1000);
+            return String(date.getMonth() + 1).padStart(2, '0') + "-" +
+                String(date.getDate()).padStart(2, '0') + " " +
+                String(date.getHours()).padStart(2, '0') + ":" +
+                String(date.getMinutes()).padStart(2, '0');
+        }
+
+        function card(key, title) {
+            if (charts[key]) return charts[key];
+            const div = document.createElement('div');
+            div.className = 'card';
+            const heading = document.createElement('h2');
+            heading.textContent = title;
+            const status = document.createElement('div');
+            status.className = 'status';
+            const canvas = document.createElement('canvas');
+            canvas.width = 320;
+            canvas.height = 160;
+            div.append(heading, status, canvas);
+            document.getElementById('grid').append(div);
+            const chart = new Chart(canvas.getContext('2d'), {
+                type: 'line',
+                data: { labels: [], datasets: [
+                    { label: 'Mean', data: [], borderColor: 'rgba(33, 150, 243, 0.9)', borderWidth: 2, pointRadius: 0, tension: 0.3 },
+                    { label: 'Dry threshold', data: [], borderColor: 'red', borderWidth: 1, pointRadius: 0 },
+                ] },
+                options: { animation: false, plugins: { legend: { display: false } },
+                           scales: { x: { ticks: { maxTicksLimit: 6, maxRotation: 0 } } } }
+            });
+            charts[key] = { chart, status };
+            return charts[key];
+        }
+
+        async function refresh() {
+            const hours = document.getElementById('window').value;
+            const fleet = await (await fetch('/api/monitors')).json();
+            document.getElementById('summary').textContent =
+                `${fleet.monitors.length} monitors, ${fleet.records} samples stored`;
+
+            for (const monitor of fleet.monitors) {
+                monitor.sensors.forEach(async (sensor, i) => {
+                    const { chart, status } = card(`${monitor.name}/${i + 1}`, `${monitor.name} · ${sensor.name}`);
+                    status.textContent = monitor.reachable ? `Pulled ${monitor.lastPullSecondsAgo} s ago`
+                                                           : `Unreachable: ${monitor.error}`;
+                    status.className = monitor.reachable ? 'status' : 'status down';
+
+                    const url = `/api/series?monitor=${encodeURIComponent(monitor.name)}&sensor=${i + 1}&hours=${hours}&points=${POINTS}`;
+                    const lines = (await (await fetch(url)).text()).trim().split("\n").filter(line => line);
+                    chart.data.labels = lines.map(line => formatLabel(parseInt(line.split(",")[0])));
+                    chart.data.datasets[0].data = lines.map(line => parseFloat(line.split(",")[3]));
+                    chart.data.datasets[1].data = lines.map(() => sensor.dryThreshold);
+                    chart.update();
+                });
+            }
+        }
+
+        document.getElementById('window').addEventListener('change', refresh);
+        refresh();
+        setInterval(refresh, REFRESH_MS);
+    </script>
+</body>
+</html>
+)HTML";
@@ -0,0 +1,172 @@
+#include "FleetPuller.h"
+#include <Arduino.h>
+#include <stdlib.h>
+#include <string.h>
+#include "HttpFetch.h"
+
+void FleetPuller::add(const MonitorConfig& monitor) {
+    MonitorStatus status;
+    status.config = monitor;
+    monitors_.push_back(status);
+}
+
+void FleetPuller::start(size_t workers, unsigned intervalMillis) {
+    threads_.emplace_back(&FleetPuller::schedule, this, intervalMillis);
+    for (size_t i = 0; i < workers; ++i) threads_.emplace_back(&FleetPuller::work, this);
+}
+
+void FleetPuller::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    changed_.notify_all();
+    for (std::thread& t : threads_) t.join();
+    threads_.clear();
+}
+
+std::vector<MonitorStatus> FleetPuller::status() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return monitors_;
+}
+
+// Description: Queues every monitor that is not still being pulled, once per interval.
+void FleetPuller::schedule(unsigned intervalMillis) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!stopping_) {
+        for (size_t i = 0; i < monitors_.size(); ++i) {
+            if (!monitors_[i].busy) {
+                monitors_[i].busy = true;
+                jobs_.push_back(i);
+            }
+        }
+        changed_.notify_all();
+        changed_.wait_for(lock, std::chrono::milliseconds(intervalMillis), [this] { return stopping_; });
+    }
+}
+
+void FleetPuller::work() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    for (;;) {
+        changed_.wait(lock, [this] { return stopping_ || !jobs_.empty(); });
+        if (stopping_) return;
+        size_t index = jobs_.front();
+        jobs_.pop_front();
+
+        // Pull a copy without the lock, so status() never waits on the network
+        MonitorStatus monitor = monitors_[index];
+        lock.unlock();
+        std::string error;
+        bool ok = pull(monitor, error);
+        lock.lock();
+
+        MonitorStatus& status = monitors_[index];
+        status.sensors = monitor.sensors;
+        status.records = monitor.records;
+        status.reachable = ok;
+        status.pulls++;
+        if (ok) {
+            status.lastPullMillis = millis();
+            status.lastError.clear();
+        } else {
+            status.failures++;
+            status.lastError = error;
+        }
+        status.busy = false;
+    }
+}
+
+// Description: Reads the sensor table from /config.json the first time, then pulls each
+// sensor's new samples.
+bool FleetPuller::pull(MonitorStatus& monitor, std::string& error) {
+    if (monitor.sensors.empty()) {
+        std::string body;
+        int code = httpGet(monitor.config.host, monitor.config.port, "/config.json", TIMEOUT_MILLIS, body, error);
+        if (code != 200) {
+            if (code > 0) error = "/config.json answered HTTP " + std::to_string(code);
+            return false;
+        }
+        // Each sensor object has a "name" and a "dryThreshold", in this order
+        size_t pos = body.find("\"sensors\":[");
+        while (pos != std::string::npos && (pos = body.find("\"name\":\"", pos)) != std::string::npos) {
+            pos += 8;
+            size_t end = body.find('"', pos);
+            size_t threshold = body.find("\"dryThreshold\":", end);
+            if (end == std::string::npos || threshold == std::string::npos) break;
+            monitor.sensors.push_back({body.substr(pos, end - pos), atoi(body.c_str() + threshold + 15)});
+            pos = end;
+        }
+        if (monitor.sensors.empty()) {
+            error = "no sensors in /config.json";
+            return false;
+        }
+    }
+
+    for (size_t i = 0; i < monitor.sensors.size(); ++i) {
+        if (!pullSensor(monitor.config, (uint8_t)(i + 1), monitor.records, error)) return false;
+    }
+    return true;
+}
+
+bool FleetPuller::pullSensor(const MonitorConfig& config, uint8_t sensor, uint64_t& records, std::string& error) {
+    int id = store_.seriesId(config.name, sensor);
+    if (id < 0) {
+        error = "store full";
+        return false;
+    }
+
+    uint32_t after;
+    bool resume = store_.cursor(id, after);
+    bool restarted = false;
+    uint32_t first = 0, newest = 0;
+    for (;;) {
+        std::string target = "/export?sensor=" + std::to_string(sensor) + "&limit=" + std::to_string(EXPORT_PAGE);
+        if (resume) target += "&after=" + std::to_string(after);
+
+        std::string body;
+        int code = httpGet(config.host, config.port, target, TIMEOUT_MILLIS, body, error);
+        if (code != 200) {
+            if (code > 0) error = "/export answered HTTP " + std::to_string(code);
+            return false;
+        }
+
+        ExportHeader header;
+        if (body.size() < sizeof(header)) {
+            error = "/export response too short";
+            return false;
+        }
+        memcpy(&header, body.data(), sizeof(header));
+        if (header.magic != EXPORT_MAGIC || header.version != EXPORT_VERSION ||
+            header.recordSize < sizeof(ExportRecord)) {
+            error = "unsupported /export format";
+            return false;
+        }
+
+        // A range that does not start after the cursor means the monitor's log was wiped
+        // and is sent whole. Its new samples are the ones newer than those stored.
+        if (resume && header.fromSeq <= after && !restarted) {
+            restarted = store_.range(id, first, newest);
+        }
+
+        // Newer formats may append fields to each record; read the ones known here
+        size_t count = (body.size() - sizeof(header)) / header.recordSize;
+        std::vector<ExportRecord> batch;
+        batch.reserve(count);
+        for (size_t i = 0; i < count; ++i) {
+            ExportRecord record;
+            memcpy(&record, body.data() + sizeof(header) + i * header.recordSize, sizeof(record));
+            if (!restarted || record.timestamp > newest) batch.push_back(record);
+            after = record.seq;
+            resume = true;
+        }
+        if (!batch.empty() && !store_.append(id, batch.data(), batch.size())) {
+            error = "writing the store failed";
+            return false;
+        }
+        records += batch.size();
+
+        // A full range means the limit cut it short. A page whose samples were all
+        // unreadable ends the pull as well, as the cursor cannot move past it.
+        if (count == 0 || header.toSeq - header.fromSeq < EXPORT_PAGE) return true;
+    }
+}
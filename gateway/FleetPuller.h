@@ -0,0 +1,68 @@
+#pragma once
+
+#include <stdint.h>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "FleetStore.h"
+
+struct MonitorConfig {
+    std::string name;      // Unique, no whitespace; names the monitor's series in the store
+    std::string host;
+    uint16_t port;
+};
+
+// Description: What the gateway knows about one monitor, as shown on its dashboard.
+struct MonitorStatus {
+    struct Sensor {
+        std::string name;
+        int dryThreshold;
+    };
+
+    MonitorConfig config;
+    std::vector<Sensor> sensors;    // From the monitor's /config.json; id = position + 1
+    bool reachable = false;
+    std::string lastError;
+    unsigned long lastPullMillis = 0;   // millis() of the last successful pull
+    uint32_t pulls = 0;
+    uint32_t failures = 0;
+    uint64_t records = 0;           // Samples pulled since the gateway started
+    bool busy = false;              // A worker is pulling it
+};
+
+// Description: Pulls every monitor's new samples into the FleetStore. A scheduler thread
+// queues each monitor once per interval, and a pool of workers pulls them side by side,
+// so one slow or unreachable board delays only its own worker. A pull asks /export for
+// the samples after the newest one already stored, in pages of EXPORT_PAGE records.
+class FleetPuller {
+public:
+    static const uint32_t EXPORT_PAGE = 5000;
+    static const unsigned TIMEOUT_MILLIS = 5000;
+
+    explicit FleetPuller(FleetStore& store) : store_(store) {}
+    ~FleetPuller() { stop(); }
+
+    // Add monitors before start().
+    void add(const MonitorConfig& monitor);
+    void start(size_t workers, unsigned intervalMillis);
+    void stop();
+
+    std::vector<MonitorStatus> status();
+
+private:
+    void schedule(unsigned intervalMillis);
+    void work();
+    bool pull(MonitorStatus& monitor, std::string& error);
+    bool pullSensor(const MonitorConfig& config, uint8_t sensor, uint64_t& records, std::string& error);
+
+    FleetStore& store_;
+    std::mutex mutex_;
+    std::condition_variable changed_;
+    std::deque<size_t> jobs_;
+    std::vector<MonitorStatus> monitors_;
+    std::vector<std::thread> threads_;
+    bool stopping_ = false;
+};
@@ -0,0 +1,135 @@
+#include "FleetStore.h"
+#include <string.h>
+#include <unistd.h>
+
+FleetStore::~FleetStore() {
+    if (data_) fclose(data_);
+    if (catalog_) fclose(catalog_);
+}
+
+// Description: Loads the catalog and the samples, then keeps both files open for
+// appending. A record cut short by a crash is dropped from the end of the file.
+bool FleetStore::open(const std::string& path) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    path_ = path;
+    std::string catalogPath = path + ".series";
+
+    catalog_ = fopen(catalogPath.c_str(), "a+");
+    if (!catalog_) return false;
+    rewind(catalog_);
+    char line[256];
+    while (fgets(line, sizeof(line), catalog_)) {
+        char monitor[200];
+        unsigned id, sensor;
+        if (sscanf(line, "%u %199s %u", &id, monitor, &sensor) != 3 || id != series_.size()) break;
+        Series series;
+        series.monitor = monitor;
+        series.sensor = (uint8_t)sensor;
+        series_.push_back(series);
+    }
+
+    data_ = fopen(path.c_str(), "a+b");
+    if (!data_) return false;
+    rewind(data_);
+    StoredRecord stored;
+    long valid = 0;
+    while (fread(&stored, sizeof(stored), 1, data_) == 1) {
+        if (stored.series >= series_.size()) break;
+        add(series_[stored.series], stored.record);
+        valid += sizeof(stored);
+    }
+    fseek(data_, 0, SEEK_END);
+    if (ftell(data_) != valid) {
+        fflush(data_);
+        if (ftruncate(fileno(data_), valid) != 0) return false;
+    }
+    return true;
+}
+
+void FleetStore::add(Series& series, const ExportRecord& record) {
+    std::vector<ExportRecord>& records = series.records;
+    if (records.empty() || record.timestamp >= records.back().timestamp) {
+        records.push_back(record);
+    } else {
+        // Only after the monitor's clock was set back; keep the series ordered by time
+        auto byTime = [](uint32_t t, const ExportRecord& rec) { return t < rec.timestamp; };
+        records.insert(std::upper_bound(records.begin(), records.end(), record.timestamp, byTime), record);
+    }
+    series.lastSeq = record.seq;
+    series.hasSeq = true;
+    series.generation++;
+    records_++;
+}
+
+int FleetStore::find(const std::string& monitor, uint8_t sensor) const {
+    for (size_t i = 0; i < series_.size(); ++i) {
+        if (series_[i].monitor == monitor && series_[i].sensor == sensor) return (int)i;
+    }
+    return -1;
+}
+
+int FleetStore::findSeries(const std::string& monitor, uint8_t sensor) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return find(monitor, sensor);
+}
+
+int FleetStore::seriesId(const std::string& monitor, uint8_t sensor) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    int id = find(monitor, sensor);
+    if (id >= 0) return id;
+    if (!catalog_ || series_.size() > UINT16_MAX) return -1;
+
+    Series series;
+    series.monitor = monitor;
+    series.sensor = sensor;
+    series_.push_back(series);
+    fprintf(catalog_, "%u %s %u\n", (unsigned)(series_.size() - 1), monitor.c_str(), (unsigned)sensor);
+    fflush(catalog_);
+    return (int)series_.size() - 1;
+}
+
+bool FleetStore::cursor(int id, uint32_t& seq) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (id < 0 || (size_t)id >= series_.size() || !series_[id].hasSeq) return false;
+    seq = series_[id].lastSeq;
+    return true;
+}
+
+bool FleetStore::append(int id, const ExportRecord* records, size_t count) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (id < 0 || (size_t)id >= series_.size() || !data_) return false;
+
+    // Written in one go, so a batch costs one write call however large it is
+    std::vector<StoredRecord> batch(count);
+    for (size_t i = 0; i < count; ++i) {
+        batch[i].series = (uint16_t)id;
+        batch[i].reserved = 0;
+        batch[i].record = records[i];
+        add(series_[id], records[i]);
+    }
+    if (fwrite(batch.data(), sizeof(StoredRecord), count, data_) != count) return false;
+    return fflush(data_) == 0;
+}
+
+uint32_t FleetStore::generation(int id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return id >= 0 && (size_t)id < series_.size() ? series_[id].generation : 0;
+}
+
+size_t FleetStore::seriesCount() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return series_.size();
+}
+
+size_t FleetStore::recordCount() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return records_;
+}
+
+bool FleetStore::range(int id, uint32_t& first, uint32_t& last) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (id < 0 || (size_t)id >= series_.size() || series_[id].records.empty()) return false;
+    first = series_[id].records.front().timestamp;
+    last = series_[id].records.back().timestamp;
+    return true;
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <algorithm>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "ExportFormat.h"
+
+// Description: The gateway's time-series store. Every sample pulled from any monitor is
+// appended to one file as a fixed 16-byte record tagged with its series, so a crash can
+// at most cut the last record short. Series (one per monitor and sensor) are listed in
+// a small text catalog next to it, "<path>.series". open() reads both back into memory,
+// where each series is a vector ordered by time; queries never touch the file.
+//
+// All methods are thread-safe: pull workers append while the HTTP thread queries.
+class FleetStore {
+public:
+    struct Series {
+        std::string monitor;
+        uint8_t sensor;                      // 1-based, as on the monitor
+        std::vector<ExportRecord> records;   // Oldest first
+        uint32_t generation = 0;             // Bumped on every append, for caches
+        uint32_t lastSeq = 0;                // Newest sample received, valid if hasSeq
+        bool hasSeq = false;
+    };
+
+    ~FleetStore();
+
+    bool open(const std::string& path);
+
+    // Returns the id of the series of `monitor`'s sensor, adding it if it is new. Monitor
+    // names must not contain whitespace.
+    int seriesId(const std::string& monitor, uint8_t sensor);
+    int findSeries(const std::string& monitor, uint8_t sensor);
+
+    // Sequence number of the newest stored sample, the cursor for the next pull. Returns
+    // false if the series is empty.
+    bool cursor(int id, uint32_t& seq);
+
+    // Appends samples pulled from the monitor, in the order received.
+    bool append(int id, const ExportRecord* records, size_t count);
+
+    uint32_t generation(int id);
+    size_t seriesCount();
+    size_t recordCount();
+
+    // Calls fn(const ExportRecord&) for every sample of series `id` with a timestamp in
+    // [from, to], oldest first, holding the store lock.
+    template <typename Fn>
+    void forEach(int id, uint32_t from, uint32_t to, Fn fn);
+
+    // Timestamps of the oldest and newest sample; false if the series is empty.
+    bool range(int id, uint32_t& first, uint32_t& last);
+
+private:
+    struct StoredRecord {
+        uint16_t series;
+        uint16_t reserved;
+        ExportRecord record;
+    };
+    static_assert(sizeof(StoredRecord) == 16, "StoredRecord must match the file format");
+
+    void add(Series& series, const ExportRecord& record);
+    int find(const std::string& monitor, uint8_t sensor) const;
+
+    std::mutex mutex_;
+    std::string path_;
+    FILE* data_ = nullptr;
+    FILE* catalog_ = nullptr;
+    std::vector<Series> series_;
+    size_t records_ = 0;
+};
+
+template <typename Fn>
+void FleetStore::forEach(int id, uint32_t from, uint32_t to, Fn fn) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (id < 0 || (size_t)id >= series_.size()) return;
+    const std::vector<ExportRecord>& records = series_[id].records;
+    auto byTime = [](const ExportRecord& rec, uint32_t t) { return rec.timestamp < t; };
+    for (auto it = std::lower_bound(records.begin(), records.end(), from, byTime);
+         it != records.end() && it->timestamp <= to; ++it) {
+        fn(*it);
+    }
+}
@@ -0,0 +1,103 @@
+#include "HttpFetch.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+static const size_t MAX_RESPONSE_BYTES = 64 * 1024 * 1024;
+
+// Description: Connects with a timeout: a blocking connect() to a board that is switched
+// off would wait for the kernel's SYN retries, over a minute.
+static int connectTo(const std::string& host, uint16_t port, unsigned timeoutMillis, std::string& error) {
+    addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* addresses = nullptr;
+    char service[8];
+    snprintf(service, sizeof(service), "%u", (unsigned)port);
+    int rc = getaddrinfo(host.c_str(), service, &hints, &addresses);
+    if (rc != 0) {
+        error = gai_strerror(rc);
+        return -1;
+    }
+
+    int fd = -1;
+    for (addrinfo* ai = addresses; ai && fd < 0; ai = ai->ai_next) {
+        fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd < 0) continue;
+        int flags = fcntl(fd, F_GETFL, 0);
+        fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+        if (connect(fd, ai->ai_addr, ai->ai_addrlen) != 0) {
+            int err = errno;
+            if (err == EINPROGRESS) {
+                pollfd p = {fd, POLLOUT, 0};
+                socklen_t len = sizeof(err);
+                if (poll(&p, 1, timeoutMillis) != 1) err = ETIMEDOUT;
+                else if (getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len) != 0) err = errno;
+            }
+            if (err != 0) {
+                error = strerror(err);
+                close(fd);
+                fd = -1;
+                continue;
+            }
+        }
+        fcntl(fd, F_SETFL, flags);
+    }
+    freeaddrinfo(addresses);
+    if (fd < 0) return -1;
+
+    timeval tv = {(time_t)(timeoutMillis / 1000), (suseconds_t)(timeoutMillis % 1000 * 1000)};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    return fd;
+}
+
+int httpGet(const std::string& host, uint16_t port, const std::string& target, unsigned timeoutMillis,
+            std::string& body, std::string& error) {
+    body.clear();
+    int fd = connectTo(host, port, timeoutMillis, error);
+    if (fd < 0) return -1;
+
+    std::string request = "GET " + target + " HTTP/1.0\r\nHost: " + host + "\r\n\r\n";
+    if (send(fd, request.data(), request.size(), MSG_NOSIGNAL) != (ssize_t)request.size()) {
+        error = "send failed";
+        close(fd);
+        return -1;
+    }
+
+    std::string response;
+    char chunk[16384];
+    for (;;) {
+        ssize_t n = recv(fd, chunk, sizeof(chunk), 0);
+        if (n == 0) break;
+        if (n < 0 || response.size() > MAX_RESPONSE_BYTES) {
+            error = n < 0 ? (errno == EAGAIN || errno == EWOULDBLOCK ? "timed out" : strerror(errno)) : "response too large";
+            close(fd);
+            return -1;
+        }
+        response.append(chunk, n);
+    }
+    close(fd);
+
+    size_t headEnd = response.find("\r\n\r\n");
+    if (response.compare(0, 5, "HTTP/") != 0 || headEnd == std::string::npos) {
+        error = "malformed response";
+        return -1;
+    }
+    size_t space = response.find(' ');
+    body.assign(response, headEnd + 4, std::string::npos);
+    return atoi(response.c_str() + space + 1);
+}
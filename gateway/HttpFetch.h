@@ -0,0 +1,12 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+
+// Description: Fetches `target` (path and query) from a monitor with a plain HTTP/1.0
+// GET. The board's server then sends the body as is and closes the connection, so no
+// chunked decoding is needed. Every step (connect, send, each receive) gives up after
+// `timeoutMillis`. Returns the status code and fills `body`, or returns -1 and fills
+// `error` if the monitor could not be reached.
+int httpGet(const std::string& host, uint16_t port, const std::string& target, unsigned timeoutMillis,
+            std::string& body, std::string& error);
@@ -0,0 +1,75 @@
+#include "SimulatedMonitor.h"
+
+SimulatedMonitor::SimulatedMonitor(uint32_t seed, uint32_t interval, uint32_t firstRound)
+    : sensors_{
+          // name     pin  dry threshold  air   water  files
+          {"Fern",    34,  2000,          3200, 1300,  ""},
+          {"Basil",   35,  2000,          3200, 1300,  ""},
+      },
+      interval_(interval),
+      nextRound_(firstRound - firstRound % interval),
+      // Sequence numbers follow from the time, so they carry on across restarts of the
+      // gateway as a board's do across its reboots
+      nextSeq_(nextRound_ / interval) {
+    TraceOptions options;
+    options.seed = seed;
+    for (size_t i = 0; i < SENSORS; ++i) traces_.emplace_back(sensors_[i], i, options);
+
+    server_.on("/config.json", [this]() { handleConfig(); });
+    server_.on("/export", [this]() { handleExport(); });
+}
+
+void SimulatedMonitor::update(uint32_t now) {
+    for (; nextRound_ <= now; nextRound_ += interval_) {
+        // Both sensors are read in the same round and share its sequence number range
+        for (size_t i = 0; i < SENSORS; ++i) {
+            std::vector<ExportRecord>& records = records_[i];
+            records.push_back({nextSeq_, nextRound_, (int16_t)traces_[i].next(nextRound_, interval_), 0});
+            if (records.size() > 2 * RETENTION) records.erase(records.begin(), records.begin() + RETENTION);
+        }
+        nextSeq_++;
+    }
+    server_.handleClient();
+}
+
+void SimulatedMonitor::handleConfig() {
+    String body = "{\"productionMode\":true,\"logIntervalSeconds\":" + String(interval_) + ",\"sensors\":[";
+    for (size_t i = 0; i < SENSORS; ++i) {
+        char sensor[128];
+        snprintf(sensor, sizeof(sensor), "%s{\"id\":%u,\"name\":\"%s\",\"dryThreshold\":%d}", i ? "," : "",
+                 (unsigned)(i + 1), sensors_[i].name, sensors_[i].dryThreshold);
+        body += sensor;
+    }
+    body += "]}";
+    server_.send(200, "application/json", body.c_str());
+}
+
+// Description: Same parameters and cursor rules as the firmware's handleExport().
+void SimulatedMonitor::handleExport() {
+    long sensor = server_.arg("sensor").toInt();
+    if (sensor < 1 || sensor > (long)SENSORS) {
+        server_.send(404, "text/plain", "Unknown sensor");
+        return;
+    }
+    const std::vector<ExportRecord>& records = records_[sensor - 1];
+
+    uint32_t firstSeq = records.empty() ? nextSeq_ : records.front().seq;
+    uint32_t fromSeq = firstSeq;
+    if (server_.hasArg("after")) {
+        uint32_t after = strtoul(server_.arg("after").c_str(), nullptr, 10);
+        if (after < nextSeq_ && after >= fromSeq) fromSeq = after + 1;
+    }
+    uint32_t toSeq = nextSeq_;
+    if (server_.hasArg("limit")) {
+        uint32_t limit = strtoul(server_.arg("limit").c_str(), nullptr, 10);
+        if (toSeq - fromSeq > limit) toSeq = fromSeq + limit;
+    }
+
+    ExportHeader header = {EXPORT_MAGIC, EXPORT_VERSION, (uint8_t)sensor, sizeof(ExportRecord), fromSeq, toSeq};
+    server_.setContentLength(sizeof(header) + (toSeq - fromSeq) * sizeof(ExportRecord));
+    server_.send(200, "application/octet-stream", "");
+    server_.sendContent((const char*)&header, sizeof(header));
+    if (toSeq > fromSeq) {
+        server_.sendContent((const char*)&records[fromSeq - firstSeq], (toSeq - fromSeq) * sizeof(ExportRecord));
+    }
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stdint.h>
+#include <vector>
+#include "ExportFormat.h"
+#include "HttpServer.h"
+#include "SensorConfig.h"
+#include "TraceGenerator.h"
+
+// Description: A stand-in for one monitor board, for testing the gateway on localhost. It
+// serves /config.json and /export as the firmware does, with samples from synthetic
+// traces produced in virtual time, and keeps only the newest RETENTION samples per
+// sensor as the board's ring does.
+class SimulatedMonitor {
+public:
+    static const size_t SENSORS = 2;
+    static const size_t RETENTION = 20000;
+
+    // The first sampling round is at epoch `firstRound`; update() catches up from there.
+    SimulatedMonitor(uint32_t seed, uint32_t interval, uint32_t firstRound);
+
+    // Listens on a free port on localhost.
+    bool begin() { return server_.begin(0); }
+    uint16_t port() const { return server_.port(); }
+
+    // Takes every sampling round due up to epoch `now`, then answers waiting requests.
+    void update(uint32_t now);
+
+private:
+    void handleConfig();
+    void handleExport();
+
+    HttpServer server_;
+    SensorConfig sensors_[SENSORS];
+    std::vector<TraceGenerator> traces_;
+    std::vector<ExportRecord> records_[SENSORS];
+    uint32_t interval_;
+    uint32_t nextRound_;
+    uint32_t nextSeq_;
+};
@@ -0,0 +1,335 @@
+// Fleet gateway: pulls the history of many monitors into one local store and serves a
+// combined dashboard and query API. Built by the `gateway` environment against the host
+// stand-ins in host/, reusing the firmware's HTTP server, downsampler and export format:
+//   pio run -e gateway
+//   .pio/build/gateway/program --monitor kitchen=192.168.1.40 --monitor office=192.168.1.41
+//
+// Options:
+//   --monitor NAME=HOST[:PORT]  a monitor to pull (repeatable; names must be unique and
+//                               contain no whitespace)
+//   --config FILE               more monitors, one "NAME HOST[:PORT]" per line
+//   --port P                    port to serve on (default 8080)
+//   --data FILE                 store file (default fleet.tsdb, plus fleet.tsdb.series)
+//   --workers N                 monitors pulled side by side (default 8)
+//   --interval S                seconds between pulls of each monitor (default 60)
+//   --simulate N                also start N simulated monitors on localhost
+//   --sim-speed X               simulated seconds per real second (default 600)
+//
+// API:
+//   /api/monitors     JSON: every monitor with its sensors and pull status, store and
+//                     cache counters
+//   /api/series?monitor=NAME&sensor=N[&hours=H | &from=&to=][&points=P]
+//                     "start,min,max,mean" buckets, as the firmware's /series. `hours`
+//                     is counted back from the newest sample, so every browser showing
+//                     the same window shares one cached view.
+
+#include <Arduino.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <time.h>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <thread>
+#include "Downsample.h"
+#include "FleetDashboard.h"
+#include "FleetPuller.h"
+#include "FleetStore.h"
+#include "HttpServer.h"
+#include "SimulatedMonitor.h"
+#include "WebAssets.h"
+
+static const uint32_t SERIES_DEFAULT_POINTS = 200;
+static const uint32_t SERIES_MAX_POINTS = 1000;
+static const size_t VIEW_CACHE_ENTRIES = 256;
+static const uint16_t MONITOR_PORT = 80;
+static const uint32_t SIM_INTERVAL = 600;          // Simulated monitors log every 10 minutes
+static const uint32_t SIM_BACKLOG_DAYS = 7;        // History they already hold at start
+
+struct GatewayOptions {
+    uint16_t port = 8080;
+    std::string data = "fleet.tsdb";
+    size_t workers = 8;
+    unsigned interval = 60;
+    uint32_t simulate = 0;
+    double simSpeed = 600;
+    std::vector<MonitorConfig> monitors;
+};
+
+// Description: A downsampled view as sent to browsers, valid while its series has not
+// changed since.
+struct CachedView {
+    uint32_t generation;
+    unsigned long lastUsed;
+    std::string body;
+};
+
+static HttpServer server(8080);
+static FleetStore store;
+static FleetPuller puller(store);
+static std::map<std::string, CachedView> viewCache;
+static uint32_t cacheHits = 0;
+static uint32_t cacheMisses = 0;
+static uint32_t notModified = 0;
+static std::atomic<bool> stopping(false);
+
+static bool parseMonitor(const std::string& name, const std::string& address, MonitorConfig& monitor) {
+    if (name.empty() || name.find_first_of(" \t\"") != std::string::npos || address.empty()) return false;
+    monitor.name = name;
+    monitor.port = MONITOR_PORT;
+    size_t colon = address.rfind(':');
+    if (colon != std::string::npos && address.find(':') == colon) {
+        monitor.host = address.substr(0, colon);
+        monitor.port = (uint16_t)strtoul(address.c_str() + colon + 1, nullptr, 10);
+    } else {
+        monitor.host = address;
+    }
+    return monitor.port != 0;
+}
+
+static bool parseOptions(int argc, char** argv, GatewayOptions& options) {
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string name = argv[i];
+        std::string value = argv[i + 1];
+        if (name == "--monitor") {
+            MonitorConfig monitor;
+            size_t eq = value.find('=');
+            if (eq == std::string::npos || !parseMonitor(value.substr(0, eq), value.substr(eq + 1), monitor)) return false;
+            options.monitors.push_back(monitor);
+        } else if (name == "--config") {
+            std::ifstream file(value);
+            if (!file) return false;
+            std::string line;
+            while (std::getline(file, line)) {
+                std::istringstream fields(line);
+                std::string monitorName, address;
+                if (!(fields >> monitorName >> address) || monitorName[0] == '#') continue;
+                MonitorConfig monitor;
+                if (!parseMonitor(monitorName, address, monitor)) return false;
+                options.monitors.push_back(monitor);
+            }
+        } else if (name == "--port") {
+            options.port = (uint16_t)strtoul(value.c_str(), nullptr, 10);
+        } else if (name == "--data") {
+            options.data = value;
+        } else if (name == "--workers") {
+            options.workers = strtoul(value.c_str(), nullptr, 10);
+        } else if (name == "--interval") {
+            options.interval = strtoul(value.c_str(), nullptr, 10);
+        } else if (name == "--simulate") {
+            options.simulate = strtoul(value.c_str(), nullptr, 10);
+        } else if (name == "--sim-speed") {
+            options.simSpeed = strtod(value.c_str(), nullptr);
+        } else {
+            return false;
+        }
+    }
+    if (argc % 2 == 0) return false;
+
+    for (size_t i = 0; i < options.monitors.size(); ++i) {
+        for (size_t j = 0; j < i; ++j) {
+            if (options.monitors[i].name == options.monitors[j].name) return false;
+        }
+    }
+    return options.workers > 0 && options.interval > 0 && options.simSpeed > 0;
+}
+
+static std::string jsonString(const std::string& s) {
+    std::string out = "\"";
+    for (char c : s) {
+        if (c == '"' || c == '\\') out += '\\';
+        if ((unsigned char)c >= 0x20) out += c;
+    }
+    return out + "\"";
+}
+
+static void serveAsset(const WebAsset& asset) {
+    server.sendHeader("ETag", asset.etag);
+    server.sendHeader("Cache-Control", asset.cacheControl);
+    if (server.header("If-None-Match") == asset.etag) {
+        server.send(304);
+        return;
+    }
+    server.sendHeader("Content-Encoding", "gzip");
+    server.send_P(200, asset.contentType, (const char*)asset.data, asset.length);
+}
+
+static void handleMonitors() {
+    std::vector<MonitorStatus> monitors = puller.status();
+    unsigned long now = millis();
+
+    std::string out = "{\"records\":" + std::to_string(store.recordCount()) +
+                      ",\"series\":" + std::to_string(store.seriesCount()) +
+                      ",\"cache\":{\"hits\":" + std::to_string(cacheHits) + ",\"misses\":" + std::to_string(cacheMisses) +
+                      ",\"notModified\":" + std::to_string(notModified) + "},\"monitors\":[";
+    for (size_t i = 0; i < monitors.size(); ++i) {
+        const MonitorStatus& m = monitors[i];
+        out += (i ? ",{" : "{");
+        out += "\"name\":" + jsonString(m.config.name);
+        out += ",\"address\":" + jsonString(m.config.host + ":" + std::to_string(m.config.port));
+        out += ",\"reachable\":" + std::string(m.reachable ? "true" : "false");
+        out += ",\"error\":" + jsonString(m.lastError);
+        out += ",\"lastPullSecondsAgo\":" + (m.lastPullMillis ? std::to_string((now - m.lastPullMillis) / 1000) : "null");
+        out += ",\"pulls\":" + std::to_string(m.pulls) + ",\"failures\":" + std::to_string(m.failures);
+        out += ",\"records\":" + std::to_string(m.records) + ",\"sensors\":[";
+        for (size_t s = 0; s < m.sensors.size(); ++s) {
+            out += (s ? ",{" : "{");
+            out += "\"name\":" + jsonString(m.sensors[s].name) +
+                   ",\"dryThreshold\":" + std::to_string(m.sensors[s].dryThreshold) + "}";
+        }
+        out += "]}";
+    }
+    out += "]}";
+
+    server.sendHeader("Cache-Control", "no-cache");
+    server.send(200, "application/json", out.c_str());
+}
+
+// Description: Drops the least recently used views once the cache is full.
+static void trimViewCache() {
+    while (viewCache.size() > VIEW_CACHE_ENTRIES) {
+        auto oldest = viewCache.begin();
+        for (auto it = viewCache.begin(); it != viewCache.end(); ++it) {
+            if (it->second.lastUsed < oldest->second.lastUsed) oldest = it;
+        }
+        viewCache.erase(oldest);
+    }
+}
+
+// Description: Serves a downsampled view of one series. Views are cached by their
+// parameters and tagged with the series generation: a browser that already has the
+// current view gets 304, and other browsers get the cached body until a new pull
+// changes the series.
+static void handleSeries() {
+    int id = store.findSeries(server.arg("monitor").c_str(), (uint8_t)server.arg("sensor").toInt());
+    if (id < 0) {
+        server.send(404, "text/plain", "Unknown monitor or sensor");
+        return;
+    }
+
+    uint32_t generation = store.generation(id);
+    std::string etag = "\"" + std::to_string(generation) + "\"";
+    server.sendHeader("ETag", etag.c_str());
+    server.sendHeader("Cache-Control", "no-cache");
+    if (server.header("If-None-Match") == etag.c_str()) {
+        notModified++;
+        server.send(304);
+        return;
+    }
+
+    std::string key = std::to_string(id);
+    const char* params[] = {"hours", "from", "to", "points"};
+    for (const char* param : params) key += std::string("|") + server.arg(param).c_str();
+    auto cached = viewCache.find(key);
+    if (cached != viewCache.end() && cached->second.generation == generation) {
+        cacheHits++;
+        cached->second.lastUsed = millis();
+        server.send(200, "text/plain", cached->second.body.c_str());
+        return;
+    }
+    cacheMisses++;
+
+    uint32_t first = 0, last = 0;
+    store.range(id, first, last);
+    uint32_t from = first, to = last;
+    if (server.hasArg("hours")) {
+        uint32_t span = strtoul(server.arg("hours").c_str(), nullptr, 10) * 3600;
+        from = last > span ? last - span : 0;
+    }
+    if (server.hasArg("from")) from = strtoul(server.arg("from").c_str(), nullptr, 10);
+    if (server.hasArg("to")) to = strtoul(server.arg("to").c_str(), nullptr, 10);
+    uint32_t points = SERIES_DEFAULT_POINTS;
+    if (server.hasArg("points")) points = strtoul(server.arg("points").c_str(), nullptr, 10);
+    if (points == 0 || points > SERIES_MAX_POINTS) points = SERIES_MAX_POINTS;
+
+    std::string body;
+    BucketDownsampler buckets(from, to, points);
+    SeriesBucket bucket;
+    auto emit = [&]() {
+        char line[64];
+        snprintf(line, sizeof(line), "%lu,%d,%d,%.1f\n", (unsigned long)bucket.start, bucket.min, bucket.max, bucket.mean);
+        body += line;
+    };
+    store.forEach(id, from, to, [&](const ExportRecord& rec) {
+        if (buckets.add(rec.timestamp, rec.value, bucket)) emit();
+    });
+    if (buckets.finish(bucket)) emit();
+
+    CachedView& view = viewCache[key];
+    view.generation = generation;
+    view.lastUsed = millis();
+    view.body = body;
+    trimViewCache();
+    server.send(200, "text/plain", body.c_str());
+}
+
+static void onSignal(int) { stopping = true; }
+
+int main(int argc, char** argv) {
+    GatewayOptions options;
+    if (!parseOptions(argc, argv, options)) {
+        fprintf(stderr, "usage: %s [--monitor NAME=HOST[:PORT]]... [--config FILE] [--port P] [--data FILE]\n"
+                        "       [--workers N] [--interval S] [--simulate N] [--sim-speed X]\n", argv[0]);
+        return 2;
+    }
+    if (!store.open(options.data)) {
+        perror(options.data.c_str());
+        return 1;
+    }
+
+    // Simulated monitors start with SIM_BACKLOG_DAYS of history, then run in virtual time
+    uint32_t simStart = (uint32_t)time(nullptr);
+    std::vector<std::unique_ptr<SimulatedMonitor>> simulated;
+    for (uint32_t i = 0; i < options.simulate; ++i) {
+        simulated.emplace_back(new SimulatedMonitor(i + 1, SIM_INTERVAL, simStart - SIM_BACKLOG_DAYS * TraceGenerator::SECONDS_PER_DAY));
+        if (!simulated.back()->begin()) return 1;
+        MonitorConfig monitor = {"sim" + std::to_string(i + 1), "127.0.0.1", simulated.back()->port()};
+        options.monitors.push_back(monitor);
+    }
+    std::thread simulator([&simulated, &options, simStart]() {
+        auto begun = std::chrono::steady_clock::now();
+        while (!stopping && !simulated.empty()) {
+            double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - begun).count();
+            uint32_t now = simStart + (uint32_t)(elapsed * options.simSpeed);
+            for (auto& monitor : simulated) monitor->update(now);
+            std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        }
+    });
+
+    for (size_t i = 0; i < WEB_ASSET_COUNT; ++i) {
+        const WebAsset& asset = WEB_ASSETS[i];
+        if (strcmp(asset.path, "/") != 0) server.on(asset.path, [&asset]() { serveAsset(asset); });
+    }
+    server.on("/", []() {
+        server.sendHeader("Cache-Control", "no-cache");
+        server.send_P(200, "text/html", FLEET_DASHBOARD, sizeof(FLEET_DASHBOARD) - 1);
+    });
+    server.on("/api/monitors", handleMonitors);
+    server.on("/api/series", handleSeries);
+    const char* headerKeys[] = {"If-None-Match"};
+    server.collectHeaders(headerKeys, 1);
+    if (!server.begin(options.port)) {
+        fprintf(stderr, "Cannot listen on port %u\n", (unsigned)options.port);
+        stopping = true;
+        simulator.join();
+        return 1;
+    }
+
+    for (const MonitorConfig& monitor : options.monitors) puller.add(monitor);
+    puller.start(options.workers, options.interval * 1000);
+    printf("Serving %u monitors on http://localhost:%u/, storing to %s\n", (unsigned)options.monitors.size(),
+           (unsigned)server.port(), options.data.c_str());
+    fflush(stdout);
+
+    signal(SIGINT, onSignal);
+    signal(SIGTERM, onSignal);
+    signal(SIGPIPE, SIG_IGN);
+    while (!stopping) server.handleClient(50);
+
+    puller.stop();
+    simulator.join();
+    return 0;
+}
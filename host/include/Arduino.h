@@ -0,0 +1,186 @@
+#pragma once
+// Host stand-in for the subset of the Arduino core used by the firmware.
+
+#include <cstdarg>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+#define PROGMEM
+#define RTC_NOINIT_ATTR
+
+class String {
+public:
+    String() {}
+    String(const char* s) : s_(s ? s : "") {}
+    String(const std::string& s) : s_(s) {}
+    String(char c) : s_(1, c) {}
+    String(int v) : s_(std::to_string(v)) {}
+    String(unsigned int v) : s_(std::to_string(v)) {}
+    String(long v) : s_(std::to_string(v)) {}
+    String(unsigned long v) : s_(std::to_string(v)) {}
+    String(long long v) : s_(std::to_string(v)) {}
+    String(unsigned long long v) : s_(std::to_string(v)) {}
+    String(float v, unsigned decimals = 2) : String((double)v, decimals) {}
+    String(double v, unsigned decimals = 2) {
+        char buf[48];
+        snprintf(buf, sizeof(buf), "%.*f", (int)decimals, v);
+        s_ = buf;
+    }
+
+    const char* c_str() const { return s_.c_str(); }
+    unsigned int length() const { return (unsigned int)s_.size(); }
+    bool isEmpty() const { return s_.empty(); }
+    bool reserve(unsigned int n) { s_.reserve(n); return true; }
+    char operator[](unsigned int i) const { return i < s_.size() ? s_[i] : 0; }
+    char charAt(unsigned int i) const { return (*this)[i]; }
+
+    String& operator+=(const String& o) { s_ += o.s_; return *this; }
+    String& operator+=(const char* o) { s_ += o ? o : ""; return *this; }
+    String& operator+=(char c) { s_ += c; return *this; }
+    bool concat(const char* p, unsigned int n) { s_.append(p, n); return true; }
+    bool concat(const String& o) { s_ += o.s_; return true; }
+
+    bool operator==(const String& o) const { return s_ == o.s_; }
+    bool operator==(const char* o) const { return s_ == (o ? o : ""); }
+    bool operator!=(const String& o) const { return s_ != o.s_; }
+    bool operator!=(const char* o) const { return !(*this == o); }
+    bool operator<(const String& o) const { return s_ < o.s_; }
+
+    int indexOf(char c, unsigned int from = 0) const {
+        size_t p = s_.find(c, from);
+        return p == std::string::npos ? -1 : (int)p;
+    }
+    int indexOf(const char* c, unsigned int from = 0) const {
+        size_t p = s_.find(c, from);
+        return p == std::string::npos ? -1 : (int)p;
+    }
+    String substring(unsigned int from) const { return from >= s_.size() ? String() : String(s_.substr(from)); }
+    String substring(unsigned int from, unsigned int to) const {
+        if (from >= s_.size() || to <= from) return String();
+        return String(s_.substr(from, to - from));
+    }
+    void replace(const String& from, const String& to) {
+        if (from.s_.empty()) return;
+        size_t p = 0;
+        while ((p = s_.find(from.s_, p)) != std::string::npos) {
+            s_.replace(p, from.s_.size(), to.s_);
+            p += to.s_.size();
+        }
+    }
+    void trim() {
+        size_t b = s_.find_first_not_of(" \t\r\n");
+        size_t e = s_.find_last_not_of(" \t\r\n");
+        s_ = (b == std::string::npos) ? std::string() : s_.substr(b, e - b + 1);
+    }
+    long toInt() const { return strtol(s_.c_str(), nullptr, 10); }
+    float toFloat() const { return strtof(s_.c_str(), nullptr); }
+    bool startsWith(const String& p) const { return s_.compare(0, p.s_.size(), p.s_) == 0; }
+
+    const std::string& str() const { return s_; }
+
+private:
+    std::string s_;
+};
+
+inline String operator+(const String& a, const String& b) { String r(a); r += b; return r; }
+inline String operator+(const String& a, const char* b) { String r(a); r += b; return r; }
+inline String operator+(const char* a, const String& b) { String r(a); r += b; return r; }
+inline String operator+(const String& a, char b) { String r(a); r += b; return r; }
+inline bool operator==(const char* a, const String& b) { return b == a; }
+
+class Print;
+
+class Printable {
+public:
+    virtual ~Printable() {}
+    virtual size_t printTo(Print& p) const = 0;
+};
+
+class Print {
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) { return write(&c, 1); }
+    virtual size_t write(const uint8_t* buf, size_t size) = 0;
+    size_t write(const char* s) { return write((const uint8_t*)s, strlen(s)); }
+
+    size_t print(const String& s) { return write((const uint8_t*)s.c_str(), s.length()); }
+    size_t print(const char* s) { return write(s); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(int v) { return print(String(v)); }
+    size_t print(unsigned int v) { return print(String(v)); }
+    size_t print(long v) { return print(String(v)); }
+    size_t print(unsigned long v) { return print(String(v)); }
+    size_t print(double v, int d = 2) { return print(String(v, d)); }
+    size_t print(const Printable& v) { return v.printTo(*this); }
+    template <typename T> size_t println(const T& v) { size_t n = print(v); return n + write("\r\n"); }
+    size_t println() { return write("\r\n"); }
+
+    // Like the ESP32 core: lines longer than 64 bytes are formatted on the heap
+    size_t printf(const char* fmt, ...) __attribute__((format(printf, 2, 3))) {
+        char buf[64];
+        va_list ap;
+        va_start(ap, fmt);
+        int n = vsnprintf(buf, sizeof(buf), fmt, ap);
+        va_end(ap);
+        if (n < 0) return 0;
+        if ((size_t)n < sizeof(buf)) return write((const uint8_t*)buf, n);
+        std::vector<char> big(n + 1);
+        va_start(ap, fmt);
+        vsnprintf(big.data(), big.size(), fmt, ap);
+        va_end(ap);
+        return write((const uint8_t*)big.data(), n);
+    }
+};
+
+class Stream : public Print {
+public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+    String readStringUntil(char terminator) {
+        std::string out;
+        int c;
+        while ((c = read()) >= 0 && c != terminator) out += (char)c;
+        return String(out);
+    }
+};
+
+class HardwareSerial : public Stream {
+public:
+    void begin(unsigned long) {}
+    size_t write(const uint8_t* buf, size_t size) override {
+        if (quiet) return size;
+        return fwrite(buf, 1, size, stdout);
+    }
+    int available() override { return 0; }
+    int read() override { return -1; }
+    int peek() override { return -1; }
+    bool quiet = false;
+};
+
+extern HardwareSerial Serial;
+
+// Heap figures of a typical ESP32 with Wi-Fi up; the host has no comparable numbers.
+class EspClass {
+public:
+    uint32_t getFreeHeap() const { return 180000; }
+    uint32_t getMinFreeHeap() const { return 150000; }
+    uint32_t getMaxAllocHeap() const { return 110000; }
+};
+
+extern EspClass ESP;
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+int analogRead(uint8_t pin);
+
+// When set, analogRead() returns what this gives instead of a synthetic reading, e.g. a
+// replayed trace.
+extern int (*hostAnalogRead)(uint8_t pin);
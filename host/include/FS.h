@@ -0,0 +1,123 @@
+#pragma once
+// Host stand-in for the ESP32 Arduino fs::FS / fs::File API, backed by memory.
+
+#include <Arduino.h>
+#include <map>
+#include <memory>
+
+#define FILE_READ "r"
+#define FILE_WRITE "w"
+#define FILE_APPEND "a"
+
+namespace fs {
+
+enum SeekMode { SeekSet = 0, SeekCur = 1, SeekEnd = 2 };
+
+struct FileData {
+    std::vector<uint8_t> bytes;
+};
+
+class File : public Stream {
+public:
+    File() {}
+    File(std::shared_ptr<FileData> data, bool readable, bool writable, bool append, size_t* bytesWritten)
+        : data_(data), readable_(readable), writable_(writable), append_(append), bytesWritten_(bytesWritten) {}
+
+    explicit operator bool() const { return (bool)data_; }
+
+    size_t write(const uint8_t* buf, size_t size) override {
+        if (!data_ || !writable_) return 0;
+        if (append_) pos_ = data_->bytes.size();
+        if (pos_ + size > data_->bytes.size()) data_->bytes.resize(pos_ + size);
+        memcpy(data_->bytes.data() + pos_, buf, size);
+        pos_ += size;
+        if (bytesWritten_) *bytesWritten_ += size;
+        return size;
+    }
+    using Print::write;
+
+    size_t read(uint8_t* buf, size_t size) {
+        if (!data_ || !readable_) return 0;
+        size_t n = std::min(size, data_->bytes.size() - std::min(pos_, data_->bytes.size()));
+        if (n) memcpy(buf, data_->bytes.data() + pos_, n);
+        pos_ += n;
+        return n;
+    }
+    int read() override {
+        uint8_t c;
+        return read(&c, 1) == 1 ? c : -1;
+    }
+    int peek() override {
+        if (!data_ || pos_ >= data_->bytes.size()) return -1;
+        return data_->bytes[pos_];
+    }
+    int available() override {
+        if (!data_ || !readable_ || pos_ >= data_->bytes.size()) return 0;
+        return (int)(data_->bytes.size() - pos_);
+    }
+    bool seek(uint32_t pos, SeekMode mode = SeekSet) {
+        if (!data_) return false;
+        size_t base = mode == SeekSet ? 0 : mode == SeekCur ? pos_ : data_->bytes.size();
+        if (base + pos > data_->bytes.size()) return false;
+        pos_ = base + pos;
+        return true;
+    }
+    size_t position() const { return pos_; }
+    size_t size() const { return data_ ? data_->bytes.size() : 0; }
+    void flush() {}
+    void close() { data_.reset(); }
+
+private:
+    std::shared_ptr<FileData> data_;
+    size_t pos_ = 0;
+    bool readable_ = false;
+    bool writable_ = false;
+    bool append_ = false;
+    size_t* bytesWritten_ = nullptr;
+};
+
+class FS {
+public:
+    File open(const char* path, const char* mode = FILE_READ, bool create = false) {
+        std::string p(path), m(mode);
+        auto it = files_.find(p);
+        bool plus = m.find('+') != std::string::npos;
+        if (m[0] == 'r') {
+            if (it == files_.end()) return File();
+            return File(it->second, true, plus, false, &bytesWritten);
+        }
+        if (it == files_.end() || m[0] == 'w') {
+            files_[p] = std::make_shared<FileData>();
+            it = files_.find(p);
+        }
+        return File(it->second, plus, true, m[0] == 'a', &bytesWritten);
+    }
+    File open(const String& path, const char* mode = FILE_READ) { return open(path.c_str(), mode); }
+    bool exists(const char* path) const { return files_.count(path) != 0; }
+    bool exists(const String& path) const { return exists(path.c_str()); }
+    bool remove(const char* path) { return files_.erase(path) != 0; }
+    bool remove(const String& path) { return remove(path.c_str()); }
+    bool rename(const char* from, const char* to) {
+        auto it = files_.find(from);
+        if (it == files_.end()) return false;
+        files_[to] = it->second;
+        files_.erase(it);
+        return true;
+    }
+
+    // Host-only helpers for tests and benchmarks.
+    std::vector<uint8_t>* raw(const char* path) {
+        auto it = files_.find(path);
+        return it == files_.end() ? nullptr : &it->second->bytes;
+    }
+    void clear() { files_.clear(); }
+    size_t bytesWritten = 0;
+
+protected:
+    std::map<std::string, std::shared_ptr<FileData>> files_;
+};
+
+} // namespace fs
+
+using fs::File;
+using fs::FS;
@@ -0,0 +1,48 @@
+#pragma once
+// Host stand-in for the ESP32 HTTPClient. Requests to http:// URLs are sent over the
+// given WiFiClient, so tests can point a client at a local server; with setReuse(true)
+// the connection stays open for the next request, as on the ESP32. Requests to
+// https:// URLs are only recorded, and answered with the settable `responseCode`.
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <vector>
+
+class HTTPClient {
+public:
+    bool begin(const String& url) { return begin(ownClient_, url); }
+    bool begin(WiFiClient& client, const String& url) {
+        lastUrl = url;
+        client_ = &client;
+        url_ = url.c_str();
+        headers_.clear();
+        return true;
+    }
+    void setReuse(bool reuse) { reuse_ = reuse; }
+    void setTimeout(uint16_t millis) { timeout_ = millis; }
+    void addHeader(const String& name, const String& value) {
+        headers_ += std::string(name.c_str()) + ": " + value.c_str() + "\r\n";
+    }
+    int GET() { return send("GET", nullptr, 0); }
+    int POST(const String& body) { return send("POST", (const uint8_t*)body.c_str(), body.length()); }
+    int POST(uint8_t* body, size_t len) { return send("POST", body, len); }
+    void end() {
+        if (client_ && (!reuse_ || !keepAlive_)) client_->stop();
+    }
+
+    static String lastUrl;
+    static String lastBody;
+    static int responseCode;
+    static int requests;
+
+private:
+    int send(const char* method, const uint8_t* body, size_t len);
+
+    WiFiClient ownClient_;
+    WiFiClient* client_ = nullptr;
+    std::string url_;
+    std::string headers_;
+    bool reuse_ = false;
+    bool keepAlive_ = false;
+    uint16_t timeout_ = 5000;
+};
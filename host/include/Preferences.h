@@ -0,0 +1,23 @@
+#pragma once
+// Host stand-in for the ESP32 NVS Preferences store.
+
+#include <Arduino.h>
+#include <map>
+
+class Preferences {
+public:
+    bool begin(const char* ns, bool readOnly = false) { (void)readOnly; ns_ = ns; return true; }
+    void end() {}
+    bool getBool(const char* key, bool def = false) {
+        auto it = store()[ns_].find(key);
+        return it == store()[ns_].end() ? def : it->second != 0;
+    }
+    size_t putBool(const char* key, bool v) { store()[ns_][key] = v; return 1; }
+
+private:
+    static std::map<std::string, std::map<std::string, long>>& store() {
+        static std::map<std::string, std::map<std::string, long>> s;
+        return s;
+    }
+    std::string ns_;
+};
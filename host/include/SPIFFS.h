@@ -0,0 +1,18 @@
+#pragma once
+// Host stand-in for the ESP32 SPIFFS filesystem.
+
+#include <FS.h>
+
+class SPIFFSFS : public fs::FS {
+public:
+    bool begin(bool formatOnFail = false) { (void)formatOnFail; return true; }
+    bool format() { clear(); return true; }
+    size_t totalBytes() const { return 1441792; }
+    size_t usedBytes() const {
+        size_t n = 0;
+        for (const auto& f : files_) n += f.second->bytes.size();
+        return n;
+    }
+};
+
+extern SPIFFSFS SPIFFS;
@@ -0,0 +1,118 @@
+#pragma once
+// Host stand-in for the ESP32 WiFi API. The network is always up, and TCP connections
+// use the host's sockets.
+
+#include <Arduino.h>
+#include <time.h>
+#include <memory>
+#include <netdb.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+typedef enum { WL_IDLE_STATUS = 0, WL_CONNECTED = 3, WL_DISCONNECTED = 6 } wl_status_t;
+
+class IPAddress : public Printable {
+public:
+    String toString() const { return String("127.0.0.1"); }
+    size_t printTo(Print& p) const override { return p.print(toString()); }
+};
+
+// Host stand-in for a TCP connection over a real socket. Copies share the socket, which
+// is closed when the last copy lets go of it, as with the ESP32 WiFiClient.
+class WiFiClient : public Stream {
+public:
+    struct Socket {
+        explicit Socket(int fd) : fd(fd) {}
+        ~Socket() { if (fd >= 0) ::close(fd); }
+        int fd;
+        bool connected = true;
+    };
+
+    WiFiClient() {}
+    explicit WiFiClient(int fd) : socket_(std::make_shared<Socket>(fd)) {}
+
+    // Opens a TCP connection, replacing any current one. Returns 1 on success.
+    int connect(const char* host, uint16_t port) {
+        stop();
+        char service[8];
+        snprintf(service, sizeof(service), "%u", (unsigned)port);
+        struct addrinfo hints = {};
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_STREAM;
+        struct addrinfo* addresses = nullptr;
+        if (getaddrinfo(host, service, &hints, &addresses) != 0) return 0;
+        int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        bool ok = fd >= 0 && ::connect(fd, addresses->ai_addr, addresses->ai_addrlen) == 0;
+        freeaddrinfo(addresses);
+        if (!ok) {
+            if (fd >= 0) ::close(fd);
+            return 0;
+        }
+        socket_ = std::make_shared<Socket>(fd);
+        return 1;
+    }
+
+    size_t write(const uint8_t* buf, size_t size) override {
+        if (!connected()) return 0;
+        size_t sent = 0;
+        while (sent < size) {
+            ssize_t n = ::send(socket_->fd, buf + sent, size - sent, MSG_NOSIGNAL);
+            if (n <= 0) {
+                socket_->connected = false;
+                break;
+            }
+            sent += n;
+        }
+        return sent;
+    }
+    using Print::write;
+    int available() override {
+        int n = 0;
+        if (!socket_ || ioctl(socket_->fd, FIONREAD, &n) != 0) return 0;
+        return n;
+    }
+    // Reads what has arrived, without waiting. Returns -1 if nothing has.
+    int read(uint8_t* buf, size_t size) {
+        if (!socket_) return -1;
+        ssize_t n = recv(socket_->fd, buf, size, MSG_DONTWAIT);
+        return n > 0 ? (int)n : -1;
+    }
+    int read() override {
+        uint8_t c;
+        return read(&c, 1) == 1 ? c : -1;
+    }
+    int peek() override {
+        uint8_t c;
+        if (!socket_ || recv(socket_->fd, &c, 1, MSG_PEEK | MSG_DONTWAIT) != 1) return -1;
+        return c;
+    }
+    uint8_t connected() {
+        if (!socket_ || !socket_->connected) return 0;
+        char c;
+        if (recv(socket_->fd, &c, 1, MSG_PEEK | MSG_DONTWAIT) == 0) socket_->connected = false;
+        return socket_->connected;
+    }
+    void stop() { socket_.reset(); }
+    int fd() const { return socket_ ? socket_->fd : -1; }
+    explicit operator bool() { return connected(); }
+
+private:
+    std::shared_ptr<Socket> socket_;
+};
+
+class WiFiClass {
+public:
+    wl_status_t begin(const char*, const char*) { return status_; }
+    wl_status_t status() const { return status_; }
+    bool disconnect() { return true; }
+    bool reconnect() { return true; }
+    IPAddress localIP() const { return IPAddress(); }
+    int RSSI() const { return -50; }
+    wl_status_t status_ = WL_CONNECTED;
+};
+
+extern WiFiClass WiFi;
+
+void configTime(long gmtOffset, int daylightOffset, const char* server1, const char* server2 = nullptr);
+bool getLocalTime(struct tm* info, uint32_t ms = 5000);
@@ -0,0 +1,10 @@
+#pragma once
+// Host stand-in for WiFiClientSecure. TLS is not emulated.
+
+#include <WiFi.h>
+
+class WiFiClientSecure : public WiFiClient {
+public:
+    void setInsecure() {}
+    void setCACert(const char*) {}
+};
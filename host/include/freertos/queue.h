@@ -0,0 +1,12 @@
+#pragma once
+// Host stand-in for FreeRTOS queues, built on a mutex and condition variable.
+
+#include "FreeRTOS.h"
+
+struct HostQueue;
+typedef HostQueue* QueueHandle_t;
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize);
+BaseType_t xQueueSend(QueueHandle_t queue, const void* item, TickType_t wait);
+BaseType_t xQueueReceive(QueueHandle_t queue, void* item, TickType_t wait);
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue);
@@ -0,0 +1,11 @@
+#pragma once
+// Host stand-in for FreeRTOS mutexes.
+
+#include "FreeRTOS.h"
+
+struct HostSemaphore;
+typedef HostSemaphore* SemaphoreHandle_t;
+
+SemaphoreHandle_t xSemaphoreCreateMutex();
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t wait);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem);
@@ -0,0 +1,22 @@
+#pragma once
+// Host stand-in for the FreeRTOS task API. Each task is a detached std::thread.
+
+#include "FreeRTOS.h"
+
+typedef void (*TaskFunction_t)(void*);
+typedef void* TaskHandle_t;
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char* name, uint32_t stackDepth, void* arg,
+                                   UBaseType_t priority, TaskHandle_t* handle, BaseType_t core);
+TickType_t xTaskGetTickCount();
+void vTaskDelay(TickType_t ticks);
+void vTaskDelayUntil(TickType_t* previousWake, TickType_t increment);
+BaseType_t xPortGetCoreID();
+
+// Host-only: when false, tasks are accepted but never run, so a benchmark can call
+// setup() and time the firmware code on a single thread.
+extern bool hostTasksEnabled;
+
+// Host-only: when set, only the task of this name runs, e.g. the alert dispatcher while a
+// replay drives sampling and storage itself.
+extern const char* hostTaskOnly;
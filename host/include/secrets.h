@@ -0,0 +1,4 @@
+#pragma once
+// The native build never connects anywhere, so it uses the example credentials.
+
+#include "secrets_example.h"
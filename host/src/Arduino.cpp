@@ -0,0 +1,30 @@
+#include <Arduino.h>
+#include <SPIFFS.h>
+#include <WiFi.h>
+#include <chrono>
+#include <thread>
+
+HardwareSerial Serial;
+EspClass ESP;
+SPIFFSFS SPIFFS;
+WiFiClass WiFi;
+
+static const auto bootTime = std::chrono::steady_clock::now();
+
+unsigned long millis() {
+    return (unsigned long)std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - bootTime).count();
+}
+unsigned long micros() {
+    return (unsigned long)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - bootTime).count();
+}
+void delay(unsigned long ms) { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); }
+int (*hostAnalogRead)(uint8_t pin) = nullptr;
+
+int analogRead(uint8_t pin) {
+    if (hostAnalogRead) return hostAnalogRead(pin);
+    return 1800 + (pin % 7) * 10 + (int)(millis() % 50);
+}
+void configTime(long, int, const char*, const char*) {}
+bool getLocalTime(struct tm* info, uint32_t) { time_t t = time(nullptr); localtime_r(&t, info); return true; }
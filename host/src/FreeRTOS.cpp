@@ -0,0 +1,96 @@
+#include <Arduino.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+bool hostTasksEnabled = true;
+const char* hostTaskOnly = nullptr;
+
+struct HostQueue {
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::deque<std::vector<uint8_t>> items;
+    size_t length;
+    size_t itemSize;
+};
+
+struct HostSemaphore {
+    std::timed_mutex mutex;
+};
+
+static std::chrono::milliseconds toDuration(TickType_t ticks) { return std::chrono::milliseconds(ticks); }
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize) {
+    HostQueue* q = new HostQueue();
+    q->length = length;
+    q->itemSize = itemSize;
+    return q;
+}
+
+BaseType_t xQueueSend(QueueHandle_t q, const void* item, TickType_t wait) {
+    std::unique_lock<std::mutex> lock(q->mutex);
+    auto ready = [q] { return q->items.size() < q->length; };
+    if (wait == portMAX_DELAY) q->changed.wait(lock, ready);
+    else if (!q->changed.wait_for(lock, toDuration(wait), ready)) return pdFALSE;
+    const uint8_t* p = (const uint8_t*)item;
+    q->items.emplace_back(p, p + q->itemSize);
+    q->changed.notify_all();
+    return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t q, void* item, TickType_t wait) {
+    std::unique_lock<std::mutex> lock(q->mutex);
+    auto ready = [q] { return !q->items.empty(); };
+    if (wait == portMAX_DELAY) q->changed.wait(lock, ready);
+    else if (!q->changed.wait_for(lock, toDuration(wait), ready)) return pdFALSE;
+    memcpy(item, q->items.front().data(), q->itemSize);
+    q->items.pop_front();
+    q->changed.notify_all();
+    return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t q) {
+    std::lock_guard<std::mutex> lock(q->mutex);
+    return q->items.size();
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex() { return new HostSemaphore(); }
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t s, TickType_t wait) {
+    if (wait == portMAX_DELAY) {
+        s->mutex.lock();
+        return pdTRUE;
+    }
+    return s->mutex.try_lock_for(toDuration(wait)) ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t s) {
+    s->mutex.unlock();
+    // FreeRTOS hands a released mutex to the task waiting for it. std::timed_mutex does
+    // not, and a thread that takes the mutex in a loop would starve the others.
+    std::this_thread::yield();
+    return pdTRUE;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char* name, uint32_t, void* arg, UBaseType_t,
+                                   TaskHandle_t* handle, BaseType_t) {
+    if (handle) *handle = nullptr;
+    if (!hostTasksEnabled || (hostTaskOnly && strcmp(name, hostTaskOnly) != 0)) return pdPASS;
+    std::thread(fn, arg).detach();
+    return pdPASS;
+}
+
+TickType_t xTaskGetTickCount() { return (TickType_t)millis(); }
+void vTaskDelay(TickType_t ticks) { std::this_thread::sleep_for(toDuration(ticks)); }
+void vTaskDelayUntil(TickType_t* previousWake, TickType_t increment) {
+    *previousWake += increment;
+    TickType_t now = xTaskGetTickCount();
+    if ((int32_t)(*previousWake - now) > 0) vTaskDelay(*previousWake - now);
+}
+BaseType_t xPortGetCoreID() { return 0; }
@@ -0,0 +1,86 @@
+#include <HTTPClient.h>
+#include <stdlib.h>
+#include <strings.h>
+
+String HTTPClient::lastUrl;
+String HTTPClient::lastBody;
+int HTTPClient::requests = 0;
+int HTTPClient::responseCode = 200;
+
+static const int HTTPC_ERROR_CONNECTION_REFUSED = -1;
+static const int HTTPC_ERROR_SEND_PAYLOAD_FAILED = -3;
+static const int HTTPC_ERROR_READ_TIMEOUT = -11;
+
+// Description: Reads from `client` until `done` says the bytes so far are complete, or
+// `timeout` ms pass without any. Returns false on timeout or a closed connection.
+template <typename Done>
+static bool readUntil(WiFiClient& client, std::string& in, uint16_t timeout, Done done) {
+    unsigned long last = millis();
+    while (!done()) {
+        uint8_t buf[512];
+        int n = client.read(buf, sizeof(buf));
+        if (n > 0) {
+            in.append((const char*)buf, n);
+            last = millis();
+        } else if (!client.connected() || millis() - last > timeout) {
+            return false;
+        } else {
+            delay(1);
+        }
+    }
+    return true;
+}
+
+int HTTPClient::send(const char* method, const uint8_t* body, size_t len) {
+    requests++;
+    lastBody = String(std::string((const char*)body, body ? len : 0));
+    if (url_.compare(0, 7, "http://") != 0 || !client_) return responseCode;
+
+    // http://host[:port]/path
+    size_t hostStart = 7;
+    size_t pathStart = url_.find('/', hostStart);
+    if (pathStart == std::string::npos) pathStart = url_.size();
+    std::string host = url_.substr(hostStart, pathStart - hostStart);
+    std::string path = pathStart < url_.size() ? url_.substr(pathStart) : "/";
+    uint16_t port = 80;
+    size_t colon = host.find(':');
+    if (colon != std::string::npos) {
+        port = (uint16_t)atoi(host.c_str() + colon + 1);
+        host.resize(colon);
+    }
+
+    if (!client_->connected() && !client_->connect(host.c_str(), port)) return HTTPC_ERROR_CONNECTION_REFUSED;
+
+    char head[256];
+    snprintf(head, sizeof(head), "%s %s HTTP/1.1\r\nHost: %s\r\nConnection: %s\r\nContent-Length: %u\r\n",
+             method, path.c_str(), host.c_str(), reuse_ ? "keep-alive" : "close", (unsigned)len);
+    std::string request = std::string(head) + headers_ + "\r\n";
+    if (body) request.append((const char*)body, len);
+    if (client_->write((const uint8_t*)request.data(), request.size()) != request.size()) {
+        client_->stop();
+        return HTTPC_ERROR_SEND_PAYLOAD_FAILED;
+    }
+
+    std::string in;
+    if (!readUntil(*client_, in, timeout_, [&]() { return in.find("\r\n\r\n") != std::string::npos; })) {
+        client_->stop();
+        return HTTPC_ERROR_READ_TIMEOUT;
+    }
+    size_t headerEnd = in.find("\r\n\r\n") + 4;
+    int code = atoi(in.c_str() + in.find(' ') + 1);
+
+    size_t contentLength = 0;
+    keepAlive_ = reuse_;
+    for (size_t line = in.find("\r\n") + 2; line < headerEnd - 2; line = in.find("\r\n", line) + 2) {
+        const char* p = in.c_str() + line;
+        if (strncasecmp(p, "Content-Length:", 15) == 0) contentLength = strtoul(p + 15, nullptr, 10);
+        if (strncasecmp(p, "Connection: close", 17) == 0) keepAlive_ = false;
+    }
+
+    // The body is read and dropped, so the connection is ready for the next request
+    if (!readUntil(*client_, in, timeout_, [&]() { return in.size() >= headerEnd + contentLength; })) {
+        client_->stop();
+        return HTTPC_ERROR_READ_TIMEOUT;
+    }
+    return code;
+}
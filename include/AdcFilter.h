@@ -0,0 +1,32 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include "SensorConfig.h"
+
+// Description: One filtered reading of a sensor.
+struct AdcReading {
+    int16_t value;   // Raw ADC counts, on the same scale as a single analogRead()
+    float noise;     // Spread of one conversion in the burst, as a standard deviation in counts
+};
+
+// Description: Oversampled ADC acquisition. A reading is a burst of BURST_SIZE back-to-back
+// conversions: a running median of three removes single-conversion spikes (Wi-Fi transmit
+// bursts couple into the ADC), then the lowest and highest quarter are dropped and the
+// rest averaged. The sort is a sorting network, so the work per reading does not depend
+// on the conversions and the sampling task's timing stays predictable. The interquartile
+// range of the burst gives the noise estimate.
+class AdcFilter {
+public:
+    static const size_t BURST_SIZE = 32;   // Conversions per reading
+    static const int16_t ADC_MAX = 4095;
+
+    // Takes a burst on `pin` and reduces it.
+    static AdcReading read(uint8_t pin);
+
+    // Reduces `count` conversions (at most BURST_SIZE), reordering `burst`.
+    static AdcReading reduce(uint16_t* burst, size_t count);
+
+    // Moisture in percent from the sensor's air and water calibration, clamped to 0..100.
+    static float percent(const SensorConfig& sensor, float value);
+};
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <Arduino.h>
+#include <WiFiClientSecure.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
+#include "FixedFormat.h"
+#include "Metrics.h"
+
+// Description: Delivers Telegram alerts from a background task so loop() never waits on
+// TLS or the network. enqueue() only copies the alert into a bounded FreeRTOS queue. The
+// task merges alerts that arrive together into one message, keeps a single connection
+// open between messages, and retries failed sends with exponential backoff. A message
+// the Bot API rejects as malformed is split and its alerts are sent one at a time, so
+// only an alert that is rejected on its own is dropped.
+class AlertDispatcher {
+public:
+    static const size_t QUEUE_LENGTH = 16;
+    static const size_t MAX_BATCH = 8;                    // Distinct sensors per message
+    static const size_t NAME_SIZE = 64;                   // Escaped plant name, longer ones are cut
+    static const size_t LINE_SIZE = 160;                  // One alert in a message
+    static const uint32_t COALESCE_MILLIS = 1000;         // Wait for alerts that fire together
+    static const uint32_t INITIAL_BACKOFF_MILLIS = 2000;
+    static const uint32_t MAX_BACKOFF_MILLIS = 300000;
+
+    // Starts the dispatcher task. `apiUrl` is the Bot API base, e.g.
+    // "https://api.telegram.org"; an http:// URL can point it at a local stand-in.
+    bool begin(const char* apiUrl, const char* botToken, const char* chatId);
+
+    // Queues an alert without blocking: the plant is dry, or with `hoursToDry` >= 0, will
+    // be dry in that many hours. `name` must outlive the dispatcher. Returns false if the
+    // queue is full; the caller keeps the alert and offers it again.
+    bool enqueue(const char* name, int moisture, float hoursToDry = -1);
+
+    uint32_t sentCount() const { return sent_; }
+    uint32_t failedAttempts() const { return failed_; }
+    uint32_t droppedCount() const { return dropped_; }         // Full batch or rejected for good
+    uint32_t queueFullCount() const { return queueFull_; }     // enqueue() calls turned away
+    const LatencyHistogram& sendLatency() const { return sendLatency_; }   // Per attempt, including TLS
+
+private:
+    struct Alert {
+        const char* name;
+        int moisture;
+        float hoursToDry;   // -1: dry now
+    };
+
+    typedef FixedFormat<LINE_SIZE> MessageLine;
+    // Chat id, greeting and MAX_BATCH lines, all JSON-escaped
+    typedef FixedFormat<192 + MAX_BATCH * LINE_SIZE> MessageBody;
+
+    void describe(MessageLine& line, const Alert& alert) const;
+
+    static void taskEntry(void* arg);
+    void run();
+    void addToBatch(const Alert& alert);
+    void removeFromBatch(size_t count);
+    int sendBatch(size_t& count);
+
+    const char* apiUrl_ = nullptr;
+    const char* botToken_ = nullptr;
+    const char* chatId_ = nullptr;
+    QueueHandle_t queue_ = nullptr;
+    WiFiClient plainClient_;
+    WiFiClientSecure secureClient_;
+    Alert batch_[MAX_BATCH];
+    size_t batchCount_ = 0;
+    bool oneAtATime_ = false;   // The last message was rejected as malformed
+    MessageBody body_;          // Too big for the task stack next to TLS
+    volatile uint32_t sent_ = 0;
+    volatile uint32_t failed_ = 0;
+    volatile uint32_t dropped_ = 0;
+    volatile uint32_t queueFull_ = 0;
+    LatencyHistogram sendLatency_;
+};
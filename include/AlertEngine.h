@@ -0,0 +1,70 @@
+#pragma once
+
+#include <stdint.h>
+
+// Description: What AlertEngine::update() decided about the latest reading.
+enum AlertEvent {
+    ALERT_NONE,
+    ALERT_FORECAST,    // Not dry yet, but the trend reaches the threshold within FORECAST_HOURS
+    ALERT_DRY,         // The smoothed reading crossed the dry threshold
+    ALERT_RECOVERED,   // Watered: the smoothed reading fell below the hysteresis band
+};
+
+// Description: Per-sensor dryness alerting in O(1) time and memory per sample; history is
+// never read back. Readings are smoothed with a time-based EWMA, so single noisy samples
+// cannot cross the threshold. An alert fires once when the smoothed reading rises above
+// the dry threshold, and re-arms only after it falls HYSTERESIS counts below it. After a
+// start or a long gap the EWMA is the plain mean of its first MIN_SAMPLES readings, and no
+// dry alert fires until it has that many.
+//
+// The drying trend is an online least-squares line through the raw readings, with older
+// readings fading out over TREND_SECONDS. Its sums are kept relative to the newest
+// sample, so single-precision floats stay accurate however long the board runs. A sudden
+// drop that holds for WATERING_SAMPLES readings in a row means the plant was watered and
+// starts a new trend; a single low glitch is left out of both the EWMA and the trend.
+// Readings at the ADC rails (a loose or shorted probe) are ignored.
+class AlertEngine {
+public:
+    static const uint32_t SMOOTHING_SECONDS = 1800;    // EWMA time constant
+    static const int16_t HYSTERESIS = 60;              // Re-arm this far below the threshold
+    static const uint32_t TREND_SECONDS = 43200;       // Memory of the drying trend
+    static const uint32_t MIN_TREND_SECONDS = 10800;   // Trend history needed before forecasting
+    static const uint32_t MAX_GAP_SECONDS = 21600;     // A longer gap starts over
+    static const int16_t WATERING_DROP = 150;          // Drop below the EWMA that means watering
+    static const uint8_t WATERING_SAMPLES = 2;         // Consecutive low readings that confirm it
+    static const uint8_t MIN_SAMPLES = 5;              // Readings in the EWMA before a dry alert
+    static const uint32_t FORECAST_HOURS = 12;         // Warn this long before the soil turns dry
+    static const int16_t ADC_MAX = 4095;
+
+    void begin(int16_t dryThreshold) { dryThreshold_ = dryThreshold; }
+
+    // Feeds one reading; timestamps must not go backwards. Returns the event it causes,
+    // at most one per transition.
+    AlertEvent update(uint32_t timestamp, int16_t value);
+
+    int16_t dryThreshold() const { return dryThreshold_; }
+    int16_t rearmThreshold() const { return dryThreshold_ - HYSTERESIS; }
+    float smoothed() const { return ewma_; }
+    float slopePerHour() const;
+
+    // Hours until the smoothed reading reaches the threshold on the current trend, or -1
+    // if the soil is not drying (or the trend is still too short to tell).
+    float hoursToDry() const;
+
+private:
+    enum State { MOIST, FORECAST, DRY };
+
+    void resetTrend(uint32_t timestamp);
+    void addToTrend(float hours, int16_t value);
+
+    int16_t dryThreshold_ = 0;
+    State state_ = MOIST;
+    bool started_ = false;
+    uint8_t lowSamples_ = 0;   // Consecutive readings WATERING_DROP below the EWMA
+    uint8_t samples_ = 0;      // Readings in the EWMA since it restarted, up to MIN_SAMPLES
+    uint32_t lastTimestamp_ = 0;
+    uint32_t trendStart_ = 0;
+    float ewma_ = 0;
+    // Weighted sums of the trend, with t in hours and the newest sample at t = 0
+    float w_ = 0, t_ = 0, tt_ = 0, y_ = 0, ty_ = 0;
+};
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Description: One fixed-width time bucket produced by BucketDownsampler.
+struct SeriesBucket {
+    uint32_t start;        // Epoch seconds at the start of the bucket
+    int16_t min;
+    int16_t max;
+    float mean;
+    uint32_t count;
+};
+
+// Description: One point selected by LttbDownsampler.
+struct SeriesPoint {
+    uint32_t timestamp;
+    int16_t value;
+};
+
+// Description: Reduces a time-ordered stream of samples to at most `points` fixed-width
+// buckets spanning [from, to], keeping min/max/mean per bucket. O(1) memory: only the
+// open bucket is held. Empty buckets are not emitted.
+class BucketDownsampler {
+public:
+    BucketDownsampler(uint32_t from, uint32_t to, uint32_t points);
+
+    // Adds one sample. Returns true and fills `out` when the sample closes a bucket.
+    bool add(uint32_t timestamp, int16_t value, SeriesBucket& out) { return add(timestamp, value, value, value, 1, out); }
+
+    // Adds a pre-aggregated window of `count` samples starting at `timestamp`.
+    bool add(uint32_t timestamp, int16_t min, int16_t max, int32_t sum, uint32_t count, SeriesBucket& out);
+
+    // Closes the last open bucket. Returns false if it was empty.
+    bool finish(SeriesBucket& out);
+
+    uint32_t width() const { return width_; }
+
+private:
+    void open(uint32_t index, int16_t min, int16_t max, int32_t sum, uint32_t count);
+
+    uint32_t from_;
+    uint32_t width_;
+    uint32_t index_ = 0;
+    SeriesBucket cur_ = {};
+    int32_t sum_ = 0;
+};
+
+// Description: Largest-Triangle-Three-Buckets reduction of `count` time-ordered samples
+// to `points` samples in a single pass. Classic LTTB needs the whole of the next bucket
+// before it can pick a point from the current one; here each bucket keeps only the
+// upper and lower convex hull of its points plus a running average. The point with the
+// largest triangle always lies on the hull, so the result matches LTTB exactly unless a
+// bucket's hull outgrows HULL_CAPACITY, in which case its oldest vertices are thinned.
+class LttbDownsampler {
+public:
+    static const size_t HULL_CAPACITY = 24;
+    static const size_t MAX_FINISH_POINTS = 3;
+
+    LttbDownsampler(uint32_t count, uint32_t points);
+
+    // Adds one sample. Returns true and fills `out` when a point has been selected.
+    bool add(uint32_t timestamp, int16_t value, SeriesPoint& out);
+
+    // Flushes the remaining selections and the final sample into `out`.
+    // Returns the number of points written, at most MAX_FINISH_POINTS.
+    size_t finish(SeriesPoint out[MAX_FINISH_POINTS]);
+
+private:
+    struct Vertex {
+        int64_t x;         // Seconds since the first sample
+        int32_t y;
+    };
+
+    struct Bucket {
+        Vertex upper[HULL_CAPACITY];
+        Vertex lower[HULL_CAPACITY];
+        size_t upperCount;
+        size_t lowerCount;
+        double sumX;
+        double sumY;
+        uint32_t count;
+        uint32_t index;
+
+        void reset(uint32_t bucketIndex);
+        void add(const Vertex& v);
+    };
+
+    uint32_t bucketOf(uint32_t sampleIndex) const;
+    void push(const Vertex& v, uint32_t sampleIndex, bool& emitted, SeriesPoint& out);
+    SeriesPoint select(const Bucket& bucket, double cx, double cy);
+    SeriesPoint toPoint(const Vertex& v) const;
+
+    uint32_t count_;
+    uint32_t points_;
+    bool passthrough_;
+    uint32_t received_ = 0;
+    uint32_t origin_ = 0;
+    Vertex anchor_ = {};   // Last selected point, the first corner of every triangle
+    Vertex last_ = {};     // Most recent sample, held back in case it is the final one
+    bool hasPending_ = false;
+    Bucket pending_;       // Complete bucket waiting for the next bucket's average
+    Bucket current_;       // Bucket still receiving samples
+};
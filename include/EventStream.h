@@ -0,0 +1,56 @@
+#pragma once
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include "FixedFormat.h"
+
+// Description: Server-Sent Events fan-out. Subscribed browsers keep their connection
+// open and receive one small text event per logged sample instead of polling. The
+// sockets are taken over from the HttpServer request that opened them, so the server
+// itself stays free to handle other requests.
+//
+// Writes never wait. An event that finds a subscriber's socket buffer full is skipped
+// for that subscriber, so a stalled browser costs its own events and nothing else. A
+// write that gets only part of an event out would leave the stream mid-event, so that
+// subscriber is dropped instead; its browser reconnects after the advertised retry.
+class EventStream {
+public:
+    static const size_t MAX_CLIENTS = 3;   // Each holds an lwIP socket, see HttpServer::SOCKETS_USED
+    static const size_t EVENT_SIZE = 96;   // Longest formatted event
+    static const unsigned long KEEPALIVE_MILLIS = 15000;
+
+    // Appends one formatted event to `out`, e.g. to build a snapshot for subscribe().
+    // Returns false, leaving `out` unchanged, when the event does not fit.
+    template <size_t N>
+    static bool format(FixedFormat<N>& out, const char* event, const char* data) {
+        char buf[EVENT_SIZE];
+        int len = snprintf(buf, sizeof(buf), "event: %s\ndata: %s\n\n", event, data);
+        if (len <= 0 || (size_t)len >= sizeof(buf) || (size_t)len > out.room()) return false;
+        out.append(buf, len);
+        return true;
+    }
+
+    // Sends the event-stream headers, then `snapshot` (events built with format()), and
+    // adds the client. Returns false when all slots are taken or the headers cannot be
+    // written.
+    bool subscribe(WiFiClient& client, const char* snapshot, size_t length);
+
+    // Sends one event to every subscriber.
+    void broadcast(const char* event, const char* data);
+
+    // Sends periodic keepalive comments and prunes closed connections. A subscriber that
+    // cannot take even the keepalive has stopped reading and is dropped. Call from loop().
+    void loop();
+
+    size_t clientCount();
+    uint32_t skippedCount() const { return skipped_; }   // Events skipped on a full socket buffer
+
+private:
+    enum WriteResult { WRITTEN, SKIPPED, FAILED };
+
+    WriteResult write(WiFiClient& client, const char* buf, size_t length);
+
+    WiFiClient clients_[MAX_CLIENTS];
+    unsigned long lastKeepalive_ = 0;
+    uint32_t skipped_ = 0;
+};
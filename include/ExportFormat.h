@@ -0,0 +1,33 @@
+#pragma once
+
+#include <stdint.h>
+
+// Description: Wire format of /export, a binary dump of one sensor's raw samples for
+// collectors. All fields are little-endian, the byte order of the ESP32 and of common
+// hosts, and naturally aligned, so a collector can copy the body into these structs as is.
+//
+// The body is one ExportHeader followed by ExportRecords, oldest first; the record count
+// is (body length - sizeof(ExportHeader)) / recordSize. A collector asks for
+// ?after=<toSeq - 1> of its previous response to get only newer records. If fromSeq is
+// larger than the cursor + 1, records it never saw have been overwritten in between.
+static const uint32_t EXPORT_MAGIC = 0x58454D50;   // "PMEX" in little-endian byte order
+static const uint8_t EXPORT_VERSION = 1;
+
+struct ExportHeader {
+    uint32_t magic;        // EXPORT_MAGIC
+    uint8_t version;       // EXPORT_VERSION; readers should reject newer versions
+    uint8_t sensor;        // 1-based, as in the request
+    uint16_t recordSize;   // sizeof(ExportRecord); later versions may append fields
+    uint32_t fromSeq;      // The records cover sequence numbers [fromSeq, toSeq)
+    uint32_t toSeq;
+};
+
+struct ExportRecord {
+    uint32_t seq;          // Sample sequence number; gaps mark unreadable blocks
+    uint32_t timestamp;    // Epoch seconds
+    int16_t value;         // Raw ADC reading
+    uint16_t reserved;     // Zero
+};
+
+static_assert(sizeof(ExportHeader) == 16, "ExportHeader must match the wire format");
+static_assert(sizeof(ExportRecord) == 12, "ExportRecord must match the wire format");
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+// Description: Text built in a fixed buffer that lives wherever the FixedFormat does,
+// usually the stack, for log lines, URLs and small message bodies. Unlike String
+// concatenation it never touches the heap, so formatting on every sample or request
+// cannot fragment it. Text that does not fit is cut short and truncated() says so.
+template <size_t N>
+class FixedFormat {
+public:
+    FixedFormat() { clear(); }
+
+    FixedFormat& append(const char* text) { return append(text, strlen(text)); }
+
+    FixedFormat& append(const char* text, size_t len) {
+        size_t room = N - 1 - len_;
+        if (len > room) {
+            len = room;
+            truncated_ = true;
+        }
+        memcpy(buf_ + len_, text, len);
+        len_ += len;
+        buf_[len_] = '\0';
+        return *this;
+    }
+
+    FixedFormat& appendf(const char* fmt, ...) __attribute__((format(printf, 2, 3))) {
+        va_list args;
+        va_start(args, fmt);
+        vappendf(fmt, args);
+        va_end(args);
+        return *this;
+    }
+
+    FixedFormat& vappendf(const char* fmt, va_list args) {
+        int n = vsnprintf(buf_ + len_, N - len_, fmt, args);
+        if (n < 0) {
+            buf_[len_] = '\0';
+        } else if ((size_t)n >= N - len_) {
+            len_ = N - 1;
+            truncated_ = true;
+        } else {
+            len_ += n;
+        }
+        return *this;
+    }
+
+    void clear() {
+        len_ = 0;
+        truncated_ = false;
+        buf_[0] = '\0';
+    }
+
+    const char* c_str() const { return buf_; }
+    size_t length() const { return len_; }
+    size_t room() const { return N - 1 - len_; }   // Characters that still fit
+    bool truncated() const { return truncated_; }
+
+private:
+    char buf_[N];
+    size_t len_;
+    bool truncated_;
+};
+
+static const size_t LOG_LINE_SIZE = 160;
+
+// Description: printf to Serial through a FixedFormat<LOG_LINE_SIZE> on the stack. The
+// core's Serial.printf() allocates for any line longer than 64 bytes; this never does.
+// A longer line is cut and ends in "...".
+void logPrintf(const char* fmt, ...) __attribute__((format(printf, 1, 2)));
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <functional>
+#include <sys/select.h>
+
+#define CONTENT_LENGTH_UNKNOWN ((size_t)-1)
+
+// Description: Event-driven HTTP/1.1 server for the dashboard, /log and the scrapers. Every
+// socket is non-blocking and handleClient() multiplexes them with select(), so several
+// browsers and scrapers are served side by side instead of one connection at a time.
+// Connections are kept alive between requests, and pipelined requests are answered in
+// order. Route handlers use the same calls as with the Arduino WebServer (arg(), send(),
+// sendContent(), ...). A handler runs to completion; the server only waits on one client
+// while that client's handler writes more than the socket can buffer.
+class HttpServer {
+public:
+    typedef std::function<void(void)> THandlerFunction;
+
+    // lwIP has LWIP_SOCKETS sockets for the whole firmware (CONFIG_LWIP_MAX_SOCKETS of the
+    // Arduino core). The server takes SOCKETS_USED: the listener, MAX_CONNECTIONS, and one
+    // for a newcomer waiting while every connection is busy. Connections handed over with
+    // client() leave the server and count against the caller's share.
+    static const size_t LWIP_SOCKETS = 10;
+    static const size_t MAX_CONNECTIONS = 4;
+    static const size_t SOCKETS_USED = MAX_CONNECTIONS + 2;
+    static const unsigned long WAITING_TIMEOUT_MILLIS = 1000;   // Then the newcomer gets 503
+    static const size_t MAX_ROUTES = 16;
+    static const size_t MAX_ARGS = 8;
+    static const size_t MAX_HEADERS = 4;               // Request headers kept for handlers
+    static const size_t REQUEST_BUFFER_SIZE = 1024;    // Request line, headers and body, per connection
+    static const size_t RESPONSE_BUFFER_SIZE = 1460;   // One TCP segment
+    static const size_t HEADER_BUFFER_SIZE = 256;      // Headers added with sendHeader()
+    static const unsigned long IDLE_TIMEOUT_MILLIS = 5000;   // Keep-alive connections without a request
+    static const unsigned long SEND_TIMEOUT_MILLIS = 5000;   // Longest wait on a client that stopped reading
+
+    explicit HttpServer(uint16_t port = 80) : port_(port) {}
+
+    // Starts listening; later calls have no effect. Port 0 picks a free port, see port().
+    bool begin();
+    bool begin(uint16_t port);
+    uint16_t port() const { return port_; }
+
+    // Accepts connections, reads whatever has arrived and answers every complete request.
+    // Waits up to `waitMillis` for activity.
+    void handleClient(unsigned long waitMillis = 0);
+
+    // `uri` must stay valid for the lifetime of the server.
+    void on(const char* uri, THandlerFunction handler);
+    void onNotFound(THandlerFunction handler) { notFound_ = handler; }
+    void collectHeaders(const char* keys[], size_t count);
+
+    // Request accessors, valid inside a handler. The String forms copy the value to the
+    // heap; the const char* forms point into the request buffer and allocate nothing.
+    String uri() const { return String(uri_); }
+    String arg(const char* name) const;
+    bool hasArg(const char* name) const { return findArg(name) != nullptr; }
+    String header(const char* name) const;
+    const char* argValue(const char* name) const;                               // "" if absent
+    unsigned long argUnsigned(const char* name, unsigned long fallback) const;  // `fallback` if absent
+    const char* headerValue(const char* name) const;                            // "" if absent
+
+    // Hands the connection over to the caller, e.g. for a Server-Sent Events stream. The
+    // server forgets it after the handler returns. The socket stays non-blocking; the
+    // caller must cope with EAGAIN.
+    WiFiClient client();
+
+    // Response, as with the Arduino WebServer. setContentLength(CONTENT_LENGTH_UNKNOWN)
+    // before send() streams the body with chunked encoding through sendContent(), and an
+    // empty sendContent() ends it.
+    void sendHeader(const char* name, const char* value);
+    void setContentLength(size_t length) { contentLength_ = length; }
+    void send(int code, const char* contentType = "text/plain", const char* content = "");
+    void send_P(int code, const char* contentType, const char* content, size_t length);
+    void sendContent(const char* content, size_t length);
+    void sendContent(const char* content) { sendContent(content, strlen(content)); }
+
+    uint32_t requestCount() const { return requests_; }
+    uint32_t refusedCount() const { return refused_; }   // Turned away with 503, all connections busy
+    size_t connectionCount() const;
+
+private:
+    struct Connection {
+        int fd = -1;
+        size_t length = 0;                // Bytes received and not yet answered
+        unsigned long lastActivity = 0;
+        char buffer[REQUEST_BUFFER_SIZE];
+    };
+
+    struct Route {
+        const char* uri;
+        THandlerFunction handler;
+    };
+
+    struct Param {
+        const char* name;
+        const char* value;
+    };
+
+    void accept(const fd_set& readable);
+    void receive(Connection& conn);
+    void serve(Connection& conn);
+    void handle(Connection& conn, size_t headerLength);
+    void reject(Connection& conn, int code, const char* message);
+    void refuse(int fd);
+    void startResponse(int fd);
+    bool parse(char* request, size_t headerLength);
+    void close(Connection& conn);
+    const Param* findArg(const char* name) const;
+
+    void writeHead(int code, const char* contentType, size_t length);
+    void write(const char* data, size_t length);
+    bool flush();
+    bool sendAll(const char* data, size_t length);
+
+    uint16_t port_;
+    int listenFd_ = -1;
+    Connection connections_[MAX_CONNECTIONS];
+    Route routes_[MAX_ROUTES];
+    size_t routeCount_ = 0;
+    THandlerFunction notFound_;
+    const char* headerKeys_[MAX_HEADERS] = {};
+    size_t headerKeyCount_ = 0;
+    uint32_t requests_ = 0;
+    uint32_t refused_ = 0;
+    int waitingFd_ = -1;                // Accepted while every connection was busy
+    unsigned long waitingSince_ = 0;
+
+    // The request being answered
+    int fd_ = -1;
+    const char* uri_ = "";
+    Param args_[MAX_ARGS];
+    size_t argCount_ = 0;
+    const char* headerValues_[MAX_HEADERS] = {};
+    bool http11_ = true;
+    bool keepAlive_ = true;
+
+    // Its response
+    char headers_[HEADER_BUFFER_SIZE];
+    size_t headersLength_ = 0;
+    size_t contentLength_ = 0;
+    bool responded_ = false;
+    bool chunked_ = false;
+    bool finished_ = false;    // A chunked body has been terminated
+    bool failed_ = false;      // A write failed or timed out; the connection is dropped
+    bool detached_ = false;    // client() took the connection over
+    char out_[RESPONSE_BUFFER_SIZE];
+    size_t outLength_ = 0;
+};
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <Arduino.h>
+
+class ResponseStream;
+
+// Description: Fixed-bucket latency histogram, exported in the Prometheus text format.
+// Recording is a bucket search and three integer updates, with no allocation, so it can
+// stay on in production. Each histogram should be recorded from a single task; a scrape
+// that reads a bucket while it is being updated is off by one sample at most.
+class LatencyHistogram {
+public:
+    static const size_t BUCKET_COUNT = 12;
+
+    void record(uint32_t micros);
+
+    // Writes the HELP/TYPE lines and the _bucket, _sum and _count series of `name`.
+    void print(ResponseStream& out, const char* name, const char* help) const;
+
+private:
+    static const uint32_t BOUNDS_MICROS[BUCKET_COUNT];
+
+    volatile uint32_t buckets_[BUCKET_COUNT + 1] = {};   // The last one is +Inf
+    volatile uint64_t sumMicros_ = 0;
+    volatile uint32_t count_ = 0;
+};
+
+// Description: Records the time from construction to the end of the enclosing scope.
+class ScopedLatency {
+public:
+    explicit ScopedLatency(LatencyHistogram& histogram) : histogram_(histogram), start_(micros()) {}
+    ~ScopedLatency() { histogram_.record(micros() - start_); }
+
+private:
+    LatencyHistogram& histogram_;
+    uint32_t start_;
+};
+
+// Description: Writes one gauge or counter with its HELP and TYPE lines.
+void printMetric(ResponseStream& out, const char* name, const char* type, const char* help, double value);
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Description: The most recent bodies of query endpoints, each tagged with the request it
+// answered and the history generation it was built from. A body is served again only
+// while the generation is unchanged, so the first append after it was stored retires it
+// without any explicit invalidation. Bodies that outgrow BODY_SIZE are not cached. The
+// slots are static: the cache costs SLOT_COUNT * BODY_SIZE bytes of RAM and no heap.
+//
+// Used from the HTTP server task only.
+class ResponseCache {
+public:
+    static const size_t SLOT_COUNT = 2;
+    static const size_t BODY_SIZE = 6144;
+    static const size_t KEY_SIZE = 64;
+
+    struct Slot {
+        char key[KEY_SIZE];
+        uint32_t generation;
+        size_t length;
+        bool valid;
+        uint32_t lastUsed;
+        char body[BODY_SIZE];
+    };
+
+    // Returns the body stored for `key` at `generation`, or nullptr.
+    const Slot* find(const char* key, uint32_t generation);
+
+    // Takes a slot for a new body, or returns nullptr if `key` is too long to store.
+    // Fill slot->body, then commit().
+    Slot* claim(const char* key, uint32_t generation);
+
+    // Makes a claimed slot servable with `length` bytes of body. `complete` is false if the
+    // body did not fit, which leaves the slot empty. A null slot is ignored.
+    void commit(Slot* slot, size_t length, bool complete);
+
+    uint32_t hits() const { return hits_; }
+    uint32_t misses() const { return misses_; }
+
+private:
+    Slot slots_[SLOT_COUNT] = {};
+    uint32_t clock_ = 0;
+    uint32_t hits_ = 0;
+    uint32_t misses_ = 0;
+};
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <Arduino.h>
+#include "HttpServer.h"
+
+// Description: Streams a response body with chunked transfer encoding through a small
+// fixed buffer, so the size of the response never affects heap usage.
+class ResponseStream {
+public:
+    static const size_t BUFFER_SIZE = 512;
+
+    explicit ResponseStream(HttpServer& server) : server_(server) {}
+    ~ResponseStream() { end(); }
+
+    // Sends the status line and headers. The body follows as chunks.
+    void begin(int code, const char* contentType);
+
+    void write(const char* data, size_t len);
+    void print(const char* text) { write(text, strlen(text)); }
+    void printf(const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+
+    // Flushes the buffer and sends the terminating empty chunk.
+    void end();
+
+    // Also copies the body into `buffer` while it fits, e.g. for a ResponseCache slot.
+    // recordedAll() tells whether all of it did; recorded() is its length.
+    void record(char* buffer, size_t capacity);
+    bool recordedAll() const { return record_ != nullptr; }
+    size_t recorded() const { return recorded_; }
+
+private:
+    void flush();
+
+    HttpServer& server_;
+    char buf_[BUFFER_SIZE];
+    size_t len_ = 0;
+    bool open_ = false;
+    char* record_ = nullptr;
+    size_t recordCapacity_ = 0;
+    size_t recorded_ = 0;
+};
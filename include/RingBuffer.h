@@ -0,0 +1,389 @@
+#pragma once
+
+#include <Arduino.h>
+#include <FS.h>
+
+// Description: CRC-16/CCITT-FALSE, used to detect torn or partially erased records.
+uint16_t crc16(const uint8_t* data, size_t len);
+
+// Description: Checkpointed write position. Two copies are kept at the start of the
+// file and written alternately, so a torn header write always leaves one valid copy.
+struct RingBufferHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t recordSize;
+    uint32_t capacity;
+    uint32_t generation;   // Bumped on every checkpoint, the newest valid copy wins
+    uint32_t nextSeq;      // Sequence number of the next record to be written
+    uint16_t reserved;
+    uint16_t crc;
+};
+
+// Description: Fixed-capacity ring buffer of fixed-size records in a single preallocated
+// file. Appends overwrite the oldest slot in place and never rewrite the rest of the
+// file. The header is checkpointed every `checkpointInterval` appends; on boot the write
+// position is taken from the header and rolled forward over at most the records
+// written since that checkpoint.
+//
+// A sparse index in RAM holds the timestamp of every `indexStride`-th record, at most
+// INDEX_ENTRIES of them, so a time lookup only reads the slots between two index
+// entries from flash; with capacity <= INDEX_ENTRIES every record is indexed. The index is rebuilt from
+// the records themselves in begin(), so it never needs writing to flash and cannot
+// disagree with the data after a torn write.
+//
+// Record must be a plain struct with a uint32_t `seq` and uint32_t `timestamp`, and a
+// uint16_t `crc` as its last member. Timestamps must be appended in order.
+template <typename Record>
+class RingBuffer {
+public:
+    // Opens the file, creating and preallocating it if missing or incompatible.
+    // `path` must stay valid for the lifetime of the buffer.
+    bool begin(fs::FS& fs, const char* path, uint32_t capacity, uint32_t checkpointInterval);
+
+    // Appends one record in O(1). `seq` and `crc` are filled in. Returns false if the
+    // flash write failed.
+    bool append(Record rec);
+
+    // Overwrites the newest record in place, keeping its sequence number. Used to grow
+    // a record that is written before it is complete. Returns false if the buffer is
+    // empty or the flash write failed.
+    bool rewriteLast(Record rec);
+
+    // Like rewriteLast(), but writes only bytes [from, to) of the record, for a caller
+    // that knows the rest of the slot already holds `rec`. The crc is recomputed but
+    // only written if it lies in the range, so a record changed in several places is
+    // patched with one call per range, the crc last.
+    bool rewriteLast(Record rec, size_t from, size_t to);
+
+    // Writes the current position to the header immediately.
+    bool checkpoint();
+
+    // Reads the record with the given sequence number. Returns false if the slot
+    // has since been overwritten or fails its CRC.
+    bool read(uint32_t seq, Record& out);
+
+    // Returns the sequence number of the first record with a timestamp at or after
+    // `timestamp` (nextSeq() if there is none). Binary search in the sparse index, then
+    // O(log indexStride()) slot reads.
+    uint32_t lowerBound(uint32_t timestamp);
+
+    // Calls fn(const Record&) for every valid record with a sequence number in
+    // [fromSeq, toSeq), oldest first. Slots are read in small batches.
+    template <typename Fn>
+    void forEach(uint32_t fromSeq, uint32_t toSeq, Fn fn);
+
+    template <typename Fn>
+    void forEach(uint32_t fromSeq, Fn fn) { forEach(fromSeq, nextSeq_, fn); }
+
+    template <typename Fn>
+    void forEach(Fn fn) { forEach(firstSeq(), nextSeq_, fn); }
+
+    uint32_t capacity() const { return capacity_; }
+    uint32_t nextSeq() const { return nextSeq_; }
+    uint32_t firstSeq() const { return nextSeq_ > capacity_ ? nextSeq_ - capacity_ : 0; }
+    uint32_t size() const { return nextSeq_ - firstSeq(); }
+    uint32_t indexStride() const { return indexStride_; }
+
+private:
+    static const uint32_t MAGIC = 0x474C5052;  // "RPLG"
+    static const uint16_t VERSION = 1;
+    static const uint32_t HEADER_SLOTS = 2;
+    static const size_t BATCH_RECORDS = 32;
+    static const uint32_t INDEX_ENTRIES = 32;
+    static const uint32_t NOT_INDEXED = UINT32_MAX;
+
+    // Timestamp of record `seq`; the entry is stale unless `seq` matches
+    struct IndexEntry {
+        uint32_t seq;
+        uint32_t timestamp;
+    };
+
+    static uint16_t recordCrc(const Record& rec) {
+        return crc16((const uint8_t*)&rec, sizeof(Record) - sizeof(uint16_t));
+    }
+    static uint16_t headerCrc(const RingBufferHeader& hdr) {
+        return crc16((const uint8_t*)&hdr, offsetof(RingBufferHeader, crc));
+    }
+
+    bool create();
+    bool recover();
+    bool readHeader(int slot, RingBufferHeader& out);
+    void rebuildIndex();
+    void indexRecord(const Record& rec);
+    size_t readSlots(uint32_t firstSlot, Record* out, size_t count);
+    bool isValid(const Record& rec, uint32_t seq) const { return rec.seq == seq && rec.crc == recordCrc(rec); }
+    uint32_t recordOffset(uint32_t slot) const { return HEADER_SLOTS * sizeof(RingBufferHeader) + slot * sizeof(Record); }
+
+    fs::FS* fs_ = nullptr;
+    const char* path_ = nullptr;
+    uint32_t capacity_ = 0;
+    uint32_t checkpointInterval_ = 1;
+    fs::File file_;
+    uint32_t nextSeq_ = 0;
+    uint32_t generation_ = 0;
+    uint32_t sinceCheckpoint_ = 0;
+    uint32_t indexStride_ = 1;
+    IndexEntry index_[INDEX_ENTRIES];
+};
+
+template <typename Record>
+bool RingBuffer<Record>::begin(fs::FS& fs, const char* path, uint32_t capacity, uint32_t checkpointInterval) {
+    fs_ = &fs;
+    path_ = path;
+    capacity_ = capacity;
+    checkpointInterval_ = checkpointInterval;
+    nextSeq_ = 0;
+
+    // Wide enough that the live records never span more than INDEX_ENTRIES entries
+    indexStride_ = capacity_ > INDEX_ENTRIES ? (capacity_ + INDEX_ENTRIES - 2) / (INDEX_ENTRIES - 1) : 1;
+
+    if (fs_->exists(path_)) {
+        file_ = fs_->open(path_, "r+");
+        if (file_ && file_.size() == recordOffset(capacity_) && recover()) {
+            return true;
+        }
+        file_.close();
+        Serial.printf("RingBuffer %s is unreadable or resized, recreating\n", path_);
+    }
+    return create();
+}
+
+// Description: Preallocates the whole file with zeroed slots so later writes only
+// ever overwrite existing bytes. A zeroed slot never passes the CRC check.
+template <typename Record>
+bool RingBuffer<Record>::create() {
+    fs::File f = fs_->open(path_, FILE_WRITE);
+    if (!f) {
+        Serial.printf("Failed to create %s\n", path_);
+        return false;
+    }
+
+    uint8_t zeros[64] = {0};
+    size_t remaining = recordOffset(capacity_);
+    while (remaining > 0) {
+        size_t n = remaining < sizeof(zeros) ? remaining : sizeof(zeros);
+        if (f.write(zeros, n) != n) {
+            f.close();
+            Serial.printf("Failed to preallocate %s\n", path_);
+            return false;
+        }
+        remaining -= n;
+    }
+    f.close();
+
+    file_ = fs_->open(path_, "r+");
+    if (!file_) return false;
+
+    nextSeq_ = 0;
+    generation_ = 0;
+    sinceCheckpoint_ = 0;
+    rebuildIndex();
+    return checkpoint();
+}
+
+template <typename Record>
+bool RingBuffer<Record>::readHeader(int slot, RingBufferHeader& out) {
+    if (!file_.seek(slot * sizeof(RingBufferHeader))) return false;
+    if (file_.read((uint8_t*)&out, sizeof(out)) != sizeof(out)) return false;
+    return out.magic == MAGIC && out.version == VERSION &&
+           out.recordSize == sizeof(Record) && out.capacity == capacity_ &&
+           out.crc == headerCrc(out);
+}
+
+// Description: Restores the write position from the newest valid header, then rolls
+// forward over records appended after that checkpoint. The roll-forward stops at the
+// first slot that does not hold the expected sequence number, which is also where a
+// torn write during power loss would be.
+template <typename Record>
+bool RingBuffer<Record>::recover() {
+    RingBufferHeader a, b;
+    bool okA = readHeader(0, a);
+    bool okB = readHeader(1, b);
+    if (!okA && !okB) return false;
+
+    const RingBufferHeader& hdr = (okA && (!okB || a.generation > b.generation)) ? a : b;
+    nextSeq_ = hdr.nextSeq;
+    generation_ = hdr.generation;
+
+    uint32_t rolled = 0;
+    Record rec;
+    while (rolled < capacity_ && read(nextSeq_, rec)) {
+        ++nextSeq_;
+        ++rolled;
+    }
+    sinceCheckpoint_ = rolled;
+    rebuildIndex();
+
+    Serial.printf("RingBuffer %s recovered: %u records, next seq %u (%u rolled forward)\n",
+                  path_, (unsigned)size(), (unsigned)nextSeq_, (unsigned)rolled);
+    return true;
+}
+
+// Description: Reads the indexed records back from flash, at most INDEX_ENTRIES slots.
+template <typename Record>
+void RingBuffer<Record>::rebuildIndex() {
+    for (uint32_t i = 0; i < INDEX_ENTRIES; ++i) index_[i].seq = NOT_INDEXED;
+
+    Record rec;
+    for (uint32_t seq = (firstSeq() + indexStride_ - 1) / indexStride_ * indexStride_; seq < nextSeq_;
+         seq += indexStride_) {
+        if (read(seq, rec)) indexRecord(rec);
+    }
+}
+
+template <typename Record>
+void RingBuffer<Record>::indexRecord(const Record& rec) {
+    if (rec.seq % indexStride_ != 0) return;
+    IndexEntry& entry = index_[rec.seq / indexStride_ % INDEX_ENTRIES];
+    entry.seq = rec.seq;
+    entry.timestamp = rec.timestamp;
+}
+
+template <typename Record>
+bool RingBuffer<Record>::checkpoint() {
+    RingBufferHeader hdr = {};
+    hdr.magic = MAGIC;
+    hdr.version = VERSION;
+    hdr.recordSize = sizeof(Record);
+    hdr.capacity = capacity_;
+    hdr.generation = generation_ + 1;
+    hdr.nextSeq = nextSeq_;
+    hdr.crc = headerCrc(hdr);
+
+    // Alternate between the two header copies so the previous one survives a torn write
+    if (!file_.seek((hdr.generation % HEADER_SLOTS) * sizeof(RingBufferHeader))) return false;
+    if (file_.write((const uint8_t*)&hdr, sizeof(hdr)) != sizeof(hdr)) return false;
+    file_.flush();
+
+    generation_ = hdr.generation;
+    sinceCheckpoint_ = 0;
+    return true;
+}
+
+template <typename Record>
+bool RingBuffer<Record>::append(Record rec) {
+    if (!file_) return false;
+
+    rec.seq = nextSeq_;
+    rec.crc = recordCrc(rec);
+
+    if (!file_.seek(recordOffset(nextSeq_ % capacity_))) return false;
+    if (file_.write((const uint8_t*)&rec, sizeof(rec)) != sizeof(rec)) return false;
+    file_.flush();
+    indexRecord(rec);
+
+    ++nextSeq_;
+    if (++sinceCheckpoint_ >= checkpointInterval_) {
+        checkpoint();
+    }
+    return true;
+}
+
+template <typename Record>
+bool RingBuffer<Record>::rewriteLast(Record rec) {
+    if (!file_ || nextSeq_ == 0) return false;
+
+    rec.seq = nextSeq_ - 1;
+    rec.crc = recordCrc(rec);
+
+    if (!file_.seek(recordOffset(rec.seq % capacity_))) return false;
+    if (file_.write((const uint8_t*)&rec, sizeof(rec)) != sizeof(rec)) return false;
+    file_.flush();
+    indexRecord(rec);
+    return true;
+}
+
+template <typename Record>
+bool RingBuffer<Record>::rewriteLast(Record rec, size_t from, size_t to) {
+    if (!file_ || nextSeq_ == 0 || from > to || to > sizeof(Record)) return false;
+
+    rec.seq = nextSeq_ - 1;
+    rec.crc = recordCrc(rec);
+
+    if (!file_.seek(recordOffset(rec.seq % capacity_) + from)) return false;
+    if (file_.write((const uint8_t*)&rec + from, to - from) != to - from) return false;
+    file_.flush();
+    indexRecord(rec);
+    return true;
+}
+
+template <typename Record>
+size_t RingBuffer<Record>::readSlots(uint32_t firstSlot, Record* out, size_t count) {
+    if (!file_ || !file_.seek(recordOffset(firstSlot))) return 0;
+    return file_.read((uint8_t*)out, count * sizeof(Record)) / sizeof(Record);
+}
+
+template <typename Record>
+bool RingBuffer<Record>::read(uint32_t seq, Record& out) {
+    if (capacity_ == 0) return false;
+    return readSlots(seq % capacity_, &out, 1) == 1 && isValid(out, seq);
+}
+
+// Description: Timestamps are appended in order, so the ring is sorted by sequence
+// number. The search first runs over index entry numbers (record seq / indexStride),
+// then over the slots between two entries. Unreadable records, and entries that were
+// not rebuilt because their record was unreadable, are skipped: each probe moves on to
+// the next readable one. The result may then be an unreadable record just before the
+// first match, which readers skip anyway.
+template <typename Record>
+uint32_t RingBuffer<Record>::lowerBound(uint32_t timestamp) {
+    auto indexed = [this](uint32_t entry) { return index_[entry % INDEX_ENTRIES].seq == entry * indexStride_; };
+
+    uint32_t first = (firstSeq() + indexStride_ - 1) / indexStride_;
+    uint32_t end = (nextSeq_ + indexStride_ - 1) / indexStride_;
+    uint32_t lo = first;
+    uint32_t hi = end;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        uint32_t probe = mid;
+        while (probe < hi && !indexed(probe)) ++probe;
+        if (probe < hi && index_[probe % INDEX_ENTRIES].timestamp < timestamp) {
+            lo = probe + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    // The answer lies between the last indexed record older than the target and the
+    // first indexed one that is not, found with a binary search over the slots between
+    uint32_t before = lo;
+    while (before > first && !indexed(before - 1)) --before;
+    uint32_t after = lo;
+    while (after < end && !indexed(after)) ++after;
+    hi = after * indexStride_ < nextSeq_ ? after * indexStride_ : nextSeq_;
+    lo = before > first ? (before - 1) * indexStride_ + 1 : firstSeq();
+    Record rec;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        uint32_t probe = mid;
+        while (probe < hi && !read(probe, rec)) ++probe;
+        if (probe < hi && rec.timestamp < timestamp) {
+            lo = probe + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+template <typename Record>
+template <typename Fn>
+void RingBuffer<Record>::forEach(uint32_t fromSeq, uint32_t toSeq, Fn fn) {
+    if (fromSeq < firstSeq()) fromSeq = firstSeq();
+    if (toSeq > nextSeq_) toSeq = nextSeq_;
+
+    Record batch[BATCH_RECORDS];
+    uint32_t seq = fromSeq;
+    while (seq < toSeq) {
+        uint32_t slot = seq % capacity_;
+        size_t count = toSeq - seq;
+        if (count > BATCH_RECORDS) count = BATCH_RECORDS;
+        if (count > capacity_ - slot) count = capacity_ - slot;  // Stop at the wrap point
+
+        size_t got = readSlots(slot, batch, count);
+        if (got == 0) return;
+        for (size_t i = 0; i < got; ++i, ++seq) {
+            if (isValid(batch[i], seq)) fn(batch[i]);
+        }
+    }
+}
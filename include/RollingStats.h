@@ -0,0 +1,80 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Description: Count, mean, spread and range of a set of samples. Two summaries merge
+// in O(1) with Chan's parallel form of Welford's update, which stays accurate in
+// single precision where a running sum of squares would not.
+struct RollingSummary {
+    uint32_t count;
+    float mean;
+    float m2;          // Sum of squared differences from the mean
+    int16_t min;
+    int16_t max;
+
+    void merge(const RollingSummary& other);
+    float variance() const { return count > 1 ? m2 / (count - 1) : 0; }
+};
+
+// Description: Summary of the samples of the last `width` seconds. The window is split
+// into BUCKETS slots that are reused round-robin, so memory is fixed and a query merges
+// at most BUCKETS summaries. The oldest slot can be partly outside the window; the
+// window thus covers between width - width / BUCKETS and width seconds.
+class RollingWindow {
+public:
+    static const size_t BUCKETS = 24;
+
+    void begin(uint32_t width);
+
+    // Folds in samples taken at `timestamp`. Samples older than the window are dropped.
+    void add(uint32_t timestamp, const RollingSummary& samples);
+
+    // Summary of the window ending at `now`; count is 0 if it holds no samples.
+    RollingSummary summary(uint32_t now) const;
+
+    uint32_t width() const { return bucketWidth_ * BUCKETS; }
+
+private:
+    struct Bucket {
+        uint32_t start;
+        RollingSummary samples;
+    };
+
+    uint32_t bucketWidth_ = 1;
+    Bucket buckets_[BUCKETS] = {};
+};
+
+// Description: One sensor's rolling statistics over the last hour, day and week, plus
+// its newest reading. add() and summary() cost O(1), so /stats answers from RAM
+// however long the history is.
+class RollingStats {
+public:
+    static const size_t WINDOW_COUNT = 3;
+    static const uint32_t WINDOW_SECONDS[WINDOW_COUNT];
+    static const char* const WINDOW_NAMES[WINDOW_COUNT];
+
+    RollingStats();
+
+    void add(uint32_t timestamp, int16_t value);
+
+    // Folds in a pre-aggregated window of samples, e.g. a rollup read back after a
+    // reboot. Its spread within the window is unknown and counts as zero.
+    void addAggregate(uint32_t timestamp, uint32_t count, int32_t sum, int16_t min, int16_t max);
+
+    // Sets the newest reading without adding it to the windows.
+    void setLatest(uint32_t timestamp, int16_t value);
+
+    bool hasLatest() const { return hasLatest_; }
+    uint32_t latestTimestamp() const { return latestTimestamp_; }
+    int16_t latestValue() const { return latestValue_; }
+
+    // Summary of window `index`, ending at the newest reading.
+    RollingSummary summary(size_t index) const { return windows_[index].summary(latestTimestamp_); }
+
+private:
+    RollingWindow windows_[WINDOW_COUNT];
+    bool hasLatest_ = false;
+    uint32_t latestTimestamp_ = 0;
+    int16_t latestValue_ = 0;
+};
@@ -0,0 +1,148 @@
+#pragma once
+
+#include "RingBuffer.h"
+
+// Description: One moisture sample, as returned when reading a SampleLog.
+struct LogRecord {
+    uint32_t seq;          // Monotonic sample number, never reused
+    uint32_t timestamp;    // Epoch seconds
+    int16_t value;         // Raw ADC reading
+};
+
+// Description: A run of consecutive samples compressed into one 256-byte slot, the size
+// of a SPIFFS page. The first sample is stored as is. Each later one is two zig-zag
+// varints: the change in the timestamp step (0 while the logging interval holds) and
+// the change in value. A steady sensor costs about 2 bytes per sample instead of 12.
+struct SampleBlock {
+    static const size_t DATA_SIZE = 238;
+
+    uint32_t seq;          // Block number in the ring
+    uint32_t timestamp;    // First sample's timestamp
+    uint32_t firstSample;  // First sample's sequence number
+    int16_t firstValue;
+    uint8_t count;         // Samples in the block, including the first
+    uint8_t used;          // Bytes of `data` in use
+    uint8_t data[DATA_SIZE];
+    uint16_t crc;
+};
+
+// Description: Decodes the samples of a block one at a time, oldest first.
+class BlockDecoder {
+public:
+    explicit BlockDecoder(const SampleBlock& block) : block_(block) {}
+
+    // Returns false once every sample has been read, or if the data is malformed.
+    bool next(LogRecord& out);
+
+    // Timestamp step between the last two samples read.
+    int64_t lastDelta() const { return delta_; }
+
+private:
+    const SampleBlock& block_;
+    uint32_t index_ = 0;
+    size_t pos_ = 0;
+    uint32_t timestamp_ = 0;
+    int64_t delta_ = 0;
+    int16_t value_ = 0;
+};
+
+// Description: Raw sample history stored as a ring of compressed SampleBlocks. The block
+// being filled (the open block) is kept in RAM. It is written to flash when it is full,
+// or once its oldest unwritten sample reaches the write-back age; until it is full
+// only the bytes that changed since the last write are rewritten in place. Samples keep sequence numbers, so callers address
+// them the same way as records in a RingBuffer.
+//
+// The open block can live in memory that survives a soft reset (RTC_NOINIT_ATTR on the
+// ESP32). begin() then keeps the samples that were not yet written.
+class SampleLog {
+public:
+    static const size_t MAX_SAMPLE_BYTES = 8;   // Worst-case encoded size of one sample
+    static const uint32_t MIN_SAMPLES_PER_BLOCK = 1 + SampleBlock::DATA_SIZE / MAX_SAMPLE_BYTES;
+
+    // Keeps the open block in `openBlock` and writes it to flash once its oldest
+    // unwritten sample is `maxAgeSeconds` older than the newest. Call before begin().
+    // Without it, every append is written to flash straight away.
+    void setWriteBack(SampleBlock* openBlock, uint32_t maxAgeSeconds);
+
+    // Opens (or creates) the log with room for `blocks` full blocks on flash.
+    // `path` must stay valid for the lifetime of the log.
+    bool begin(fs::FS& fs, const char* path, uint32_t blocks);
+
+    // Appends one sample. Timestamps must be appended in order. Returns false only if
+    // the open block is full and still cannot be written to flash.
+    bool append(uint32_t timestamp, int16_t value);
+
+    // Writes the open block to flash if it holds unwritten samples.
+    bool flush();
+
+    // Reads the sample with the given sequence number. Returns false if it has been
+    // overwritten or its block is unreadable.
+    bool read(uint32_t seq, LogRecord& out);
+
+    // Returns the sequence number of the first sample with a timestamp at or after
+    // `timestamp` (nextSeq() if there is none). A lookup in the ring's index of block
+    // start times, then a scan of one block.
+    uint32_t lowerBound(uint32_t timestamp);
+
+    // Calls fn(const LogRecord&) for every readable sample with a sequence number in
+    // [fromSeq, toSeq), oldest first, decoding one block at a time.
+    template <typename Fn>
+    void forEach(uint32_t fromSeq, uint32_t toSeq, Fn fn);
+
+    template <typename Fn>
+    void forEach(uint32_t fromSeq, Fn fn) { forEach(fromSeq, nextSeq(), fn); }
+
+    template <typename Fn>
+    void forEach(Fn fn) { forEach(firstSeq_, nextSeq(), fn); }
+
+    uint32_t nextSeq() const { return open_->firstSample + open_->count; }
+    uint32_t firstSeq() const { return firstSeq_; }
+    uint32_t size() const { return nextSeq() - firstSeq_; }
+
+private:
+    static bool hasRoom(const SampleBlock& block) {
+        return block.count < UINT8_MAX && block.used + MAX_SAMPLE_BYTES <= SampleBlock::DATA_SIZE;
+    }
+
+    void adopt();
+    void startBlock(uint32_t index, uint32_t firstSample);
+    void refreshFirstSeq();
+    bool block(uint32_t index, SampleBlock& out);
+    uint32_t blockFor(uint32_t seq);
+    void setHint(uint32_t seq, uint32_t index) { hintSeq_ = seq; hintBlock_ = index; }
+
+    RingBuffer<SampleBlock> ring_;
+    SampleBlock ownBlock_ = {};
+    SampleBlock* open_ = &ownBlock_;
+    bool openOnFlash_ = false;    // The ring's newest slot holds an older copy of the open block
+    bool dirty_ = false;          // The open block has samples that are not on flash
+    bool rewriteSlot_ = false;    // The ring's newest slot is torn; the next flush rewrites all of it
+    uint8_t flushedUsed_ = 0;     // Bytes of the open block's `data` already on flash
+    uint32_t maxAge_ = 0;
+    uint32_t unflushedSince_ = 0; // Timestamp of the oldest sample not on flash
+    uint32_t firstSeq_ = 0;
+    uint32_t lastTimestamp_ = 0;
+    int64_t lastDelta_ = 0;
+    int16_t lastValue_ = 0;
+    // Block found by the last lowerBound(), whose result callers pass straight to forEach()
+    uint32_t hintSeq_ = UINT32_MAX;
+    uint32_t hintBlock_ = 0;
+};
+
+template <typename Fn>
+void SampleLog::forEach(uint32_t fromSeq, uint32_t toSeq, Fn fn) {
+    if (fromSeq < firstSeq_) fromSeq = firstSeq_;
+    if (toSeq > nextSeq()) toSeq = nextSeq();
+    if (fromSeq >= toSeq) return;
+
+    SampleBlock b;
+    LogRecord rec;
+    for (uint32_t i = blockFor(fromSeq); i <= open_->seq; ++i) {
+        if (!block(i, b)) continue;
+        if (b.firstSample >= toSeq) break;
+        BlockDecoder decoder(b);
+        while (decoder.next(rec) && rec.seq < toSeq) {
+            if (rec.seq >= fromSeq) fn(rec);
+        }
+    }
+}
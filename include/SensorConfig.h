@@ -0,0 +1,19 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Description: Static description of one moisture sensor. The firmware keeps a constant
+// table of these, and every per-sensor code path iterates over it.
+struct SensorConfig {
+    const char* name;          // Plant name shown in the dashboard and alerts
+    uint8_t pin;               // ADC GPIO the sensor is wired to
+    int16_t dryThreshold;      // Raw reading above which the soil counts as dry
+    int16_t airValue;          // Calibration: raw reading in dry air (0 % moisture)
+    int16_t waterValue;        // Calibration: raw reading in water (100 % moisture)
+    const char* basePath;      // Prefix of this sensor's history files in SPIFFS
+};
+
+// The sensor table, defined in main.cpp. Declared here for the host tools that drive it.
+extern const SensorConfig SENSORS[];
+extern const size_t SENSOR_COUNT;
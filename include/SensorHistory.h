@@ -0,0 +1,93 @@
+#pragma once
+
+#include "SampleLog.h"
+
+// Description: Aggregate of all samples in one fixed time window, as stored in a
+// rollup tier. The mean is sum / count.
+struct RollupRecord {
+    uint32_t seq;
+    uint32_t timestamp;    // Epoch seconds at the start of the window
+    int32_t sum;
+    uint32_t count;
+    int16_t min;
+    int16_t max;
+    uint16_t reserved;
+    uint16_t crc;
+};
+
+typedef RingBuffer<RollupRecord> RollupLog;
+
+// Description: Window width and retention budget of one rollup tier.
+struct RollupTierConfig {
+    uint32_t width;        // Seconds; each tier's width must divide the next one's
+    uint32_t capacity;     // Records kept before the oldest is overwritten
+    const char* suffix;    // Appended to the sensor's base path to name the file
+};
+
+static const size_t ROLLUP_TIER_COUNT = 3;
+
+// Description: All stored history for one sensor: the compressed raw sample log plus rollup tiers
+// (e.g. 10-minute, hourly, daily) that are updated incrementally as each sample arrives.
+// Each tier keeps its current window open in RAM and appends it when a sample lands in
+// a later window, so maintaining the tiers costs O(1) per sample. After a reboot the
+// open windows, and closed windows a crash kept from reaching flash, are rebuilt from
+// the next finer tier.
+class SensorHistory {
+public:
+    // Opens (or creates) "<basePath>.log" for raw samples, `rawBlocks` SampleBlocks long,
+    // and one file per tier.
+    bool begin(fs::FS& fs, const char* basePath, uint32_t rawBlocks,
+               const RollupTierConfig (&tiers)[ROLLUP_TIER_COUNT]);
+
+    // Appends a raw sample and folds it into every tier.
+    bool append(uint32_t timestamp, int16_t value);
+
+    SampleLog& raw() { return raw_; }
+    RollupLog& tier(size_t index) { return tiers_[index]; }
+    uint32_t tierWidth(size_t index) const { return config_[index].width; }
+
+    // Returns the coarsest tier whose windows are no wider than `bucketWidth`, or -1
+    // if only raw samples are fine enough.
+    int tierFor(uint32_t bucketWidth) const;
+
+    // Number of windows in [from, to] that forEachRollup() will visit.
+    uint32_t rollupCount(size_t index, uint32_t from, uint32_t to);
+
+    // Oldest timestamp still held by any tier, and the newest raw sample's timestamp.
+    // Both are 0 when nothing has been logged yet.
+    uint32_t oldestTimestamp();
+    uint32_t newestTimestamp();
+
+    // Write generation: grows with every append and never changes otherwise, so a response
+    // built from this history stays valid for as long as the generation is the same.
+    uint32_t generation() const { return raw_.nextSeq(); }
+
+    // Calls fn(const RollupRecord&) for each window of the tier that starts in
+    // [from, to], oldest first, including the still-open current window.
+    template <typename Fn>
+    void forEachRollup(size_t index, uint32_t from, uint32_t to, Fn fn);
+
+private:
+    static const size_t PATH_LENGTH = 24;
+    static const uint32_t TIER_CHECKPOINT_INTERVAL = 64;   // Tier appends between header writes
+
+    static void merge(RollupRecord& into, uint32_t start, const RollupRecord& from);
+    void rebuildOpenWindows();
+    void seqRange(size_t index, uint32_t from, uint32_t to, uint32_t& fromSeq, uint32_t& toSeq);
+    bool openInRange(size_t index, uint32_t from, uint32_t to) const;
+    uint32_t windowStart(size_t index, uint32_t timestamp) const { return timestamp - timestamp % config_[index].width; }
+
+    const RollupTierConfig* config_ = nullptr;
+    char paths_[ROLLUP_TIER_COUNT + 1][PATH_LENGTH] = {};
+    SampleLog raw_;
+    RollupLog tiers_[ROLLUP_TIER_COUNT];
+    RollupRecord open_[ROLLUP_TIER_COUNT] = {};
+};
+
+template <typename Fn>
+void SensorHistory::forEachRollup(size_t index, uint32_t from, uint32_t to, Fn fn) {
+    uint32_t fromSeq, toSeq;
+    seqRange(index, from, to, fromSeq, toSeq);
+    tiers_[index].forEach(fromSeq, toSeq, fn);
+    if (openInRange(index, from, to)) fn(open_[index]);
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+
+// Description: Fixed-size single-producer/single-consumer ring queue. push() is only called
+// from one task and pop() from one other task; neither ever blocks or takes a lock, so the
+// producer's timing does not depend on how busy the consumer is. Capacity must be a power
+// of two; one slot is never used, to tell a full queue from an empty one.
+template <typename T, size_t Capacity>
+class SpscQueue {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    // Producer side. Returns false, leaving the queue unchanged, if it is full.
+    bool push(const T& item) {
+        size_t head = head_.load(std::memory_order_relaxed);
+        size_t next = (head + 1) & (Capacity - 1);
+        if (next == tail_.load(std::memory_order_acquire)) return false;
+        items_[head] = item;
+        head_.store(next, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side. Returns false if the queue is empty.
+    bool pop(T& item) {
+        size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail == head_.load(std::memory_order_acquire)) return false;
+        item = items_[tail];
+        tail_.store((tail + 1) & (Capacity - 1), std::memory_order_release);
+        return true;
+    }
+
+    size_t size() const {
+        return (head_.load(std::memory_order_acquire) - tail_.load(std::memory_order_acquire)) & (Capacity - 1);
+    }
+
+private:
+    T items_[Capacity];
+    std::atomic<size_t> head_{0};
+    std::atomic<size_t> tail_{0};
+};
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <Arduino.h>
+
+// Description: A gzip-compressed file stored in flash. The table is generated from web/
+// by scripts/build_web.py, which runs before every PlatformIO build.
+struct WebAsset {
+    const char* path;          // URL path, e.g. "/"
+    const char* contentType;
+    const char* cacheControl;
+    const char* etag;          // Quoted content hash of the compressed bytes
+    const uint8_t* data;       // Gzip stream, served as-is
+    size_t length;
+};
+
+extern const WebAsset WEB_ASSETS[];
+extern const size_t WEB_ASSET_COUNT;
@@ -0,0 +1,147 @@
+#pragma once
+// Synthetic soil moisture traces for the replay tool. Each sensor follows a drying curve
+// that runs faster during the day, is watered some time after it turns dry, and reads
+// through ADC noise with occasional dropouts of a loose or shorted probe. Each conversion
+// has its own noise, and now and then a spike of the kind Wi-Fi transmit bursts cause.
+
+#include <math.h>
+#include <stdint.h>
+#include "SensorConfig.h"
+
+struct TraceOptions {
+    uint32_t seed = 1;
+    bool flapping = false;           // Soil settles right at the dry threshold between waterings
+    double noiseCounts = 12;         // Standard deviation of the ADC noise
+    double spikesPerConversion = 0.03;
+    double spikeCounts = 400;        // Typical spike size, either direction
+    double dropoutsPerDay = 0.5;     // Average dropouts per sensor per day
+};
+
+class TraceGenerator {
+public:
+    static const uint32_t SECONDS_PER_DAY = 86400;
+
+    // `sensor` selects one of SENSORS; traces of different sensors are independent.
+    TraceGenerator(const SensorConfig& sensor, uint32_t sensorIndex, const TraceOptions& options)
+        : sensor_(sensor), options_(options), rng_((options.seed * 2654435761u + sensorIndex * 40503u) | 1) {
+        moisture_ = 0.6 + 0.3 * uniform();
+        dryFraction_ = fractionOf(sensor.dryThreshold);
+        // Drying from wet to the threshold takes 4 to 8 days, depending on the plant
+        double days = 4 + 4 * uniform();
+        dryingRate_ = log(0.95 / (dryFraction_ > 0.01 ? dryFraction_ : 0.01)) / (days * SECONDS_PER_DAY);
+    }
+
+    // Advances the soil by `seconds` to epoch `timestamp`.
+    void step(uint32_t timestamp, uint32_t seconds) {
+        advance(timestamp, seconds);
+
+        if (dropoutLeft_ > 0) {
+            dropoutLeft_--;
+            dropout_ = true;
+        } else if (uniform() < options_.dropoutsPerDay * seconds / SECONDS_PER_DAY) {
+            // A probe that lost contact floats high, a shorted one reads zero
+            dropoutLeft_ = (uint32_t)(uniform() * 12);
+            dropoutValue_ = uniform() < 0.5 ? 4095 : 0;
+            dropout_ = true;
+        } else {
+            dropout_ = false;
+        }
+    }
+
+    // The reading a noiseless ADC would give now.
+    int level() const {
+        if (dropout_) return dropoutValue_;
+        return (int)lround(sensor_.airValue - moisture_ * (sensor_.airValue - sensor_.waterValue));
+    }
+
+    // One ADC conversion now: what analogRead() returns.
+    int read() {
+        if (dropout_) return dropoutValue_;
+        double raw = sensor_.airValue - moisture_ * (sensor_.airValue - sensor_.waterValue) + gaussian() * options_.noiseCounts;
+        if (spikeLeft_ > 0) {
+            spikeLeft_--;
+            raw += spike_;
+        } else if (uniform() < options_.spikesPerConversion) {
+            // A transmit burst lasts for one to three conversions
+            spikeLeft_ = (uint32_t)(uniform() * 3);
+            spike_ = options_.spikeCounts * (0.5 + uniform()) * (uniform() < 0.5 ? -1 : 1);
+            raw += spike_;
+        }
+        if (raw < 0) raw = 0;
+        if (raw > 4095) raw = 4095;
+        return (int)raw;
+    }
+
+    // Advances the soil by `seconds` and returns one raw ADC reading at epoch `timestamp`.
+    int next(uint32_t timestamp, uint32_t seconds) {
+        step(timestamp, seconds);
+        return read();
+    }
+
+    uint32_t waterings() const { return waterings_; }
+
+private:
+    double fractionOf(int raw) const {
+        return (double)(sensor_.airValue - raw) / (sensor_.airValue - sensor_.waterValue);
+    }
+
+    void advance(uint32_t timestamp, uint32_t seconds) {
+        if (soakLeft_ > 0) {
+            // Water soaks in over about half an hour
+            moisture_ += (wetTarget_ - moisture_) * (1 - exp(-(double)seconds / 600));
+            soakLeft_ = soakLeft_ > seconds ? soakLeft_ - seconds : 0;
+            return;
+        }
+
+        // Evaporation peaks in the afternoon and nearly stops at night
+        double hour = fmod((double)timestamp / 3600, 24);
+        double daylight = 1 + 0.8 * sin((hour - 9) * M_PI / 12);
+        double driest = options_.flapping ? dryFraction_ : 0.05;
+        moisture_ = driest + (moisture_ - driest) * exp(-dryingRate_ * daylight * seconds);
+
+        if (moisture_ < dryFraction_ + 0.005 && wateringDue_ == 0) {
+            // The owner notices after a few hours to two days, or after a week when the
+            // soil never gets properly dry
+            double delay = options_.flapping ? 5 + 2 * uniform() : 0.1 + 2 * uniform();
+            wateringDue_ = timestamp + (uint32_t)(delay * SECONDS_PER_DAY);
+        }
+        if (wateringDue_ != 0 && timestamp >= wateringDue_) {
+            wateringDue_ = 0;
+            wetTarget_ = 0.85 + 0.12 * uniform();
+            soakLeft_ = 3600;
+            waterings_++;
+        }
+    }
+
+    // xorshift32, so a seed gives the same trace on every host
+    uint32_t random() {
+        rng_ ^= rng_ << 13;
+        rng_ ^= rng_ >> 17;
+        rng_ ^= rng_ << 5;
+        return rng_;
+    }
+
+    double uniform() { return (random() >> 8) / 16777216.0; }
+
+    double gaussian() {
+        double u = uniform();
+        if (u < 1e-12) u = 1e-12;
+        return sqrt(-2 * log(u)) * cos(2 * M_PI * uniform());
+    }
+
+    const SensorConfig& sensor_;
+    TraceOptions options_;
+    uint32_t rng_;
+    double moisture_;          // 0 = dry air, 1 = water
+    double dryFraction_;       // Moisture at the dry threshold
+    double dryingRate_;        // Per second, at average daylight
+    double wetTarget_ = 0;
+    uint32_t soakLeft_ = 0;
+    uint32_t wateringDue_ = 0;
+    uint32_t waterings_ = 0;
+    uint32_t dropoutLeft_ = 0;
+    int dropoutValue_ = 0;
+    bool dropout_ = false;
+    uint32_t spikeLeft_ = 0;
+    double spike_ = 0;
+};
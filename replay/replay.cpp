@@ -0,0 +1,292 @@
+// Replays weeks or months of synthetic moisture readings through the firmware's sampling
+// and logging path in accelerated time, while HTTP clients load the dashboard and /log.
+// Built by the `replay` environment against the host stand-ins in host/:
+//   pio run -e replay -t exec
+//
+// Options:
+//   --days N       simulated days (default 30)
+//   --interval S   seconds between sampling rounds (default 600, as in production)
+//   --clients N    concurrent HTTP clients, each on its own keep-alive connection (default 4)
+//   --speed X      simulated seconds per real second; 0 replays as fast as possible (default)
+//   --seed N       trace seed (default 1)
+//   --flapping     soil hovers at the dry threshold, as with a sensor placed at the edge
+//                  of the pot
+//   --trace FILE   also write the generated readings, before ADC noise, to FILE as
+//                  timestamp,sensor,value
+//
+// The result is one JSON object:
+//   {"replay":"steady","days":30,"samples":8640,...,"flash_bytes_per_day":5120.0,
+//    "dry_alerts_per_day":0.4,"forecast_alerts_per_day":0.4,"rps":5400.0,"p50_us":210.5,"p99_us":3400.2,"peak_heap_bytes":11264,
+//    "allocs_per_round":0.00,"allocs_per_request":0.00,"reading_rms_error":3.4}
+// `peak_heap_bytes` is the most heap the firmware code held at once on the replay and
+// HTTP server threads. `allocs_per_round` and `allocs_per_request` count heap allocations
+// after the first simulated day; anything above zero fragments the heap over time.
+// `reading_rms_error` compares each logged reading with the noiseless one, dropouts
+// aside. The flash figures follow the build's PRODUCTION_MODE settings.
+
+#include <Arduino.h>
+#include <SPIFFS.h>
+#include <freertos/task.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <new>
+#include <stdlib.h>
+#include <thread>
+#include <vector>
+#include "AdcFilter.h"
+#include "AlertDispatcher.h"
+#include "BenchClient.h"
+#include "HttpServer.h"
+#include "SensorConfig.h"
+#include "TraceGenerator.h"
+
+void setup();
+void loop();
+void sampleSensors(uint32_t timestamp, bool wallClock);
+bool processSamples();
+extern HttpServer server;
+extern AlertDispatcher alerts;
+extern uint32_t dryAlerts;
+extern uint32_t forecastAlerts;
+extern AdcReading adcReadings[];
+
+static const uint32_t FIRST_TIMESTAMP = 1700000000;
+
+// What a dashboard visitor loads, requested in turn by every client
+static const char* const LOAD_MIX[] = {
+    "/",
+    "/log?sensor=1",
+    "/log?sensor=2",
+};
+
+// Description: Heap accounting. Every allocation carries a small header with its size, and
+// allocations made on threads marked with trackHeap count towards liveHeap and peakHeap.
+static const size_t HEAP_HEADER = 16;
+static thread_local bool trackHeap = false;
+static std::atomic<size_t> liveHeap(0);
+static std::atomic<size_t> peakHeap(0);
+
+// Description: Allocation counts of the replay thread (sampling and storage) and of the HTTP
+// server thread. Counting starts once the first simulated day has warmed up the files and
+// connections, so the figures show the steady state, which should allocate nothing.
+static thread_local std::atomic<uint64_t>* allocationCount = nullptr;
+static std::atomic<uint64_t> roundAllocations(0);
+static std::atomic<uint64_t> requestAllocations(0);
+static uint64_t warmRequestAllocations = 0;
+static uint32_t warmRequests = 0;
+static uint32_t measuredRounds = 0;
+
+static void* allocate(size_t size) {
+    char* block = (char*)malloc(size + HEAP_HEADER);
+    if (!block) return nullptr;
+    *(size_t*)block = trackHeap ? size : 0;
+    if (allocationCount) (*allocationCount)++;
+    if (trackHeap) {
+        size_t live = liveHeap += size;
+        size_t peak = peakHeap;
+        while (live > peak && !peakHeap.compare_exchange_weak(peak, live)) {}
+    }
+    return block + HEAP_HEADER;
+}
+
+static void release(void* p) {
+    if (!p) return;
+    char* block = (char*)p - HEAP_HEADER;
+    liveHeap -= *(size_t*)block;
+    free(block);
+}
+
+void* operator new(size_t size) {
+    void* p = allocate(size);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+void* operator new[](size_t size) { return operator new(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return allocate(size); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return allocate(size); }
+void operator delete(void* p) noexcept { release(p); }
+void operator delete[](void* p) noexcept { release(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { release(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { release(p); }
+
+struct ReplayOptions {
+    uint32_t days = 30;
+    uint32_t interval = 600;
+    uint32_t clients = 4;
+    double speed = 0;
+    const char* traceFile = nullptr;
+    TraceOptions trace;
+};
+
+// The sensors being sampled, converted by analogRead() through hostAnalogRead
+static std::vector<TraceGenerator>* replayTraces;
+static double squaredError = 0;
+static uint32_t comparedReadings = 0;
+
+static int replayAnalogRead(uint8_t pin) {
+    for (size_t i = 0; i < SENSOR_COUNT; ++i) {
+        if (SENSORS[i].pin == pin) return (*replayTraces)[i].read();
+    }
+    return 0;
+}
+
+static double nowNanos() {
+    return (double)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+static bool parseOptions(int argc, char** argv, ReplayOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        const char* name = argv[i];
+        const char* value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (strcmp(name, "--flapping") == 0) {
+            options.trace.flapping = true;
+            continue;
+        }
+        if (!value) return false;
+        if (strcmp(name, "--days") == 0) options.days = strtoul(value, nullptr, 10);
+        else if (strcmp(name, "--interval") == 0) options.interval = strtoul(value, nullptr, 10);
+        else if (strcmp(name, "--clients") == 0) options.clients = strtoul(value, nullptr, 10);
+        else if (strcmp(name, "--speed") == 0) options.speed = strtod(value, nullptr);
+        else if (strcmp(name, "--seed") == 0) options.trace.seed = strtoul(value, nullptr, 10);
+        else if (strcmp(name, "--trace") == 0) options.traceFile = value;
+        else return false;
+        ++i;
+    }
+    return options.days > 0 && options.interval > 0;
+}
+
+// Description: Runs the trace through sampleSensors() and processSamples(), the code of the
+// sampling and storage tasks, one round per interval of simulated time. With a speed set,
+// each round waits until its simulated time is due.
+static uint32_t replay(const ReplayOptions& options, std::vector<TraceGenerator>& traces, FILE* traceOut) {
+    uint32_t rounds = (uint32_t)((uint64_t)options.days * TraceGenerator::SECONDS_PER_DAY / options.interval);
+    double start = nowNanos();
+
+    uint32_t warmRounds = std::min(rounds - 1, TraceGenerator::SECONDS_PER_DAY / options.interval);
+    for (uint32_t round = 0; round < rounds; ++round) {
+        if (round == warmRounds) {
+            warmRequests = server.requestCount();
+            warmRequestAllocations = requestAllocations;
+            allocationCount = &roundAllocations;
+        }
+        uint32_t timestamp = FIRST_TIMESTAMP + round * options.interval;
+        for (size_t i = 0; i < SENSOR_COUNT; ++i) {
+            traces[i].step(timestamp, options.interval);
+            if (traceOut) fprintf(traceOut, "%lu,%u,%d\n", (unsigned long)timestamp, (unsigned)(i + 1), traces[i].level());
+        }
+        sampleSensors(timestamp, true);
+        for (size_t i = 0; i < SENSOR_COUNT; ++i) {
+            int level = traces[i].level();
+            if (level <= 0 || level >= AdcFilter::ADC_MAX) continue;
+            double error = adcReadings[i].value - level;
+            squaredError += error * error;
+            comparedReadings++;
+        }
+        processSamples();
+
+        if (options.speed > 0) {
+            double due = start + (double)(round + 1) * options.interval / options.speed * 1e9;
+            double wait = due - nowNanos();
+            if (wait > 0) std::this_thread::sleep_for(std::chrono::nanoseconds((long long)wait));
+        }
+    }
+    allocationCount = nullptr;
+    measuredRounds = rounds - warmRounds;
+    return rounds;
+}
+
+int main(int argc, char** argv) {
+    ReplayOptions options;
+    if (!parseOptions(argc, argv, options)) {
+        fprintf(stderr, "usage: %s [--days N] [--interval S] [--clients N] [--speed X] [--seed N] [--flapping] [--trace FILE]\n",
+                argv[0]);
+        return 2;
+    }
+    FILE* traceOut = nullptr;
+    if (options.traceFile && !(traceOut = fopen(options.traceFile, "w"))) {
+        perror(options.traceFile);
+        return 1;
+    }
+
+    // The replay below does the work of the sampling and storage tasks; only the alert
+    // dispatcher runs as a task, against the HTTPClient stand-in
+    Serial.quiet = true;
+    hostTaskOnly = "alerts";
+    hostAnalogRead = replayAnalogRead;
+    setup();
+
+    if (!server.begin(0)) return 1;
+    std::atomic<bool> done(false);
+    std::atomic<bool> serverDone(false);
+    std::thread serverThread([&serverDone]() {
+        trackHeap = true;
+        allocationCount = &requestAllocations;
+        while (!serverDone) loop();
+    });
+
+    std::vector<TraceGenerator> traces;
+    for (size_t i = 0; i < SENSOR_COUNT; ++i) traces.emplace_back(SENSORS[i], i, options.trace);
+    replayTraces = &traces;
+
+    std::vector<std::vector<double>> latencies(options.clients);
+    std::vector<std::thread> clients;
+    std::atomic<uint32_t> failures(0);
+    for (uint32_t c = 0; c < options.clients; ++c) {
+        clients.emplace_back([&, c]() {
+            BenchClient client;
+            if (!client.connect(server.port())) {
+                failures++;
+                return;
+            }
+            for (size_t i = c; !done; ++i) {
+                double start = nowNanos();
+                if (client.get(LOAD_MIX[i % (sizeof(LOAD_MIX) / sizeof(LOAD_MIX[0]))]) < 0) failures++;
+                latencies[c].push_back(nowNanos() - start);
+            }
+        });
+    }
+
+    size_t flashBefore = SPIFFS.bytesWritten;
+    double start = nowNanos();
+    trackHeap = true;
+    uint32_t rounds = replay(options, traces, traceOut);
+    trackHeap = false;
+    double elapsed = nowNanos() - start;
+    size_t flashBytes = SPIFFS.bytesWritten - flashBefore;
+    uint32_t measuredRequests = server.requestCount() - warmRequests;
+    uint64_t measuredRequestAllocations = requestAllocations - warmRequestAllocations;
+
+    // Clients first, so none waits on a server that stopped
+    done = true;
+    for (std::thread& t : clients) t.join();
+    serverDone = true;
+    serverThread.join();
+    if (traceOut) fclose(traceOut);
+
+    std::vector<double> all;
+    for (const auto& l : latencies) all.insert(all.end(), l.begin(), l.end());
+    std::sort(all.begin(), all.end());
+    auto percentile = [&all](double p) { return all.empty() ? 0 : all[(size_t)(all.size() * p)] / 1e3; };
+
+    uint32_t waterings = 0;
+    for (const TraceGenerator& trace : traces) waterings += trace.waterings();
+
+    printf("{\"replay\":\"%s\",\"days\":%u,\"interval\":%u,\"sensors\":%u,\"samples\":%u,\"seconds\":%.2f,"
+           "\"speedup\":%.0f,\"flash_bytes_per_day\":%.1f,\"waterings\":%u,\"dry_alerts_per_day\":%.2f,"
+           "\"forecast_alerts_per_day\":%.2f,\"alerts_dropped\":%u,\"clients\":%u,\"requests\":%u,\"failures\":%u,\"rps\":%.1f,"
+           "\"p50_us\":%.1f,\"p90_us\":%.1f,\"p99_us\":%.1f,\"max_us\":%.1f,\"peak_heap_bytes\":%u,"
+           "\"allocs_per_round\":%.2f,\"allocs_per_request\":%.2f,\"reading_rms_error\":%.1f}\n",
+           options.trace.flapping ? "flapping" : "steady", (unsigned)options.days, (unsigned)options.interval,
+           (unsigned)SENSOR_COUNT, (unsigned)(rounds * SENSOR_COUNT), elapsed / 1e9,
+           (double)options.days * TraceGenerator::SECONDS_PER_DAY / (elapsed / 1e9),
+           (double)flashBytes / options.days, (unsigned)waterings, (double)dryAlerts / options.days,
+           (double)forecastAlerts / options.days, (unsigned)alerts.droppedCount(), (unsigned)options.clients, (unsigned)all.size(), (unsigned)failures,
+           all.size() / (elapsed / 1e9), percentile(0.5), percentile(0.9), percentile(0.99),
+           all.empty() ? 0 : all.back() / 1e3, (unsigned)peakHeap,
+           measuredRounds ? (double)roundAllocations / measuredRounds : 0,
+           measuredRequests ? (double)measuredRequestAllocations / measuredRequests : 0,
+           comparedReadings ? sqrt(squaredError / comparedReadings) : 0);
+    return 0;
+}
@@ -0,0 +1,136 @@
+"""Compresses the dashboard in web/ into flash-resident assets.
+
+Runs as a PlatformIO pre-build script (see extra_scripts in platformio.ini) and can
+also be run by hand: `python scripts/build_web.py`. Every asset is gzipped
+deterministically and tagged with a content hash, then written as byte arrays to
+src/generated/WebAssets.cpp. The firmware serves them as-is with
+Content-Encoding: gzip and a strong ETag.
+
+Chart.js and its annotation plugin are pinned below and downloaded once into
+web/vendor/, so the board never needs internet access to render the dashboard. Each
+file must match its pinned SHA-256 before it is written to web/vendor/ or embedded in
+the firmware; a changed CDN file or a tampered local copy stops the build.
+
+Only the environments that compile src/generated/ run this script (see platformio.ini).
+"""
+
+import gzip
+import hashlib
+import os
+import sys
+import urllib.request
+
+try:
+    Import("env")  # noqa: F821 - provided by PlatformIO
+    PROJECT_DIR = env.subst("$PROJECT_DIR")  # noqa: F821
+    # Host builds (bench, tests, replay, gateway) only need the assets to compile and
+    # serve locally; they never reach a board
+    HOST_BUILD = env.subst("$PIOPLATFORM") == "native"  # noqa: F821
+except NameError:
+    PROJECT_DIR = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+    HOST_BUILD = False
+
+WEB_DIR = os.path.join(PROJECT_DIR, "web")
+VENDOR_DIR = os.path.join(WEB_DIR, "vendor")
+OUTPUT = os.path.join(PROJECT_DIR, "src", "generated", "WebAssets.cpp")
+
+# File name -> (URL, SHA-256 of the file). When upgrading, download the new file, check it
+# against the project's release, and pin its digest here. An empty digest stops a
+# firmware build and prints the digest of what was downloaded; host builds only warn.
+VENDOR = {
+    "chart.umd.min.js": (
+        "https://cdn.jsdelivr.net/npm/chart.js@4.4.1/dist/chart.umd.min.js",
+        "",
+    ),
+    "chartjs-plugin-annotation.min.js": (
+        "https://cdn.jsdelivr.net/npm/chartjs-plugin-annotation@3.0.1/dist/chartjs-plugin-annotation.min.js",
+        "",
+    ),
+}
+
+# (URL path, source file, content type, Cache-Control)
+ASSETS = [
+    ("/", os.path.join(WEB_DIR, "index.html"), "text/html", "no-cache"),
+    ("/chart.umd.min.js", os.path.join(VENDOR_DIR, "chart.umd.min.js"),
+     "application/javascript", "public, max-age=604800"),
+    ("/chartjs-plugin-annotation.min.js", os.path.join(VENDOR_DIR, "chartjs-plugin-annotation.min.js"),
+     "application/javascript", "public, max-age=604800"),
+]
+
+
+def check_digest(name, data, source):
+    expected = VENDOR[name][1]
+    actual = hashlib.sha256(data).hexdigest()
+    if not expected:
+        message = ("%s from %s has no pinned SHA-256. Check it against the upstream release, then pin\n"
+                   "    %s\nin VENDOR in scripts/build_web.py." % (name, source, actual))
+        if not HOST_BUILD:
+            sys.exit(message)
+        print("Warning: " + message + "\nEmbedding it anyway in this host build.")
+        return
+    if actual != expected:
+        sys.exit("%s from %s does not match its pinned SHA-256\n    expected %s\n    got      %s"
+                 % (name, source, expected, actual))
+
+
+def fetch_vendor():
+    """Downloads missing vendor files and verifies every one, downloaded or already present."""
+    os.makedirs(VENDOR_DIR, exist_ok=True)
+    for name, (url, _) in VENDOR.items():
+        path = os.path.join(VENDOR_DIR, name)
+        if os.path.exists(path):
+            with open(path, "rb") as f:
+                check_digest(name, f.read(), path)
+            continue
+        print("Fetching %s" % url)
+        try:
+            with urllib.request.urlopen(url, timeout=30) as response:
+                data = response.read()
+        except OSError as e:
+            sys.exit("Could not download %s (%s). Place the file in %s by hand." % (url, e, VENDOR_DIR))
+        check_digest(name, data, url)
+        with open(path, "wb") as f:
+            f.write(data)
+
+
+def c_array(name, data):
+    lines = []
+    for i in range(0, len(data), 16):
+        lines.append("    " + ", ".join("0x%02x" % b for b in data[i:i + 16]) + ",")
+    return "static const uint8_t %s[] PROGMEM = {\n%s\n};\n" % (name, "\n".join(lines))
+
+
+def generate():
+    fetch_vendor()
+
+    arrays = []
+    entries = []
+    for index, (path, source, content_type, cache_control) in enumerate(ASSETS):
+        with open(source, "rb") as f:
+            raw = f.read()
+        compressed = gzip.compress(raw, compresslevel=9, mtime=0)
+        etag = hashlib.sha256(compressed).hexdigest()[:16]
+        name = "ASSET_%d" % index
+        arrays.append("// %s: %d bytes, %d gzipped\n%s" % (path, len(raw), len(compressed), c_array(name, compressed)))
+        entries.append('    {"%s", "%s", "%s", "\\"%s\\"", %s, sizeof(%s)},'
+                       % (path, content_type, cache_control, etag, name, name))
+
+    source = (
+        "// Generated by scripts/build_web.py from web/. Do not edit.\n"
+        "#include \"WebAssets.h\"\n\n"
+        + "\n".join(arrays)
+        + "\nconst WebAsset WEB_ASSETS[] = {\n" + "\n".join(entries) + "\n};\n\n"
+        + "const size_t WEB_ASSET_COUNT = sizeof(WEB_ASSETS) / sizeof(WEB_ASSETS[0]);\n"
+    )
+
+    os.makedirs(os.path.dirname(OUTPUT), exist_ok=True)
+    if os.path.exists(OUTPUT):
+        with open(OUTPUT) as f:
+            if f.read() == source:
+                return
+    with open(OUTPUT, "w") as f:
+        f.write(source)
+    print("Generated %s" % os.path.relpath(OUTPUT, PROJECT_DIR))
+
+
+generate()
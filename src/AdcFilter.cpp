@@ -0,0 +1,74 @@
+#include "AdcFilter.h"
+#include <Arduino.h>
+
+static const float IQR_TO_SIGMA = 1.349f;   // Interquartile range of a normal distribution, in sigmas
+
+static uint16_t median3(uint16_t a, uint16_t b, uint16_t c) {
+    if (a > b) {
+        uint16_t t = a;
+        a = b;
+        b = t;
+    }
+    return c <= a ? a : (c >= b ? b : c);
+}
+
+AdcReading AdcFilter::read(uint8_t pin) {
+    uint16_t burst[BURST_SIZE];
+    for (size_t i = 0; i < BURST_SIZE; ++i) burst[i] = (uint16_t)analogRead(pin);
+    return reduce(burst, BURST_SIZE);
+}
+
+// Description: Batcher's odd-even merge sort as a fixed network of compare-exchange steps
+// over BURST_SIZE slots, 191 of them for 32. Which slots are compared depends only on
+// their positions, never on the values, so every burst costs the same.
+static void sortNetwork(uint16_t* v, size_t n) {
+    for (size_t p = 1; p < n; p += p) {
+        for (size_t k = p; k > 0; k /= 2) {
+            for (size_t j = k % p; j + k < n; j += k + k) {
+                for (size_t i = 0; i < k && i + j + k < n; ++i) {
+                    // Only slots in the same block of 2p are merged
+                    if (((i + j) ^ (i + j + k)) >= p + p) continue;
+                    uint16_t a = v[i + j];
+                    uint16_t b = v[i + j + k];
+                    v[i + j] = a < b ? a : b;
+                    v[i + j + k] = a < b ? b : a;
+                }
+            }
+        }
+    }
+}
+
+// Description: Median of three over neighbouring conversions, then a sorting network. A
+// shorter burst is padded with the highest value, which sorts to the end.
+AdcReading AdcFilter::reduce(uint16_t* burst, size_t count) {
+    if (count == 0) return {0, 0};
+    if (count > BURST_SIZE) count = BURST_SIZE;
+    if (count >= 3) {
+        uint16_t previous = burst[0];
+        for (size_t i = 1; i + 1 < count; ++i) {
+            uint16_t current = burst[i];
+            burst[i] = median3(previous, current, burst[i + 1]);
+            previous = current;
+        }
+    }
+    uint16_t sorted[BURST_SIZE];
+    for (size_t i = 0; i < BURST_SIZE; ++i) sorted[i] = i < count ? burst[i] : UINT16_MAX;
+    sortNetwork(sorted, BURST_SIZE);
+    memcpy(burst, sorted, count * sizeof(uint16_t));
+
+    size_t trim = count / 4;
+    uint32_t sum = 0;
+    for (size_t i = trim; i < count - trim; ++i) sum += burst[i];
+    size_t kept = count - 2 * trim;
+    AdcReading reading;
+    reading.value = (int16_t)((sum + kept / 2) / kept);
+    reading.noise = (burst[count - 1 - trim] - burst[trim]) / IQR_TO_SIGMA;
+    return reading;
+}
+
+float AdcFilter::percent(const SensorConfig& sensor, float value) {
+    float span = sensor.airValue - sensor.waterValue;
+    if (span == 0) return 0;
+    float p = (sensor.airValue - value) * 100 / span;
+    return p < 0 ? 0 : (p > 100 ? 100 : p);
+}
@@ -0,0 +1,205 @@
+#include "AlertDispatcher.h"
+#include "FixedFormat.h"
+#include <HTTPClient.h>
+#include <WiFi.h>
+
+static const uint32_t TASK_STACK_SIZE = 8192;   // TLS handshakes need most of this
+static const UBaseType_t TASK_PRIORITY = 1;
+static const BaseType_t TASK_CORE = 0;          // loop() runs on core 1
+
+bool AlertDispatcher::begin(const char* apiUrl, const char* botToken, const char* chatId) {
+    apiUrl_ = apiUrl;
+    botToken_ = botToken;
+    chatId_ = chatId;
+
+    // The previous synchronous sender did not verify the server certificate either
+    secureClient_.setInsecure();
+
+    queue_ = xQueueCreate(QUEUE_LENGTH, sizeof(Alert));
+    if (!queue_) return false;
+    return xTaskCreatePinnedToCore(taskEntry, "alerts", TASK_STACK_SIZE, this, TASK_PRIORITY, nullptr, TASK_CORE) == pdPASS;
+}
+
+bool AlertDispatcher::enqueue(const char* name, int moisture, float hoursToDry) {
+    Alert alert = {name, moisture, hoursToDry};
+    if (!queue_ || xQueueSend(queue_, &alert, 0) != pdTRUE) {
+        queueFull_++;
+        return false;
+    }
+    return true;
+}
+
+void AlertDispatcher::taskEntry(void* arg) {
+    static_cast<AlertDispatcher*>(arg)->run();
+}
+
+// Description: A newer alert for a sensor that is already in the pending message only
+// updates its reading, so the batch never holds more than one entry per sensor.
+void AlertDispatcher::addToBatch(const Alert& alert) {
+    for (size_t i = 0; i < batchCount_; ++i) {
+        if (batch_[i].name == alert.name) {
+            batch_[i] = alert;
+            return;
+        }
+    }
+    if (batchCount_ < MAX_BATCH) {
+        batch_[batchCount_++] = alert;
+    } else {
+        dropped_++;
+    }
+}
+
+void AlertDispatcher::removeFromBatch(size_t count) {
+    memmove(batch_, batch_ + count, (batchCount_ - count) * sizeof(Alert));
+    batchCount_ -= count;
+    if (batchCount_ == 0) oneAtATime_ = false;
+}
+
+void AlertDispatcher::run() {
+    uint32_t backoff = INITIAL_BACKOFF_MILLIS;
+    TickType_t nextAttempt = 0;
+
+    for (;;) {
+        // Idle until an alert arrives, or until the next retry is due
+        TickType_t wait = portMAX_DELAY;
+        if (batchCount_ > 0) {
+            int32_t remaining = (int32_t)(nextAttempt - xTaskGetTickCount());
+            wait = remaining > 0 ? (TickType_t)remaining : 0;
+        }
+
+        Alert alert;
+        if (xQueueReceive(queue_, &alert, wait) == pdTRUE) {
+            addToBatch(alert);
+            while (xQueueReceive(queue_, &alert, pdMS_TO_TICKS(COALESCE_MILLIS)) == pdTRUE) {
+                addToBatch(alert);
+            }
+        }
+
+        if (batchCount_ == 0 || (int32_t)(nextAttempt - xTaskGetTickCount()) > 0) continue;
+
+        size_t count = oneAtATime_ ? 1 : batchCount_;
+        int code = -1;
+        if (WiFi.status() == WL_CONNECTED) {
+            ScopedLatency latency(sendLatency_);
+            code = sendBatch(count);
+        }
+        if (code == 200) {
+            sent_++;
+            removeFromBatch(count);
+            backoff = INITIAL_BACKOFF_MILLIS;
+        } else if (code >= 400 && code < 500 && code != 429 && count > 1) {
+            // Possibly one bad alert spoiling the message: try them separately, right away
+            logPrintf("Telegram rejected %u alerts with HTTP %d, sending them one at a time\n", (unsigned)count, code);
+            oneAtATime_ = true;
+        } else if (code >= 400 && code < 500 && code != 429) {
+            // Rejected for good (bad token or chat id, or this alert): retrying cannot help
+            logPrintf("Telegram rejected the alert for %s with HTTP %d, dropping it\n", batch_[0].name, code);
+            dropped_++;
+            removeFromBatch(1);
+            backoff = INITIAL_BACKOFF_MILLIS;
+        } else {
+            failed_++;
+            logPrintf("Telegram send failed (%d), retrying in %lu s\n", code, (unsigned long)(backoff / 1000));
+            nextAttempt = xTaskGetTickCount() + pdMS_TO_TICKS(backoff);
+            backoff = backoff * 2 > MAX_BACKOFF_MILLIS ? MAX_BACKOFF_MILLIS : backoff * 2;
+        }
+    }
+}
+
+// Description: Appends `text` as the inside of a JSON string. Text that does not fit is
+// cut between characters, never inside an escape sequence, so the result stays valid.
+template <size_t N>
+static void appendJsonString(FixedFormat<N>& out, const char* text) {
+    char escaped[8];
+    for (; *text; ++text) {
+        unsigned char c = (unsigned char)*text;
+        if (c == '"' || c == '\\') {
+            snprintf(escaped, sizeof(escaped), "\\%c", c);
+        } else if (c < 0x20) {
+            snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+        } else {
+            escaped[0] = (char)c;
+            escaped[1] = '\0';
+        }
+        if (strlen(escaped) > out.room()) return;
+        out.append(escaped);
+    }
+}
+
+// Description: One alert, JSON-escaped. The name is cut to NAME_SIZE so the rest of the
+// line always fits in LINE_SIZE.
+void AlertDispatcher::describe(MessageLine& line, const Alert& alert) const {
+    FixedFormat<NAME_SIZE> name;
+    appendJsonString(name, alert.name);
+    if (alert.hoursToDry < 0) {
+        line.appendf("%s is too dry! Moisture: %d", name.c_str(), alert.moisture);
+    } else {
+        line.appendf("%s will be dry in about %d hours. Moisture: %d", name.c_str(),
+                     (int)(alert.hoursToDry + 0.5f), alert.moisture);
+    }
+}
+
+// Description: Posts the first `count` pending alerts as one message, or as many of them
+// as fit, and sets `count` to the number sent. The body is sized for MAX_BATCH alerts,
+// so only an unusually long chat id makes it split. The HTTP client is set to reuse its
+// connection, so consecutive messages skip the TLS handshake.
+int AlertDispatcher::sendBatch(size_t& count) {
+    FixedFormat<160> url;
+    url.appendf("%s/bot%s/sendMessage", apiUrl_, botToken_);
+    if (url.truncated()) {
+        logPrintf("Telegram API URL is too long\n");
+        return 414;   // As the server would answer: no retry can fix it
+    }
+
+    static const char GREETING[] = "\U0001F335 ";
+    static const char CLOSING[] = "\"}";
+    body_.clear();
+    body_.append("{\"chat_id\":\"");
+    appendJsonString(body_, chatId_);
+    body_.append("\",\"text\":\"");
+    body_.append(GREETING);
+
+    // Room for the lines once the count line and the closing are in
+    MessageLine line;
+    line.appendf("%u plants need water soon!", (unsigned)count);
+    size_t room = body_.room() > line.length() + sizeof(CLOSING) ? body_.room() - line.length() - sizeof(CLOSING) : 0;
+    size_t fit = 0;
+    for (; fit < count; ++fit) {
+        line.clear();
+        if (count > 1) line.append("\\n");
+        describe(line, batch_[fit]);
+        if (line.length() > room) break;
+        room -= line.length();
+    }
+    if (fit == 0) {
+        logPrintf("Telegram chat id is too long\n");
+        return 414;
+    }
+    count = fit;
+
+    if (count > 1) body_.appendf("%u plants need water soon!", (unsigned)count);
+    for (size_t i = 0; i < count; ++i) {
+        line.clear();
+        if (count > 1) line.append("\\n");
+        describe(line, batch_[i]);
+        body_.append(line.c_str(), line.length());
+    }
+    body_.append(CLOSING);
+    if (body_.truncated()) {
+        logPrintf("Telegram message for %u plant(s) does not fit\n", (unsigned)count);
+        return 413;
+    }
+
+    bool secure = strncmp(apiUrl_, "https://", 8) == 0;
+    HTTPClient http;
+    http.setReuse(true);
+    if (!http.begin(secure ? (WiFiClient&)secureClient_ : plainClient_, url.c_str())) return -1;
+    http.addHeader("Content-Type", "application/json");
+    int code = http.POST((uint8_t*)body_.c_str(), body_.length());
+    http.end();
+
+    if (code == 200) {
+        logPrintf("Telegram alert sent for %u plant(s)\n", (unsigned)count);
+    }
+    return code;
+}
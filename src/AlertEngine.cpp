@@ -0,0 +1,95 @@
+#include "AlertEngine.h"
+#include <math.h>
+
+static const float MIN_SLOPE_PER_HOUR = 0.5f;   // Flatter than this is not drying
+
+void AlertEngine::resetTrend(uint32_t timestamp) {
+    trendStart_ = timestamp;
+    w_ = t_ = tt_ = y_ = ty_ = 0;
+}
+
+// Description: Moves the origin to the new sample `hours` later, fades the old samples,
+// then adds the new one at t = 0.
+void AlertEngine::addToTrend(float hours, int16_t value) {
+    float decay = expf(-hours * 3600.0f / TREND_SECONDS);
+    tt_ = (tt_ - 2 * hours * t_ + hours * hours * w_) * decay;
+    ty_ = (ty_ - hours * y_) * decay;
+    t_ = (t_ - hours * w_) * decay;
+    y_ *= decay;
+    w_ *= decay;
+
+    w_ += 1;
+    y_ += value;
+}
+
+float AlertEngine::slopePerHour() const {
+    float denominator = w_ * tt_ - t_ * t_;
+    if (w_ < 2 || denominator <= 1e-6f) return 0;
+    return (w_ * ty_ - t_ * y_) / denominator;
+}
+
+float AlertEngine::hoursToDry() const {
+    if (lastTimestamp_ - trendStart_ < MIN_TREND_SECONDS || ewma_ >= dryThreshold_) return -1;
+    float slope = slopePerHour();
+    if (slope < MIN_SLOPE_PER_HOUR) return -1;
+    return (dryThreshold_ - ewma_) / slope;
+}
+
+AlertEvent AlertEngine::update(uint32_t timestamp, int16_t value) {
+    if (value <= 0 || value >= ADC_MAX) return ALERT_NONE;
+
+    bool restart = !started_ || timestamp < lastTimestamp_ || timestamp - lastTimestamp_ > MAX_GAP_SECONDS;
+    if (!restart && value < ewma_ - WATERING_DROP) {
+        // Held back until enough readings in a row confirm it, so one glitch cannot
+        // reset the trend or re-arm the alert
+        if (++lowSamples_ < WATERING_SAMPLES) return ALERT_NONE;
+    } else {
+        lowSamples_ = 0;
+    }
+
+    if (restart) {
+        started_ = true;
+        samples_ = 1;
+        ewma_ = value;
+        resetTrend(timestamp);
+    } else if (lowSamples_ > 0) {
+        lowSamples_ = 0;
+        samples_ = 1;
+        ewma_ = value;
+        resetTrend(timestamp);
+    } else {
+        uint32_t elapsed = timestamp - lastTimestamp_;
+        float alpha = 1 - expf(-(float)elapsed / SMOOTHING_SECONDS);
+        // Until the EWMA has MIN_SAMPLES readings it averages them, so it does not
+        // hang on to whichever reading happened to come first
+        if (samples_ < MIN_SAMPLES) {
+            samples_++;
+            alpha = fmaxf(alpha, 1.0f / samples_);
+        }
+        ewma_ += alpha * (value - ewma_);
+        addToTrend(elapsed / 3600.0f, value);
+    }
+    if (w_ == 0) addToTrend(0, value);
+    lastTimestamp_ = timestamp;
+
+    if (ewma_ > dryThreshold_) {
+        if (state_ == DRY || samples_ < MIN_SAMPLES) return ALERT_NONE;
+        state_ = DRY;
+        return ALERT_DRY;
+    }
+    bool belowBand = ewma_ < rearmThreshold();
+    if (state_ == DRY) {
+        if (!belowBand) return ALERT_NONE;
+        state_ = MOIST;
+        return ALERT_RECOVERED;
+    }
+
+    float hours = hoursToDry();
+    if (state_ == MOIST && hours >= 0 && hours <= FORECAST_HOURS) {
+        state_ = FORECAST;
+        return ALERT_FORECAST;
+    }
+    // A forecast is withdrawn quietly once the trend no longer points at the threshold
+    if (state_ == FORECAST && belowBand && (hours < 0 || hours > 2 * FORECAST_HOURS)) state_ = MOIST;
+    return ALERT_NONE;
+}
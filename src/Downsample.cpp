@@ -0,0 +1,198 @@
+#include "Downsample.h"
+#include <math.h>
+#include <string.h>
+
+BucketDownsampler::BucketDownsampler(uint32_t from, uint32_t to, uint32_t points) : from_(from) {
+    uint32_t span = (to >= from) ? to - from + 1 : 1;
+    if (points == 0) points = 1;
+    width_ = span / points + (span % points ? 1 : 0);
+    if (width_ == 0) width_ = 1;
+}
+
+void BucketDownsampler::open(uint32_t index, int16_t min, int16_t max, int32_t sum, uint32_t count) {
+    index_ = index;
+    cur_.start = from_ + index * width_;
+    cur_.min = min;
+    cur_.max = max;
+    cur_.count = count;
+    sum_ = sum;
+}
+
+bool BucketDownsampler::add(uint32_t timestamp, int16_t min, int16_t max, int32_t sum, uint32_t count,
+                            SeriesBucket& out) {
+    if (count == 0) return false;
+    uint32_t index = timestamp < from_ ? 0 : (timestamp - from_) / width_;
+
+    if (cur_.count == 0) {
+        open(index, min, max, sum, count);
+        return false;
+    }
+    if (index == index_) {
+        if (min < cur_.min) cur_.min = min;
+        if (max > cur_.max) cur_.max = max;
+        sum_ += sum;
+        cur_.count += count;
+        return false;
+    }
+
+    finish(out);
+    open(index, min, max, sum, count);
+    return true;
+}
+
+bool BucketDownsampler::finish(SeriesBucket& out) {
+    if (cur_.count == 0) return false;
+    cur_.mean = (float)sum_ / cur_.count;
+    out = cur_;
+    cur_.count = 0;
+    return true;
+}
+
+// Description: Cross product of (a - o) and (b - o). Positive for a counter-clockwise turn.
+static int64_t cross(int64_t ox, int64_t oy, int64_t ax, int64_t ay, int64_t bx, int64_t by) {
+    return (ax - ox) * (by - oy) - (ay - oy) * (bx - ox);
+}
+
+void LttbDownsampler::Bucket::reset(uint32_t bucketIndex) {
+    upperCount = 0;
+    lowerCount = 0;
+    sumX = 0;
+    sumY = 0;
+    count = 0;
+    index = bucketIndex;
+}
+
+// Description: Andrew's monotone chain, one step per sample. Samples arrive sorted by
+// time, so each hull is maintained as a stack without re-sorting.
+void LttbDownsampler::Bucket::add(const Vertex& v) {
+    sumX += v.x;
+    sumY += v.y;
+    count++;
+
+    while (upperCount >= 2) {
+        const Vertex& o = upper[upperCount - 2];
+        const Vertex& a = upper[upperCount - 1];
+        if (cross(o.x, o.y, a.x, a.y, v.x, v.y) < 0) break;
+        upperCount--;
+    }
+    if (upperCount == HULL_CAPACITY) {
+        memmove(&upper[1], &upper[2], (HULL_CAPACITY - 2) * sizeof(Vertex));
+        upperCount--;
+    }
+    upper[upperCount++] = v;
+
+    while (lowerCount >= 2) {
+        const Vertex& o = lower[lowerCount - 2];
+        const Vertex& a = lower[lowerCount - 1];
+        if (cross(o.x, o.y, a.x, a.y, v.x, v.y) > 0) break;
+        lowerCount--;
+    }
+    if (lowerCount == HULL_CAPACITY) {
+        memmove(&lower[1], &lower[2], (HULL_CAPACITY - 2) * sizeof(Vertex));
+        lowerCount--;
+    }
+    lower[lowerCount++] = v;
+}
+
+LttbDownsampler::LttbDownsampler(uint32_t count, uint32_t points)
+    : count_(count), points_(points < 3 ? 3 : points) {
+    passthrough_ = count_ <= points_;
+    current_.reset(0);
+}
+
+// Description: Middle buckets split samples 1..count-2 evenly, bucket b starting at
+// sample floor(b * (count-2) / (points-2)) + 1. Sample 0 and the final sample are
+// always kept.
+uint32_t LttbDownsampler::bucketOf(uint32_t sampleIndex) const {
+    uint32_t bucket = ((uint64_t)sampleIndex * (points_ - 2) - 1) / (count_ - 2);
+    return bucket < points_ - 2 ? bucket : points_ - 3;
+}
+
+SeriesPoint LttbDownsampler::toPoint(const Vertex& v) const {
+    SeriesPoint p;
+    p.timestamp = origin_ + (uint32_t)v.x;
+    p.value = (int16_t)v.y;
+    return p;
+}
+
+SeriesPoint LttbDownsampler::select(const Bucket& bucket, double cx, double cy) {
+    const double ax = anchor_.x;
+    const double ay = anchor_.y;
+    double bestArea = -1;
+    Vertex best = bucket.upper[0];
+
+    const Vertex* hulls[2] = {bucket.upper, bucket.lower};
+    const size_t counts[2] = {bucket.upperCount, bucket.lowerCount};
+    for (int h = 0; h < 2; ++h) {
+        for (size_t i = 0; i < counts[h]; ++i) {
+            const Vertex& p = hulls[h][i];
+            double area = fabs((ax - cx) * (p.y - ay) - (ax - p.x) * (cy - ay));
+            if (area > bestArea) {
+                bestArea = area;
+                best = p;
+            }
+        }
+    }
+
+    anchor_ = best;
+    return toPoint(best);
+}
+
+void LttbDownsampler::push(const Vertex& v, uint32_t sampleIndex, bool& emitted, SeriesPoint& out) {
+    uint32_t bucket = bucketOf(sampleIndex);
+    if (current_.count > 0 && bucket != current_.index) {
+        if (hasPending_) {
+            out = select(pending_, current_.sumX / current_.count, current_.sumY / current_.count);
+            emitted = true;
+        }
+        pending_ = current_;
+        hasPending_ = true;
+        current_.reset(bucket);
+    }
+    if (current_.count == 0) current_.index = bucket;
+    current_.add(v);
+}
+
+bool LttbDownsampler::add(uint32_t timestamp, int16_t value, SeriesPoint& out) {
+    received_++;
+    if (passthrough_) {
+        out.timestamp = timestamp;
+        out.value = value;
+        return true;
+    }
+
+    if (received_ == 1) {
+        origin_ = timestamp;
+        anchor_.x = 0;
+        anchor_.y = value;
+        out = toPoint(anchor_);
+        return true;
+    }
+
+    Vertex v;
+    v.x = (int64_t)timestamp - origin_;
+    v.y = value;
+
+    bool emitted = false;
+    if (received_ > 2) {
+        push(last_, received_ - 2, emitted, out);
+    }
+    last_ = v;
+    return emitted;
+}
+
+size_t LttbDownsampler::finish(SeriesPoint out[MAX_FINISH_POINTS]) {
+    if (passthrough_ || received_ < 2) return 0;
+
+    size_t n = 0;
+    if (hasPending_) {
+        out[n++] = select(pending_, current_.sumX / current_.count, current_.sumY / current_.count);
+        hasPending_ = false;
+    }
+    if (current_.count > 0) {
+        out[n++] = select(current_, last_.x, last_.y);
+        current_.reset(0);
+    }
+    out[n++] = toPoint(last_);
+    return n;
+}
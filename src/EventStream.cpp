@@ -0,0 +1,75 @@
+#include "EventStream.h"
+#include <errno.h>
+#include <sys/socket.h>
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+static const char EVENT_STREAM_HEADERS[] =
+    "HTTP/1.1 200 OK\r\n"
+    "Content-Type: text/event-stream\r\n"
+    "Cache-Control: no-cache\r\n"
+    "Connection: keep-alive\r\n"
+    "\r\n"
+    "retry: 5000\n\n";
+
+bool EventStream::subscribe(WiFiClient& client, const char* snapshot, size_t length) {
+    for (size_t i = 0; i < MAX_CLIENTS; ++i) {
+        if (clients_[i].connected()) continue;
+
+        if (write(client, EVENT_STREAM_HEADERS, sizeof(EVENT_STREAM_HEADERS) - 1) != WRITTEN) return false;
+        clients_[i] = client;
+        if (length > 0) write(clients_[i], snapshot, length);
+        logPrintf("Event stream client %u subscribed\n", (unsigned)i);
+        return true;
+    }
+    return false;
+}
+
+// Description: Sends `length` bytes in one non-blocking send(). The WiFiClient write of the
+// core would instead retry for up to several seconds on a full socket buffer.
+EventStream::WriteResult EventStream::write(WiFiClient& client, const char* buf, size_t length) {
+    int n = ::send(client.fd(), buf, length, MSG_DONTWAIT | MSG_NOSIGNAL);
+    if (n == (int)length) return WRITTEN;
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        skipped_++;
+        return SKIPPED;
+    }
+    client.stop();
+    return FAILED;
+}
+
+void EventStream::broadcast(const char* event, const char* data) {
+    FixedFormat<EVENT_SIZE> buf;
+    if (!format(buf, event, data)) return;
+    for (size_t i = 0; i < MAX_CLIENTS; ++i) {
+        if (!clients_[i].connected()) continue;
+        write(clients_[i], buf.c_str(), buf.length());
+    }
+}
+
+void EventStream::loop() {
+    unsigned long now = millis();
+    if (now - lastKeepalive_ < KEEPALIVE_MILLIS) return;
+    lastKeepalive_ = now;
+
+    static const char PING[] = ": ping\n\n";
+    for (size_t i = 0; i < MAX_CLIENTS; ++i) {
+        if (!clients_[i].connected()) {
+            clients_[i] = WiFiClient();
+            continue;
+        }
+        if (write(clients_[i], PING, sizeof(PING) - 1) != WRITTEN) {
+            clients_[i].stop();
+        }
+    }
+}
+
+size_t EventStream::clientCount() {
+    size_t n = 0;
+    for (size_t i = 0; i < MAX_CLIENTS; ++i) {
+        if (clients_[i].connected()) n++;
+    }
+    return n;
+}
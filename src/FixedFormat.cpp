@@ -0,0 +1,13 @@
+#include "FixedFormat.h"
+#include <Arduino.h>
+
+void logPrintf(const char* fmt, ...) {
+    FixedFormat<LOG_LINE_SIZE> line;
+    va_list args;
+    va_start(args, fmt);
+    line.vappendf(fmt, args);
+    va_end(args);
+    Serial.write((const uint8_t*)line.c_str(), line.length());
+    // A cut line loses its newline; end it so the next one does not run on
+    if (line.truncated()) Serial.write((const uint8_t*)"...\n", 4);
+}
@@ -0,0 +1,567 @@
+#include "HttpServer.h"
+#include "FixedFormat.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <strings.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+static const char* reasonPhrase(int code) {
+    switch (code) {
+        case 200: return "OK";
+        case 204: return "No Content";
+        case 304: return "Not Modified";
+        case 400: return "Bad Request";
+        case 404: return "Not Found";
+        case 413: return "Payload Too Large";
+        case 431: return "Request Header Fields Too Large";
+        case 500: return "Internal Server Error";
+        case 503: return "Service Unavailable";
+        default: return "";
+    }
+}
+
+static void setNonBlocking(int fd, bool enabled) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    fcntl(fd, F_SETFL, enabled ? (flags | O_NONBLOCK) : (flags & ~O_NONBLOCK));
+}
+
+static timeval toTimeval(unsigned long millis) {
+    timeval tv;
+    tv.tv_sec = millis / 1000;
+    tv.tv_usec = (millis % 1000) * 1000;
+    return tv;
+}
+
+static int hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// Description: Decodes %XX escapes and '+' in place.
+static void urlDecode(char* s) {
+    char* out = s;
+    for (; *s; ++s) {
+        if (*s == '+') {
+            *out++ = ' ';
+        } else if (*s == '%' && hexValue(s[1]) >= 0 && hexValue(s[2]) >= 0) {
+            *out++ = (char)(hexValue(s[1]) * 16 + hexValue(s[2]));
+            s += 2;
+        } else {
+            *out++ = *s;
+        }
+    }
+    *out = '\0';
+}
+
+// Description: Length of the request line and headers including the blank line, or 0 if
+// they have not all arrived.
+static size_t requestHeadLength(const char* buf, size_t len) {
+    for (size_t i = 3; i < len; ++i) {
+        if (buf[i] == '\n' && buf[i - 1] == '\r' && buf[i - 2] == '\n' && buf[i - 3] == '\r') return i + 1;
+    }
+    return 0;
+}
+
+// Description: Content-Length of an unparsed request, read without modifying it so the
+// request can still be parsed once the body has arrived.
+static size_t requestBodyLength(const char* buf, size_t headerLength) {
+    static const char NAME[] = "\r\ncontent-length:";
+    const size_t nameLength = sizeof(NAME) - 1;
+    for (size_t i = 0; i + nameLength < headerLength; ++i) {
+        if (strncasecmp(buf + i, NAME, nameLength) == 0) {
+            return strtoul(buf + i + nameLength, nullptr, 10);
+        }
+    }
+    return 0;
+}
+
+bool HttpServer::begin() {
+    return begin(port_);
+}
+
+bool HttpServer::begin(uint16_t port) {
+    if (listenFd_ >= 0) return true;
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return false;
+
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+    if (bind(fd, (sockaddr*)&addr, sizeof(addr)) < 0 || listen(fd, MAX_CONNECTIONS) < 0) {
+        logPrintf("HttpServer: cannot listen on port %u\n", (unsigned)port);
+        ::close(fd);
+        return false;
+    }
+    setNonBlocking(fd, true);
+
+    socklen_t addrLength = sizeof(addr);
+    if (getsockname(fd, (sockaddr*)&addr, &addrLength) == 0) port = ntohs(addr.sin_port);
+    port_ = port;
+    listenFd_ = fd;
+    return true;
+}
+
+void HttpServer::on(const char* uri, THandlerFunction handler) {
+    if (routeCount_ == MAX_ROUTES) {
+        logPrintf("HttpServer: no room for route %s\n", uri);
+        return;
+    }
+    routes_[routeCount_].uri = uri;
+    routes_[routeCount_].handler = handler;
+    routeCount_++;
+}
+
+void HttpServer::collectHeaders(const char* keys[], size_t count) {
+    headerKeyCount_ = count < MAX_HEADERS ? count : MAX_HEADERS;
+    for (size_t i = 0; i < headerKeyCount_; ++i) headerKeys_[i] = keys[i];
+}
+
+size_t HttpServer::connectionCount() const {
+    size_t n = 0;
+    for (size_t i = 0; i < MAX_CONNECTIONS; ++i) {
+        if (connections_[i].fd >= 0) n++;
+    }
+    return n;
+}
+
+void HttpServer::handleClient(unsigned long waitMillis) {
+    if (listenFd_ < 0) return;
+
+    // While a newcomer waits for a slot, further ones stay in the listen backlog
+    fd_set readable;
+    FD_ZERO(&readable);
+    if (waitingFd_ < 0) FD_SET(listenFd_, &readable);
+    int maxFd = listenFd_;
+    for (size_t i = 0; i < MAX_CONNECTIONS; ++i) {
+        int fd = connections_[i].fd;
+        if (fd < 0) continue;
+        FD_SET(fd, &readable);
+        if (fd > maxFd) maxFd = fd;
+    }
+
+    timeval timeout = toTimeval(waitMillis);
+    if (select(maxFd + 1, &readable, nullptr, nullptr, &timeout) < 0) return;
+
+    unsigned long now = millis();
+    for (size_t i = 0; i < MAX_CONNECTIONS; ++i) {
+        Connection& conn = connections_[i];
+        if (conn.fd < 0) continue;
+        if (FD_ISSET(conn.fd, &readable)) {
+            receive(conn);
+        } else if (now - conn.lastActivity >= IDLE_TIMEOUT_MILLIS) {
+            close(conn);
+        }
+    }
+
+    if (waitingFd_ >= 0 || FD_ISSET(listenFd_, &readable)) accept(readable);
+}
+
+// Description: Accepts waiting connections while there are free slots. When every slot is
+// taken, the connection that has been idle longest gives up its slot to one newcomer per
+// call, as HTTP allows for keep-alive connections, so a browser holding idle connections
+// cannot lock others out. A connection with a request in progress is never closed. If
+// all of them are busy, one newcomer is accepted onto the spare socket to wait, and is
+// refused with 503 if no slot frees up within WAITING_TIMEOUT_MILLIS; the rest wait in
+// the listen backlog, which holds no socket. A request that came with the connection
+// is answered straight away.
+void HttpServer::accept(const fd_set& readable) {
+    bool mayEvict = connectionCount() == MAX_CONNECTIONS;
+    for (;;) {
+        Connection* slot = nullptr;
+        for (size_t i = 0; i < MAX_CONNECTIONS && !slot; ++i) {
+            if (connections_[i].fd < 0) slot = &connections_[i];
+        }
+        if (!slot && mayEvict) {
+            for (size_t i = 0; i < MAX_CONNECTIONS; ++i) {
+                Connection& conn = connections_[i];
+                bool idle = conn.length == 0 && !FD_ISSET(conn.fd, &readable);
+                if (idle && (!slot || conn.lastActivity < slot->lastActivity)) slot = &conn;
+            }
+            mayEvict = false;
+        }
+        if (!slot) {
+            if (waitingFd_ < 0) {
+                waitingFd_ = ::accept(listenFd_, nullptr, nullptr);
+                waitingSince_ = millis();
+            } else if (millis() - waitingSince_ >= WAITING_TIMEOUT_MILLIS) {
+                refuse(waitingFd_);
+                waitingFd_ = -1;
+            }
+            return;
+        }
+
+        int fd = waitingFd_;
+        waitingFd_ = -1;
+        if (fd < 0) fd = ::accept(listenFd_, nullptr, nullptr);
+        if (fd < 0) return;
+        if (slot->fd >= 0) close(*slot);
+        Connection& conn = *slot;
+
+        // Responses are written whole, so Nagle's algorithm would only add a round trip
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        setNonBlocking(fd, true);
+
+        conn.fd = fd;
+        conn.length = 0;
+        conn.lastActivity = millis();
+        receive(conn);
+    }
+}
+
+// Description: Answers 503 with Retry-After in a single send() and closes the connection,
+// without reading the request.
+void HttpServer::refuse(int fd) {
+    static const char RESPONSE[] =
+        "HTTP/1.1 503 Service Unavailable\r\n"
+        "Retry-After: 1\r\n"
+        "Connection: close\r\n"
+        "Content-Length: 0\r\n"
+        "\r\n";
+    ::send(fd, RESPONSE, sizeof(RESPONSE) - 1, MSG_NOSIGNAL);
+    ::close(fd);
+    refused_++;
+}
+
+void HttpServer::receive(Connection& conn) {
+    size_t room = REQUEST_BUFFER_SIZE - conn.length;
+    if (room > 0) {
+        int n = recv(conn.fd, conn.buffer + conn.length, room, 0);
+        if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+            close(conn);
+            return;
+        }
+        if (n < 0) return;
+        conn.length += n;
+        conn.lastActivity = millis();
+    }
+    serve(conn);
+}
+
+// Description: Answers every complete request in the buffer, in order, and keeps the
+// start of the next one.
+void HttpServer::serve(Connection& conn) {
+    while (conn.fd >= 0) {
+        size_t head = requestHeadLength(conn.buffer, conn.length);
+        if (head == 0) {
+            if (conn.length == REQUEST_BUFFER_SIZE) reject(conn, 431, "Request headers too large");
+            return;   // Otherwise the headers are still arriving
+        }
+
+        size_t length = head + requestBodyLength(conn.buffer, head);
+        if (length > REQUEST_BUFFER_SIZE) {
+            reject(conn, 413, "Request body too large");
+            return;
+        }
+        if (length > conn.length) return;   // Body still arriving
+
+        handle(conn, head);
+        if (detached_) {
+            conn.fd = -1;
+            conn.length = 0;
+            return;
+        }
+        if (failed_ || !keepAlive_) {
+            close(conn);
+            return;
+        }
+
+        conn.length -= length;
+        memmove(conn.buffer, conn.buffer + length, conn.length);
+        conn.lastActivity = millis();
+    }
+}
+
+void HttpServer::startResponse(int fd) {
+    fd_ = fd;
+    headersLength_ = 0;
+    contentLength_ = 0;
+    responded_ = false;
+    chunked_ = false;
+    finished_ = false;
+    failed_ = false;
+    detached_ = false;
+    outLength_ = 0;
+}
+
+// Description: Answers a request that cannot be read and closes the connection.
+void HttpServer::reject(Connection& conn, int code, const char* message) {
+    startResponse(conn.fd);
+    http11_ = true;
+    keepAlive_ = false;
+    send(code, "text/plain", message);
+    flush();
+    close(conn);
+}
+
+void HttpServer::handle(Connection& conn, size_t headerLength) {
+    startResponse(conn.fd);
+    requests_++;
+
+    if (!parse(conn.buffer, headerLength)) {
+        keepAlive_ = false;
+        send(400, "text/plain", "Bad request");
+    } else {
+        const Route* route = nullptr;
+        for (size_t i = 0; i < routeCount_ && !route; ++i) {
+            if (strcmp(routes_[i].uri, uri_) == 0) route = &routes_[i];
+        }
+        if (route) {
+            route->handler();
+        } else if (notFound_) {
+            notFound_();
+        } else {
+            send(404, "text/plain", "Not found");
+        }
+
+        // Without a complete response the client cannot tell where the next one starts
+        if (!responded_ && !detached_) {
+            send(500, "text/plain", "No response");
+        } else if (chunked_ && !finished_) {
+            keepAlive_ = false;
+        }
+    }
+
+    if (!detached_) flush();
+    uri_ = "";
+    argCount_ = 0;
+}
+
+// Description: Splits the request line, query string and headers in place. Values are
+// left in the connection's buffer, which stays untouched until the handler returns.
+bool HttpServer::parse(char* request, size_t headerLength) {
+    request[headerLength - 2] = '\0';   // Ends the last header line
+
+    char* line = request;
+    char* next = strstr(line, "\r\n");
+    if (!next) return false;
+    *next = '\0';
+
+    // Request line: METHOD SP target SP version
+    char* target = strchr(line, ' ');
+    if (!target) return false;
+    *target++ = '\0';
+    char* version = strchr(target, ' ');
+    if (!version) return false;
+    *version++ = '\0';
+    if (strcmp(version, "HTTP/1.1") == 0) {
+        http11_ = true;
+    } else if (strcmp(version, "HTTP/1.0") == 0) {
+        http11_ = false;
+    } else {
+        return false;
+    }
+
+    argCount_ = 0;
+    char* query = strchr(target, '?');
+    if (query) *query++ = '\0';
+    urlDecode(target);
+    uri_ = target;
+    while (query && *query) {
+        char* pair = query;
+        query = strchr(query, '&');
+        if (query) *query++ = '\0';
+        if (argCount_ == MAX_ARGS) break;
+
+        char* value = strchr(pair, '=');
+        if (value) *value++ = '\0';
+        urlDecode(pair);
+        if (value) urlDecode(value);
+        args_[argCount_].name = pair;
+        args_[argCount_].value = value ? value : "";
+        argCount_++;
+    }
+
+    // Headers: HTTP/1.1 keeps the connection open unless told otherwise, HTTP/1.0 closes it
+    keepAlive_ = http11_;
+    for (size_t i = 0; i < headerKeyCount_; ++i) headerValues_[i] = nullptr;
+    for (line = next + 2; *line; line = next) {
+        next = strstr(line, "\r\n");
+        if (next) {
+            *next = '\0';
+            next += 2;
+        } else {
+            next = line + strlen(line);
+        }
+
+        char* value = strchr(line, ':');
+        if (!value) return false;
+        *value++ = '\0';
+        while (*value == ' ' || *value == '\t') value++;
+
+        if (strcasecmp(line, "Connection") == 0) {
+            if (strcasecmp(value, "close") == 0) keepAlive_ = false;
+            if (strcasecmp(value, "keep-alive") == 0) keepAlive_ = true;
+        }
+        for (size_t i = 0; i < headerKeyCount_; ++i) {
+            if (strcasecmp(line, headerKeys_[i]) == 0) headerValues_[i] = value;
+        }
+    }
+    return true;
+}
+
+void HttpServer::close(Connection& conn) {
+    if (conn.fd >= 0) ::close(conn.fd);
+    conn.fd = -1;
+    conn.length = 0;
+}
+
+const HttpServer::Param* HttpServer::findArg(const char* name) const {
+    for (size_t i = 0; i < argCount_; ++i) {
+        if (strcmp(args_[i].name, name) == 0) return &args_[i];
+    }
+    return nullptr;
+}
+
+String HttpServer::arg(const char* name) const {
+    return String(argValue(name));
+}
+
+const char* HttpServer::argValue(const char* name) const {
+    const Param* param = findArg(name);
+    return param ? param->value : "";
+}
+
+unsigned long HttpServer::argUnsigned(const char* name, unsigned long fallback) const {
+    const Param* param = findArg(name);
+    return param ? strtoul(param->value, nullptr, 10) : fallback;
+}
+
+String HttpServer::header(const char* name) const {
+    return String(headerValue(name));
+}
+
+const char* HttpServer::headerValue(const char* name) const {
+    for (size_t i = 0; i < headerKeyCount_; ++i) {
+        if (headerValues_[i] && strcasecmp(headerKeys_[i], name) == 0) return headerValues_[i];
+    }
+    return "";
+}
+
+WiFiClient HttpServer::client() {
+    if (fd_ < 0 || detached_) return WiFiClient();
+    flush();
+
+    // The socket stays non-blocking, so the new owner never waits on a stalled client
+    detached_ = true;
+    return WiFiClient(fd_);
+}
+
+void HttpServer::sendHeader(const char* name, const char* value) {
+    int n = snprintf(headers_ + headersLength_, HEADER_BUFFER_SIZE - headersLength_, "%s: %s\r\n", name, value);
+    if (n > 0 && headersLength_ + n < HEADER_BUFFER_SIZE) headersLength_ += n;
+}
+
+void HttpServer::writeHead(int code, const char* contentType, size_t length) {
+    responded_ = true;
+    chunked_ = length == CONTENT_LENGTH_UNKNOWN && http11_;
+    if (length == CONTENT_LENGTH_UNKNOWN && !http11_) keepAlive_ = false;   // The body ends with the connection
+
+    char head[160];
+    int n = snprintf(head, sizeof(head), "HTTP/1.1 %d %s\r\nContent-Type: %s\r\n", code, reasonPhrase(code), contentType);
+    if (n > 0) write(head, (size_t)n < sizeof(head) ? n : sizeof(head) - 1);
+    write(headers_, headersLength_);
+
+    if (chunked_) {
+        n = snprintf(head, sizeof(head), "Transfer-Encoding: chunked\r\n");
+    } else if (length != CONTENT_LENGTH_UNKNOWN) {
+        n = snprintf(head, sizeof(head), "Content-Length: %u\r\n", (unsigned)length);
+    } else {
+        n = 0;
+    }
+    n += snprintf(head + n, sizeof(head) - n, "Connection: %s\r\n\r\n", keepAlive_ ? "keep-alive" : "close");
+    write(head, n);
+}
+
+void HttpServer::send(int code, const char* contentType, const char* content) {
+    size_t length = strlen(content);
+    writeHead(code, contentType, contentLength_ ? contentLength_ : length);
+    write(content, length);
+}
+
+void HttpServer::send_P(int code, const char* contentType, const char* content, size_t length) {
+    writeHead(code, contentType, length);
+    write(content, length);
+}
+
+void HttpServer::sendContent(const char* content, size_t length) {
+    if (!chunked_) {
+        write(content, length);
+        return;
+    }
+    if (finished_) return;
+
+    char size[12];
+    int n = snprintf(size, sizeof(size), "%x\r\n", (unsigned)length);
+    write(size, n);
+    write(content, length);
+    write("\r\n", 2);
+    if (length == 0) finished_ = true;
+}
+
+// Description: Collects the response in one segment-sized buffer so a small response is
+// a single send(). Larger writes go straight to the socket.
+void HttpServer::write(const char* data, size_t length) {
+    if (failed_ || length == 0) return;
+    if (detached_) {
+        sendAll(data, length);
+        return;
+    }
+    if (outLength_ + length > RESPONSE_BUFFER_SIZE) {
+        if (!flush()) return;
+        if (length >= RESPONSE_BUFFER_SIZE) {
+            sendAll(data, length);
+            return;
+        }
+    }
+    memcpy(out_ + outLength_, data, length);
+    outLength_ += length;
+}
+
+bool HttpServer::flush() {
+    if (outLength_ == 0) return !failed_;
+    bool ok = sendAll(out_, outLength_);
+    outLength_ = 0;
+    return ok;
+}
+
+// Description: Writes everything, waiting for the socket to drain when its buffer is
+// full. A client that stops reading for SEND_TIMEOUT_MILLIS is given up on.
+bool HttpServer::sendAll(const char* data, size_t length) {
+    if (failed_ || fd_ < 0) return false;
+
+    while (length > 0) {
+        int n = ::send(fd_, data, length, MSG_NOSIGNAL);
+        if (n > 0) {
+            data += n;
+            length -= n;
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            fd_set writable;
+            FD_ZERO(&writable);
+            FD_SET(fd_, &writable);
+            timeval timeout = toTimeval(SEND_TIMEOUT_MILLIS);
+            if (select(fd_ + 1, nullptr, &writable, nullptr, &timeout) > 0) continue;
+        }
+        failed_ = true;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,37 @@
+#include "Metrics.h"
+#include "ResponseStream.h"
+
+// Spans a fast SPIFFS append (~50 us) up to a Telegram TLS handshake (seconds)
+const uint32_t LatencyHistogram::BOUNDS_MICROS[BUCKET_COUNT] = {
+    50, 100, 250, 500, 1000, 2500, 5000, 10000, 25000, 100000, 500000, 2500000,
+};
+
+void LatencyHistogram::record(uint32_t micros) {
+    size_t i = 0;
+    while (i < BUCKET_COUNT && micros > BOUNDS_MICROS[i]) ++i;
+    buckets_[i] = buckets_[i] + 1;
+    sumMicros_ = sumMicros_ + micros;
+    count_ = count_ + 1;
+}
+
+void LatencyHistogram::print(ResponseStream& out, const char* name, const char* help) const {
+    out.printf("# HELP %s %s\n", name, help);
+    out.printf("# TYPE %s histogram\n", name);
+
+    // Prometheus buckets are cumulative
+    unsigned long cumulative = 0;
+    for (size_t i = 0; i < BUCKET_COUNT; ++i) {
+        cumulative += buckets_[i];
+        out.printf("%s_bucket{le=\"%g\"} %lu\n", name, BOUNDS_MICROS[i] / 1e6, cumulative);
+    }
+    cumulative += buckets_[BUCKET_COUNT];
+    out.printf("%s_bucket{le=\"+Inf\"} %lu\n", name, cumulative);
+    out.printf("%s_sum %.6f\n", name, sumMicros_ / 1e6);
+    out.printf("%s_count %lu\n", name, (unsigned long)count_);
+}
+
+void printMetric(ResponseStream& out, const char* name, const char* type, const char* help, double value) {
+    out.printf("# HELP %s %s\n", name, help);
+    out.printf("# TYPE %s %s\n", name, type);
+    out.printf("%s %.10g\n", name, value);
+}
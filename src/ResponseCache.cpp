@@ -0,0 +1,41 @@
+#include "ResponseCache.h"
+#include <string.h>
+
+const ResponseCache::Slot* ResponseCache::find(const char* key, uint32_t generation) {
+    for (Slot& slot : slots_) {
+        if (slot.valid && slot.generation == generation && strcmp(slot.key, key) == 0) {
+            slot.lastUsed = ++clock_;
+            hits_++;
+            return &slot;
+        }
+    }
+    misses_++;
+    return nullptr;
+}
+
+// Description: A stale body of the same request is replaced first, otherwise the least
+// recently used slot. Empty slots count as never used.
+ResponseCache::Slot* ResponseCache::claim(const char* key, uint32_t generation) {
+    if (strlen(key) >= KEY_SIZE) return nullptr;
+    Slot* victim = &slots_[0];
+    for (Slot& slot : slots_) {
+        if (slot.valid && strcmp(slot.key, key) == 0) {
+            victim = &slot;
+            break;
+        }
+        if (slot.lastUsed < victim->lastUsed) victim = &slot;
+    }
+    victim->valid = false;
+    victim->lastUsed = 0;
+    strcpy(victim->key, key);
+    victim->generation = generation;
+    victim->length = 0;
+    return victim;
+}
+
+void ResponseCache::commit(Slot* slot, size_t length, bool complete) {
+    if (!slot || !complete) return;
+    slot->length = length;
+    slot->valid = true;
+    slot->lastUsed = ++clock_;
+}
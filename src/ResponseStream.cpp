@@ -0,0 +1,58 @@
+#include "ResponseStream.h"
+#include <stdarg.h>
+
+void ResponseStream::begin(int code, const char* contentType) {
+    server_.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    server_.send(code, contentType, "");
+    len_ = 0;
+    open_ = true;
+}
+
+void ResponseStream::record(char* buffer, size_t capacity) {
+    record_ = buffer;
+    recordCapacity_ = capacity;
+    recorded_ = 0;
+}
+
+void ResponseStream::write(const char* data, size_t len) {
+    if (record_) {
+        if (recorded_ + len <= recordCapacity_) {
+            memcpy(record_ + recorded_, data, len);
+            recorded_ += len;
+        } else {
+            record_ = nullptr;
+        }
+    }
+    while (len > 0) {
+        size_t n = BUFFER_SIZE - len_;
+        if (n > len) n = len;
+        memcpy(buf_ + len_, data, n);
+        len_ += n;
+        data += n;
+        len -= n;
+        if (len_ == BUFFER_SIZE) flush();
+    }
+}
+
+void ResponseStream::printf(const char* fmt, ...) {
+    char line[128];
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(line, sizeof(line), fmt, args);
+    va_end(args);
+    if (n <= 0) return;
+    write(line, (size_t)n < sizeof(line) ? n : sizeof(line) - 1);
+}
+
+void ResponseStream::flush() {
+    if (len_ == 0) return;
+    server_.sendContent(buf_, len_);
+    len_ = 0;
+}
+
+void ResponseStream::end() {
+    if (!open_) return;
+    flush();
+    server_.sendContent("");  // Terminating zero-length chunk
+    open_ = false;
+}
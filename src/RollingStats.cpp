@@ -0,0 +1,72 @@
+#include "RollingStats.h"
+
+const uint32_t RollingStats::WINDOW_SECONDS[WINDOW_COUNT] = {3600, 86400, 7 * 86400};
+const char* const RollingStats::WINDOW_NAMES[WINDOW_COUNT] = {"1h", "24h", "7d"};
+
+void RollingSummary::merge(const RollingSummary& other) {
+    if (other.count == 0) return;
+    if (count == 0) {
+        *this = other;
+        return;
+    }
+    uint32_t total = count + other.count;
+    float delta = other.mean - mean;
+    mean += delta * other.count / total;
+    m2 += other.m2 + delta * delta * ((float)count * other.count / total);
+    count = total;
+    if (other.min < min) min = other.min;
+    if (other.max > max) max = other.max;
+}
+
+void RollingWindow::begin(uint32_t width) {
+    bucketWidth_ = width / BUCKETS ? width / BUCKETS : 1;
+    for (Bucket& bucket : buckets_) bucket = Bucket();
+}
+
+void RollingWindow::add(uint32_t timestamp, const RollingSummary& samples) {
+    uint32_t start = timestamp - timestamp % bucketWidth_;
+    Bucket& bucket = buckets_[(timestamp / bucketWidth_) % BUCKETS];
+    if (bucket.start != start || bucket.samples.count == 0) {
+        // The slot holds a bucket that is either older, and so out of the window, or
+        // newer, in which case this sample is the one out of the window
+        if (bucket.samples.count > 0 && bucket.start > start) return;
+        bucket.start = start;
+        bucket.samples = RollingSummary();
+    }
+    bucket.samples.merge(samples);
+}
+
+RollingSummary RollingWindow::summary(uint32_t now) const {
+    uint32_t newest = now - now % bucketWidth_;
+    uint32_t span = bucketWidth_ * (BUCKETS - 1);
+    RollingSummary result = RollingSummary();
+    for (const Bucket& bucket : buckets_) {
+        if (bucket.samples.count > 0 && bucket.start <= newest && newest - bucket.start <= span) {
+            result.merge(bucket.samples);
+        }
+    }
+    return result;
+}
+
+RollingStats::RollingStats() {
+    for (size_t i = 0; i < WINDOW_COUNT; ++i) windows_[i].begin(WINDOW_SECONDS[i]);
+}
+
+void RollingStats::add(uint32_t timestamp, int16_t value) {
+    RollingSummary sample = {1, (float)value, 0, value, value};
+    for (RollingWindow& window : windows_) window.add(timestamp, sample);
+    setLatest(timestamp, value);
+}
+
+void RollingStats::addAggregate(uint32_t timestamp, uint32_t count, int32_t sum, int16_t min, int16_t max) {
+    if (count == 0) return;
+    RollingSummary samples = {count, (float)sum / count, 0, min, max};
+    for (RollingWindow& window : windows_) window.add(timestamp, samples);
+}
+
+void RollingStats::setLatest(uint32_t timestamp, int16_t value) {
+    if (hasLatest_ && timestamp < latestTimestamp_) return;
+    hasLatest_ = true;
+    latestTimestamp_ = timestamp;
+    latestValue_ = value;
+}
@@ -0,0 +1,287 @@
+#include "SampleLog.h"
+#include "FixedFormat.h"
+
+static uint64_t zigzag(int64_t v) { return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63); }
+static int64_t unzigzag(uint64_t v) { return (int64_t)(v >> 1) ^ -(int64_t)(v & 1); }
+
+static size_t putVarint(uint8_t* out, uint64_t v) {
+    size_t n = 0;
+    while (v >= 0x80) {
+        out[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    out[n++] = (uint8_t)v;
+    return n;
+}
+
+// Description: Returns the number of bytes consumed, or 0 if the varint runs past `len`.
+static size_t getVarint(const uint8_t* in, size_t len, uint64_t& v) {
+    v = 0;
+    for (size_t n = 0; n < len && n < 10; ++n) {
+        v |= (uint64_t)(in[n] & 0x7F) << (7 * n);
+        if (!(in[n] & 0x80)) return n + 1;
+    }
+    return 0;
+}
+
+static uint16_t blockCrc(const SampleBlock& block) {
+    return crc16((const uint8_t*)&block, offsetof(SampleBlock, crc));
+}
+
+bool BlockDecoder::next(LogRecord& out) {
+    if (index_ >= block_.count) return false;
+
+    if (index_ == 0) {
+        timestamp_ = block_.timestamp;
+        value_ = block_.firstValue;
+    } else {
+        size_t used = block_.used < SampleBlock::DATA_SIZE ? block_.used : SampleBlock::DATA_SIZE;
+        uint64_t dod, dv;
+        size_t n = getVarint(block_.data + pos_, used - pos_, dod);
+        if (n == 0) return false;
+        pos_ += n;
+        n = getVarint(block_.data + pos_, used - pos_, dv);
+        if (n == 0) return false;
+        pos_ += n;
+
+        delta_ += unzigzag(dod);
+        timestamp_ = (uint32_t)(timestamp_ + delta_);
+        value_ = (int16_t)(value_ + unzigzag(dv));
+    }
+
+    out.seq = block_.firstSample + index_;
+    out.timestamp = timestamp_;
+    out.value = value_;
+    ++index_;
+    return true;
+}
+
+void SampleLog::setWriteBack(SampleBlock* openBlock, uint32_t maxAgeSeconds) {
+    open_ = openBlock ? openBlock : &ownBlock_;
+    maxAge_ = maxAgeSeconds;
+}
+
+bool SampleLog::begin(fs::FS& fs, const char* path, uint32_t blocks) {
+    // Blocks are appended at most once per page of samples, so checkpoint every one
+    bool ok = ring_.begin(fs, path, blocks, 1);
+    setHint(UINT32_MAX, 0);
+    adopt();
+    return ok;
+}
+
+// Description: Picks the open block after a reboot. The copy in write-back memory wins
+// if it continues the flash log and holds at least as many samples as the flash copy,
+// or if it belongs in the newest slot and a reset tore the patch being written there;
+// that slot is then rewritten whole. After a power-on the copy fails its CRC and the
+// newest block on flash is reopened instead, if it still has room.
+void SampleLog::adopt() {
+    SampleBlock last;
+    bool haveLast = false;
+    uint32_t nextSample = 0;
+    for (uint32_t i = ring_.nextSeq(); i > ring_.firstSeq(); --i) {
+        if (ring_.read(i - 1, last)) {
+            haveLast = i == ring_.nextSeq();
+            nextSample = last.firstSample + last.count;
+            break;
+        }
+    }
+
+    const SampleBlock& kept = *open_;
+    bool keptValid = open_ != &ownBlock_ && kept.crc == blockCrc(kept) && kept.count > 0 &&
+                     kept.used <= SampleBlock::DATA_SIZE;
+
+    if (keptValid && kept.seq == ring_.nextSeq() && kept.firstSample == nextSample) {
+        openOnFlash_ = false;
+        dirty_ = true;
+    } else if (keptValid && haveLast && kept.seq == last.seq && kept.firstSample == last.firstSample &&
+               kept.count >= last.count) {
+        openOnFlash_ = true;
+        dirty_ = kept.count > last.count;
+        flushedUsed_ = last.used;
+    } else if (keptValid && !haveLast && kept.seq + 1 == ring_.nextSeq() && kept.firstSample == nextSample) {
+        openOnFlash_ = true;
+        rewriteSlot_ = true;
+        dirty_ = true;
+    } else if (haveLast && hasRoom(last)) {
+        *open_ = last;
+        openOnFlash_ = true;
+        dirty_ = false;
+        flushedUsed_ = last.used;
+    } else {
+        startBlock(ring_.nextSeq(), nextSample);
+    }
+
+    // Restore the encoder state from the samples already in the open block
+    BlockDecoder decoder(*open_);
+    LogRecord rec;
+    while (decoder.next(rec)) {
+        lastTimestamp_ = rec.timestamp;
+        lastValue_ = rec.value;
+    }
+    lastDelta_ = decoder.lastDelta();
+    unflushedSince_ = lastTimestamp_;
+
+    if (open_->count > 0 && open_ != &ownBlock_) {
+        logPrintf("SampleLog: open block %u holds %u samples%s\n", (unsigned)open_->seq,
+                  (unsigned)open_->count, rewriteSlot_ ? ", its flash copy torn" : dirty_ ? ", some not yet on flash" : "");
+    }
+    // Until it is repaired, a power loss would lose the whole block
+    if (rewriteSlot_) flush();
+    refreshFirstSeq();
+}
+
+void SampleLog::startBlock(uint32_t index, uint32_t firstSample) {
+    memset(open_, 0, sizeof(SampleBlock));
+    open_->seq = index;
+    open_->firstSample = firstSample;
+    open_->crc = blockCrc(*open_);
+    openOnFlash_ = false;
+    dirty_ = false;
+    rewriteSlot_ = false;
+    flushedUsed_ = 0;
+}
+
+void SampleLog::refreshFirstSeq() {
+    SampleBlock b;
+    for (uint32_t i = ring_.firstSeq(); i < ring_.nextSeq(); ++i) {
+        if (ring_.read(i, b)) {
+            firstSeq_ = b.firstSample;
+            return;
+        }
+    }
+    firstSeq_ = open_->firstSample;
+}
+
+bool SampleLog::append(uint32_t timestamp, int16_t value) {
+    // A full block that could not be written last time gets another try first
+    if (!hasRoom(*open_)) {
+        if (!flush()) return false;
+        startBlock(open_->seq + 1, nextSeq());
+    }
+
+    SampleBlock& b = *open_;
+    if (b.count == 0) {
+        b.timestamp = timestamp;
+        b.firstValue = value;
+        lastDelta_ = 0;
+    } else {
+        int64_t delta = (int64_t)timestamp - lastTimestamp_;
+        b.used += putVarint(b.data + b.used, zigzag(delta - lastDelta_));
+        b.used += putVarint(b.data + b.used, zigzag((int32_t)value - lastValue_));
+        lastDelta_ = delta;
+    }
+    b.count++;
+    b.crc = blockCrc(b);
+    lastTimestamp_ = timestamp;
+    lastValue_ = value;
+
+    if (!dirty_) {
+        dirty_ = true;
+        unflushedSince_ = timestamp;
+    }
+
+    // A failed write leaves the samples in the open block for the next append to retry
+    if (!hasRoom(b)) {
+        if (flush()) startBlock(b.seq + 1, nextSeq());
+    } else if (timestamp - unflushedSince_ >= maxAge_) {
+        flush();
+    }
+    return true;
+}
+
+// Description: The first write of a block appends it to the ring. Later writes of the
+// same block only patch that slot: the sample count, the data added since, and the
+// crc, about 2 bytes per sample instead of the whole block. A torn patch can only lose
+// the open block, which the write-back memory still holds unless power was lost; adopt()
+// then has the slot rewritten whole.
+bool SampleLog::flush() {
+    if (!dirty_) return true;
+
+    const size_t data = offsetof(SampleBlock, data);
+    bool ok = !openOnFlash_ ? ring_.append(*open_)
+              : rewriteSlot_ ? ring_.rewriteLast(*open_)
+                             : ring_.rewriteLast(*open_, offsetof(SampleBlock, count), data) &&
+                                   ring_.rewriteLast(*open_, data + flushedUsed_, data + open_->used) &&
+                                   ring_.rewriteLast(*open_, offsetof(SampleBlock, crc), sizeof(SampleBlock));
+    if (!ok) return false;
+
+    if (!openOnFlash_) {
+        openOnFlash_ = true;
+        refreshFirstSeq();   // The append may have overwritten the oldest block
+        setHint(UINT32_MAX, 0);
+    }
+    flushedUsed_ = open_->used;
+    dirty_ = false;
+    rewriteSlot_ = false;
+    return true;
+}
+
+// Description: The open block is served from RAM, every other block from flash.
+bool SampleLog::block(uint32_t index, SampleBlock& out) {
+    if (index == open_->seq) {
+        out = *open_;
+        return open_->count > 0;
+    }
+    return ring_.read(index, out);
+}
+
+// Description: Index of the block holding sample `seq`: the last block whose first
+// sample is at or before it. Unreadable blocks are treated as older.
+uint32_t SampleLog::blockFor(uint32_t seq) {
+    if (seq == hintSeq_) return hintBlock_;
+    if (seq >= open_->firstSample) return open_->seq;
+
+    uint32_t lo = ring_.firstSeq();
+    uint32_t hi = open_->seq + 1;
+    SampleBlock b;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (!block(mid, b) || b.firstSample <= seq) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo > ring_.firstSeq() ? lo - 1 : ring_.firstSeq();
+}
+
+bool SampleLog::read(uint32_t seq, LogRecord& out) {
+    if (seq < firstSeq_ || seq >= nextSeq()) return false;
+
+    SampleBlock b;
+    if (!block(blockFor(seq), b)) return false;
+    BlockDecoder decoder(b);
+    while (decoder.next(out)) {
+        if (out.seq == seq) return true;
+    }
+    return false;
+}
+
+uint32_t SampleLog::lowerBound(uint32_t timestamp) {
+    // First block whose first sample is at or after `timestamp`: the ring's index covers
+    // the blocks on flash, and an open block not yet written is checked in RAM
+    uint32_t end = open_->count > 0 ? open_->seq + 1 : open_->seq;
+    uint32_t lo = ring_.lowerBound(timestamp);
+    if (lo >= ring_.nextSeq()) {
+        lo = (lo < end && open_->timestamp >= timestamp) ? open_->seq : end;
+    }
+
+    SampleBlock b;
+
+    // The answer is in the block before it, or is that block's first sample
+    if (lo > ring_.firstSeq() && block(lo - 1, b)) {
+        BlockDecoder decoder(b);
+        LogRecord rec;
+        while (decoder.next(rec)) {
+            if (rec.timestamp >= timestamp) {
+                setHint(rec.seq, lo - 1);
+                return rec.seq;
+            }
+        }
+    }
+    if (lo < end && block(lo, b)) {
+        setHint(b.firstSample, lo);
+        return b.firstSample;
+    }
+    return nextSeq();
+}
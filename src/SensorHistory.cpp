@@ -0,0 +1,160 @@
+#include "SensorHistory.h"
+
+bool SensorHistory::begin(fs::FS& fs, const char* basePath, uint32_t rawBlocks,
+                          const RollupTierConfig (&tiers)[ROLLUP_TIER_COUNT]) {
+    config_ = tiers;
+    snprintf(paths_[0], PATH_LENGTH, "%s.log", basePath);
+    bool ok = raw_.begin(fs, paths_[0], rawBlocks);
+
+    // Windows appended since a tier's last checkpoint are found again by the ring's
+    // roll-forward, and any lost to a torn write are rebuilt from the raw log below
+    for (size_t i = 0; i < ROLLUP_TIER_COUNT; ++i) {
+        snprintf(paths_[i + 1], PATH_LENGTH, "%s.%s", basePath, tiers[i].suffix);
+        ok = tiers_[i].begin(fs, paths_[i + 1], tiers[i].capacity, TIER_CHECKPOINT_INTERVAL) && ok;
+    }
+
+    rebuildOpenWindows();
+    return ok;
+}
+
+void SensorHistory::merge(RollupRecord& into, uint32_t start, const RollupRecord& from) {
+    if (into.count == 0) {
+        into = from;
+        into.timestamp = start;
+        return;
+    }
+    if (from.min < into.min) into.min = from.min;
+    if (from.max > into.max) into.max = from.max;
+    into.sum += from.sum;
+    into.count += from.count;
+}
+
+bool SensorHistory::append(uint32_t timestamp, int16_t value) {
+    if (!config_) return false;
+
+    RollupRecord sample = {};
+    sample.timestamp = timestamp;
+    sample.sum = value;
+    sample.count = 1;
+    sample.min = value;
+    sample.max = value;
+
+    // Close windows the sample has moved past before logging it, so a reset in between
+    // never leaves a raw sample whose earlier windows were not yet written.
+    bool ok = true;
+    for (size_t i = 0; i < ROLLUP_TIER_COUNT; ++i) {
+        uint32_t start = windowStart(i, timestamp);
+        if (open_[i].count > 0 && open_[i].timestamp != start) {
+            ok = tiers_[i].append(open_[i]) && ok;
+            open_[i].count = 0;
+        }
+        merge(open_[i], start, sample);
+    }
+
+    return raw_.append(timestamp, value) && ok;
+}
+
+int SensorHistory::tierFor(uint32_t bucketWidth) const {
+    int best = -1;
+    if (!config_) return best;
+    for (size_t i = 0; i < ROLLUP_TIER_COUNT; ++i) {
+        if (config_[i].width <= bucketWidth) best = i;
+    }
+    return best;
+}
+
+void SensorHistory::seqRange(size_t index, uint32_t from, uint32_t to, uint32_t& fromSeq, uint32_t& toSeq) {
+    RollupLog& log = tiers_[index];
+    fromSeq = log.lowerBound(windowStart(index, from));
+    toSeq = (to == UINT32_MAX) ? log.nextSeq() : log.lowerBound(to + 1);
+    if (toSeq < fromSeq) toSeq = fromSeq;
+}
+
+bool SensorHistory::openInRange(size_t index, uint32_t from, uint32_t to) const {
+    const RollupRecord& open = open_[index];
+    return open.count > 0 && open.timestamp + config_[index].width > from && open.timestamp <= to;
+}
+
+uint32_t SensorHistory::rollupCount(size_t index, uint32_t from, uint32_t to) {
+    uint32_t fromSeq, toSeq;
+    seqRange(index, from, to, fromSeq, toSeq);
+    return toSeq - fromSeq + (openInRange(index, from, to) ? 1 : 0);
+}
+
+uint32_t SensorHistory::oldestTimestamp() {
+    uint32_t oldest = 0;
+    LogRecord rec;
+    if (raw_.size() > 0 && raw_.read(raw_.firstSeq(), rec)) oldest = rec.timestamp;
+
+    RollupRecord rollup;
+    for (size_t i = 0; i < ROLLUP_TIER_COUNT; ++i) {
+        RollupLog& log = tiers_[i];
+        if (log.size() > 0 && log.read(log.firstSeq(), rollup) && (oldest == 0 || rollup.timestamp < oldest)) {
+            oldest = rollup.timestamp;
+        }
+    }
+    return oldest;
+}
+
+uint32_t SensorHistory::newestTimestamp() {
+    LogRecord rec;
+    if (raw_.size() > 0 && raw_.read(raw_.nextSeq() - 1, rec)) return rec.timestamp;
+    return 0;
+}
+
+// Description: Each tier's open window holds every finer-tier window (or raw sample)
+// since its start that has not been written to the tier yet. Windows nest, so the
+// open window of tier i is rebuilt from tier i-1's records and open window, starting
+// after the last window tier i already wrote. Closed windows between that one and the
+// open window are missing from the tier, e.g. after a torn write, and are appended
+// again from the same source; tier i-1 has been repaired by then.
+void SensorHistory::rebuildOpenWindows() {
+    LogRecord newest;
+    if (raw_.size() == 0 || !raw_.read(raw_.nextSeq() - 1, newest)) return;
+
+    for (size_t i = 0; i < ROLLUP_TIER_COUNT; ++i) {
+        uint32_t start = windowStart(i, newest.timestamp);
+        uint32_t from = start;
+
+        RollupRecord lastClosed;
+        RollupLog& log = tiers_[i];
+        if (log.size() > 0 && log.read(log.nextSeq() - 1, lastClosed)) {
+            from = lastClosed.timestamp + config_[i].width;
+        }
+
+        RollupRecord& open = open_[i];
+        open = RollupRecord();
+        RollupRecord missing = RollupRecord();
+        auto fold = [&](uint32_t timestamp, const RollupRecord& rec) {
+            uint32_t window = windowStart(i, timestamp);
+            if (window >= start) {
+                merge(open, start, rec);
+                return;
+            }
+            if (missing.count > 0 && missing.timestamp != window) {
+                log.append(missing);
+                missing = RollupRecord();
+            }
+            merge(missing, window, rec);
+        };
+
+        if (i == 0) {
+            raw_.forEach(raw_.lowerBound(from), [&](const LogRecord& rec) {
+                RollupRecord sample = {};
+                sample.sum = rec.value;
+                sample.count = 1;
+                sample.min = rec.value;
+                sample.max = rec.value;
+                fold(rec.timestamp, sample);
+            });
+        } else {
+            tiers_[i - 1].forEach(tiers_[i - 1].lowerBound(from), [&](const RollupRecord& rec) {
+                fold(rec.timestamp, rec);
+            });
+            if (open_[i - 1].count > 0 && open_[i - 1].timestamp >= from) {
+                fold(open_[i - 1].timestamp, open_[i - 1]);
+            }
+        }
+        if (missing.count > 0) log.append(missing);
+    }
+}
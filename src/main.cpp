@@ -1,11 +1,30 @@
 #include <WiFi.h>
-#include <HTTPClient.h>
-#include <WebServer.h>
 #include <FS.h>
 #include <SPIFFS.h>
 #include <time.h>
+#include <math.h>
 #include <secrets.h>
-#include <Preferences.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+#include "SensorConfig.h"
+#include "SensorHistory.h"
+#include "HttpServer.h"
+#include "ResponseStream.h"
+#include "Downsample.h"
+#include "EventStream.h"
+#include "WebAssets.h"
+#include "AlertDispatcher.h"
+#include "AlertEngine.h"
+#include "SpscQueue.h"
+#include "Metrics.h"
+#include "ExportFormat.h"
+#include "FixedFormat.h"
+#include "RollingStats.h"
+#include "ResponseCache.h"
+#include "AdcFilter.h"
+#include <atomic>
+#include <initializer_list>
 
 // Description: This section defines whether the code runs in production or development mode.
 // Production mode uses longer logging intervals and is optimized for real-world use.
@@ -15,653 +34,857 @@
 #if PRODUCTION_MODE
   #define LOG_INTERVAL_SECONDS 600     // Log every 10 minutes in production mode
   #define MAX_LOG_ENTRIES 500
-  #define MAX_LINES_TO_KEEP 500          // Maximum number of log entries to store
-  #define TRIM_INTERVAL_MILLIS 10800000UL
+  #define RAW_LOG_BLOCKS 24              // Compressed 256-byte blocks per sensor (~2500 samples, ~17 days)
+  #define LOG_WRITE_BACK_MAX_AGE 3600    // Flush buffered samples to flash at least hourly
   #else
   #define LOG_INTERVAL_SECONDS 5       // Log every 5 seconds in development mode
   #define MAX_LOG_ENTRIES 500
-  #define MAX_LINES_TO_KEEP 10          // Maximum number of log entries to store
-  #define TRIM_INTERVAL_MILLIS 60000UL 
+  #define RAW_LOG_BLOCKS 4              // Compressed 256-byte blocks per sensor (~400 samples, ~35 minutes)
+  #define LOG_WRITE_BACK_MAX_AGE 60     // Flush buffered samples to flash every minute
   #endif
 
-// Description: Define the GPIO pins for the two moisture sensors and other constants.
-// These pins are connected to the sensors, and the dry threshold determines when a notification is sent.
-#define SENSOR_PIN_1 34            // GPIO pin for Alfons' moisture sensor
-#define SENSOR_PIN_2 35            // GPIO pin for Milla's moisture sensor
-#define FORCE_SPIFFS_FORMAT 1      // Set to 1 to force SPIFFS formatting on boot
+// Description: Storage and HTTP constants. The sensors themselves are listed in SENSORS below.
+#define FORCE_SPIFFS_FORMAT 0      // Set to 1 to wipe SPIFFS on boot (all history is lost)
+#define ROLLUP_10MIN_RECORDS 1008   // 7 days of 10-minute min/max/mean windows
+#define ROLLUP_HOURLY_RECORDS 2160  // 90 days of hourly windows
+#define ROLLUP_DAILY_RECORDS 730    // 2 years of daily windows
+#define SERIES_DEFAULT_POINTS 200  // Points returned by /series when none are requested
+#define SERIES_MAX_POINTS 1000     // Upper bound on points returned by /series
+#define SNAPSHOT_SAMPLES 20        // Recent samples per sensor sent to new /events subscribers
+#define SAMPLE_QUEUE_LENGTH 64     // Readings buffered between the sampling and storage tasks (power of two)
+#define STORAGE_POLL_MILLIS 100    // How often the storage task checks for new readings
+#define PENDING_SAMPLES 256        // Readings held in RAM while the clock is not yet set by NTP
+#define MIN_VALID_EPOCH 1609459200 // Clock readings before 2021 mean NTP has not synced yet
+#define WIFI_RETRY_MILLIS 10000    // Delay between Wi-Fi reconnect attempts
+#define HTTP_IDLE_WAIT_MILLIS 1    // How long loop() waits for HTTP traffic before its other work
+#define TELEGRAM_API_URL "https://api.telegram.org"  // Bot API base; an http:// URL works for a local stand-in
 const int DRY_THRESHOLD = 2000;    // Threshold for dry soil (adjust based on your sensor calibration)
 
-// Description: Initialize the web server on port 80 for hosting the dashboard.
-WebServer server(80);
-
-// Description: Global variables to track the last check time, notification status, and last logged time.
-unsigned long lastCheckTime = 0;
-bool notificationSent1 = false;    // Tracks if a notification was sent for Alfons
-bool notificationSent2 = false;    // Tracks if a notification was sent for Milla
-time_t lastLoggedTime = 0;         // Tracks the last time data was logged
-
-// Description: Logs moisture readings to a CSV file stored in SPIFFS. Implements a circular buffer to limit file size.
-void logMoisture(int sensor, int moisture) {
-    time_t now;
-    time(&now); // Get the current timestamp
-
-    String filename = (sensor == 1) ? "/data1.csv" : "/data2.csv";
+// Description: Initialize the web server on port 80 for hosting the dashboard. It serves several
+// keep-alive connections at once, so dashboards and scrapers do not queue behind each other.
+HttpServer server(80);
+
+// Description: Sensor registry, one entry per plant. Sampling, storage, alerts and the HTTP
+// endpoints all loop over this table; the "sensor" URL parameter is the 1-based position.
+const SensorConfig SENSORS[] = {
+    // name     pin  dry threshold  air   water  files
+    {"Alfons",  34,  DRY_THRESHOLD, 3200, 1300,  "/data1"},
+    {"Milla",   35,  DRY_THRESHOLD, 3200, 1300,  "/data2"},
+};
+const size_t SENSOR_COUNT = sizeof(SENSORS) / sizeof(SENSORS[0]);
+
+// Description: Per-sensor alert state: smoothed readings, drying trend and hysteresis. Only
+// the storage task writes these. An alert the dispatcher queue could not take is kept in
+// pendingAlerts and offered again with the next sample.
+AlertEngine alertEngines[SENSOR_COUNT];
+AlertEvent pendingAlerts[SENSOR_COUNT] = {};
+uint32_t pendingAlertsDropped = 0;   // Pending alerts replaced by a newer event before the queue took them
+uint32_t dryAlerts = 0;        // Dry alerts raised, one per dry spell per sensor
+uint32_t forecastAlerts = 0;   // Early warnings raised before a sensor turned dry
+
+// Description: Per-sensor history in SPIFFS: a raw sample ring buffer plus 10-minute, hourly
+// and daily rollups, each with its own retention budget.
+const RollupTierConfig ROLLUP_TIERS[ROLLUP_TIER_COUNT] = {
+    {600, ROLLUP_10MIN_RECORDS, "10m"},
+    {3600, ROLLUP_HOURLY_RECORDS, "1h"},
+    {86400, ROLLUP_DAILY_RECORDS, "1d"},
+};
+SensorHistory histories[SENSOR_COUNT];
+
+// Description: Per-sensor rolling min/max/mean over the last hour, day and week, kept in RAM
+// next to the histories and guarded by the same lock.
+RollingStats rollingStats[SENSOR_COUNT];
+
+// Description: The compressed block each sensor is filling. RTC memory keeps its contents
+// across soft resets and watchdog resets, so only a power loss can lose unwritten samples.
+RTC_NOINIT_ATTR SampleBlock openBlocks[SENSOR_COUNT];
+
+// Description: Live sample push to open dashboards over Server-Sent Events.
+EventStream events;
+
+// Description: Sends dry-soil Telegram messages from a background task so sampling and the
+// web server never wait on the network.
+AlertDispatcher alerts;
+
+// The web server, the /events streams it hands over and the one Telegram connection the
+// dispatcher keeps open share lwIP's sockets
+static_assert(HttpServer::SOCKETS_USED + EventStream::MAX_CLIENTS + 1 <= HttpServer::LWIP_SOCKETS,
+              "More sockets than lwIP has");
+
+
+// Description: Sampling runs in its own task and hands readings to the storage task through a
+// lock-free queue, so neither flash writes nor HTTP clients can delay a sample.
+struct Sample {
+    uint32_t timestamp;   // Epoch seconds, or seconds since boot if wallClock is false
+    int16_t value;
+    uint8_t sensor;
+    bool wallClock;
+};
+SpscQueue<Sample, SAMPLE_QUEUE_LENGTH> sampleQueue;
+
+// Description: Sampling timer measurements, written only by the sampling task.
+struct SamplerStats {
+    uint32_t rounds;              // Sampling rounds taken
+    uint32_t overflows;           // Readings lost because the storage task fell behind
+    uint32_t lastLatenessMicros;  // How late the last round started against its schedule
+    uint32_t maxLatenessMicros;
+};
+SamplerStats samplerStats = {};
+AdcReading adcReadings[SENSOR_COUNT] = {};   // Latest reading of each sensor, written only by the sampling task
+
+// Description: Wall-clock state. Sampling starts at boot, before Wi-Fi and NTP are up, so
+// until the clock is set readings are stamped with seconds since boot and held by the
+// storage task. Once it is set, bootEpoch moves them to wall-clock time.
+std::atomic<bool> clockSynced(false);
+uint32_t bootEpoch = 0;   // Wall-clock time at boot, valid once clockSynced is set
+
+uint32_t uptimeSeconds() { return millis() / 1000; }
+
+// Description: Readings taken before the clock was set, oldest first. Only the storage
+// task touches them.
+Sample pendingSamples[PENDING_SAMPLES];
+size_t pendingCount = 0;
+uint32_t pendingDropped = 0;   // Readings lost because the clock stayed unset too long
+
+// Description: Network bring-up state, advanced by updateNetwork() from loop().
+bool wifiConnected = false;
+bool serverStarted = false;
+unsigned long wifiAttemptMillis = 0;
+
+// Description: Hot-path latency histograms and counters served on /metrics. Each histogram
+// is recorded from one task only, noted on the right.
+LatencyHistogram loopLatency;           // loop(), one iteration
+LatencyHistogram handleClientLatency;   // loop()
+LatencyHistogram logMoistureLatency;    // Storage task
+LatencyHistogram adcReadLatency;        // Sampling task
+LatencyHistogram sampleLateness;        // Sampling task
+uint32_t wifiReconnects = 0;
+
+// Description: historyMutex guards the histories, which the storage task writes while the
+// web server reads them; hold a HistoryLock for the whole access. eventsMutex guards the
+// event stream clients, whose sockets are written outside historyMutex so a slow browser
+// never holds up the histories. An event is formatted under HistoryLock and sent under an
+// EventsLock taken before the HistoryLock is released, so events reach every subscriber in
+// the order the samples were logged. Never take historyMutex while holding eventsMutex.
+SemaphoreHandle_t historyMutex;
+SemaphoreHandle_t eventsMutex;
+
+class MutexLock {
+public:
+    explicit MutexLock(SemaphoreHandle_t mutex) : mutex_(mutex) { xSemaphoreTake(mutex_, portMAX_DELAY); }
+    ~MutexLock() { release(); }
+
+    // Gives the mutex back before the end of the scope.
+    void release() {
+        if (mutex_) xSemaphoreGive(mutex_);
+        mutex_ = nullptr;
+    }
 
-    File file = SPIFFS.open(filename, FILE_APPEND);
-    if (!file) {
-        Serial.println("Failed to open file for appending");
+private:
+    SemaphoreHandle_t mutex_;
+};
+
+class HistoryLock : public MutexLock {
+public:
+    HistoryLock() : MutexLock(historyMutex) {}
+};
+
+class EventsLock : public MutexLock {
+public:
+    EventsLock() : MutexLock(eventsMutex) {}
+};
+
+// Description: Appends a moisture reading to the sensor's history in SPIFFS.
+// The oldest record is overwritten once a buffer is full, so no trimming is needed.
+void logMoisture(size_t sensor, uint32_t timestamp, int moisture) {
+    ScopedLatency latency(logMoistureLatency);
+    HistoryLock lock;
+    if (!histories[sensor].append(timestamp, (int16_t)moisture)) {
+        Serial.println("Failed to append to log");
         return;
     }
+    rollingStats[sensor].add(timestamp, (int16_t)moisture);
 
-    file.printf("%lu,%d\r\n", now, moisture);
-    file.close();
+    char data[64];
+    snprintf(data, sizeof(data), "{\"sensor\":%u,\"t\":%lu,\"v\":%d}", (unsigned)(sensor + 1), (unsigned long)timestamp, moisture);
+    EventsLock eventsLock;
+    lock.release();
+    events.broadcast("sample", data);
+    eventsLock.release();
 
-    String sensorName = (sensor == 1) ? "Alfons" : "Milla";
-    Serial.println("Logged: " + String(now) + "," + String(moisture) + " to " + sensorName + "'s file");
+    logPrintf("Logged: %lu,%d to %s's file\n", (unsigned long)timestamp, moisture, SENSORS[sensor].name);
 }
 
-// Description: Sends a Telegram notification if the soil is too dry.
-// This function uses the Telegram Bot API to send a message to a predefined chat.
-void sendTelegramNotification(int sensor, int moisture) {
-    if (WiFi.status() == WL_CONNECTED) {
-        HTTPClient http;
-        String sensorName = (sensor == 1) ? "Alfons" : "Milla";
-
-        // Construct the Telegram API URL with the notification message
-        String url = "https://api.telegram.org/bot" + String(telegramBotToken) + 
-                    "/sendMessage?chat_id=" + String(telegramChatID) + 
-                    "&text=\U0001F335 " + sensorName + " is too dry! Moisture: " + 
-                    String(moisture);
-
-        // Send the HTTP GET request
-        http.begin(url);
-        int httpResponseCode = http.GET();
-        http.end();
-
-        // Log the result of the notification attempt
-        if (httpResponseCode > 0) {
-            Serial.println("Telegram notification sent for " + sensorName);
-        } else {
-            Serial.println("Failed to send Telegram message for " + sensorName);
+// Description: Takes one oversampled reading of every sensor and queues them, all stamped
+// `timestamp`.
+void sampleSensors(uint32_t timestamp, bool wallClock) {
+    for (size_t i = 0; i < SENSOR_COUNT; ++i) {
+        Sample sample = {timestamp, 0, (uint8_t)i, wallClock};
+        {
+            ScopedLatency latency(adcReadLatency);
+            adcReadings[i] = AdcFilter::read(SENSORS[i].pin);
         }
+        sample.value = adcReadings[i].value;
+        if (!sampleQueue.push(sample)) samplerStats.overflows++;
     }
 }
 
-// Description: Serves the HTML dashboard for monitoring moisture levels.
-// The dashboard includes graphs for Alfons and Milla, showing historical and recent data.
-void handleRoot() {
-    String html = R"rawliteral(
-        <!DOCTYPE html>
-        <html>
-        <head>
-            <title>Plant Moisture Graphs</title>
-            <meta name="viewport" content="width=device-width, initial-scale=1">
-            <link rel="preconnect" href="https://fonts.googleapis.com">
-            <link href="https://fonts.googleapis.com/css2?family=Inter:wght@400;600&display=swap" rel="stylesheet">
-            <script src="https://cdn.jsdelivr.net/npm/chart.js"></script>
-            <script src="https://cdn.jsdelivr.net/npm/chartjs-plugin-annotation@1.1.0"></script>
-            <style>
-                body {
-                    font-family: 'Inter', sans-serif;
-                    background-color: #f4f4f8;
-                    margin: 0;
-                    padding: 0;
-                }
-                .container {
-                    max-width: 800px;
-                    margin: 40px auto;
-                    padding: 20px;
-                    background: #fff;
-                    border-radius: 16px;
-                    box-shadow: 0 4px 20px rgba(0,0,0,0.05);
-                }
-                h2 {
-                    margin-top: 0;
-                    font-weight: 600;
-                    color: #333;
-                }
-                canvas {
-                    border-radius: 12px;
-                    box-shadow: 0 2px 8px rgba(0,0,0,0.05);
-                }
-            </style>
-        </head>
-        <body>
-            <div class="container">
-                <h2>Alfons' Moisture History</h2>
-                <canvas id="mainChart1" width="400" height="200"></canvas>
-            </div>
-
-            <div class="container">
-                <h2>Alfons' Recent Moisture Readings</h2>
-                <canvas id="miniChart1" width="400" height="200"></canvas>
-            </div>
-
-            <div class="container">
-                <h2>Milla's Moisture History</h2>
-                <canvas id="mainChart2" width="400" height="200"></canvas>
-            </div>
-
-            <div class="container">
-                <h2>Milla's Recent Moisture Readings</h2>
-                <canvas id="miniChart2" width="400" height="200"></canvas>
-            </div>
-
-            <script>
-                const PRODUCTION_MODE = %PRODUCTION_MODE%; // This will be replaced
-                const BUCKET_MINUTES = PRODUCTION_MODE ? 30 : 1;
-
-                const DRY_THRESHOLD = 2200;
-
-                const mainCtx1 = document.getElementById('mainChart1').getContext('2d');
-                const miniCtx1 = document.getElementById('miniChart1').getContext('2d');
-                const mainCtx2 = document.getElementById('mainChart2').getContext('2d');
-                const miniCtx2 = document.getElementById('miniChart2').getContext('2d');
-
-                const mainChart1 = new Chart(mainCtx1, {
-                    type: 'line',
-                    data: {
-                        labels: [],
-                        datasets: [{
-                            label: 'Moisture Level',
-                            data: [],
-                            borderColor: 'rgba(33, 150, 243, 0.9)',      // Regular blue
-                            backgroundColor: 'rgba(33, 150, 243, 0.1)',   // Light blue
-                            borderWidth: 2,
-                            tension: 0.4,
-                            fill: true
-                        }]
-                    },
-                    options: {
-                        animation: {
-                            duration: 500,
-                            easing: 'easeOutQuart'
-                        },
-                        scales: {
-                            x: {
-                                type: 'category',
-                                ticks: { autoSkip: true, maxTicksLimit: 20, maxRotation: 45, minRotation: 0 },
-                                title: { display: true, text: 'Time' }
-                            },
-                            y: {
-                                beginAtZero: true,
-                                title: { display: true, text: 'Soil Moisture' }
-                            }
-                        },
-                        plugins: {
-                            annotation: {
-                                annotations: {
-                                    threshold: {
-                                        type: 'line',
-                                        yMin: DRY_THRESHOLD,
-                                        yMax: DRY_THRESHOLD,
-                                        borderColor: 'red',
-                                        borderWidth: 2,
-                                    }
-                                }
-                            },
-                            legend: {
-                                labels: {
-                                    font: { size: 14 },
-                                    color: '#444'
-                                }
-                            },
-                            title: {
-                                display: false
-                            }
-                        }
-                    }
-                });
-
-                const miniChart1 = new Chart(miniCtx1, {
-                    type: 'line',
-                    data: {
-                        labels: [],
-                        datasets: [{
-                            label: 'Moisture Level',
-                            data: [],
-                            borderColor: 'rgba(100, 181, 246, 0.9)',     // Light blue
-                            backgroundColor: 'rgba(100, 181, 246, 0.1)',  // Very light blue
-                            borderWidth: 1,
-                            fill: true
-                        }]
-                    },
-                    options: {
-                        animation: {
-                            duration: 400,
-                            easing: 'easeOutQuart'
-                        },
-                        scales: {
-                            x: {
-                                type: 'category',
-                                title: { display: true, text: 'Time' }
-                            },
-                            y: {
-                                beginAtZero: true,
-                                title: { display: true, text: 'Soil Moisture' }
-                            }
-                        },
-                        plugins: {
-                            annotation: {
-                                annotations: {
-                                    threshold: {
-                                        type: 'line',
-                                        yMin: DRY_THRESHOLD,
-                                        yMax: DRY_THRESHOLD,
-                                        borderColor: 'red',
-                                        borderWidth: 2,
-                                    }
-                                }
-                            },
-                            legend: {
-                                labels: {
-                                    font: { size: 14 },
-                                    color: '#444'
-                                }
-                            }
-                        }
-                    }
-                });
-
-                const mainChart2 = new Chart(mainCtx2, {
-                    type: 'line',
-                    data: {
-                        labels: [],
-                        datasets: [{
-                            label: 'Moisture Level',
-                            data: [],
-                            borderColor: 'rgba(233, 30, 99, 0.9)',       // Regular pink
-                            backgroundColor: 'rgba(233, 30, 99, 0.1)',    // Light pink
-                            borderWidth: 2,
-                            tension: 0.4,
-                            fill: true
-                        }]
-                    },
-                    options: {
-                        animation: {
-                            duration: 500,
-                            easing: 'easeOutQuart'
-                        },
-                        scales: {
-                            x: {
-                                type: 'category',
-                                ticks: { autoSkip: true, maxTicksLimit: 20, maxRotation: 45, minRotation: 0 },
-                                title: { display: true, text: 'Time' }
-                            },
-                            y: {
-                                beginAtZero: true,
-                                title: { display: true, text: 'Soil Moisture' }
-                            }
-                        },
-                        plugins: {
-                            annotation: {
-                                annotations: {
-                                    threshold: {
-                                        type: 'line',
-                                        yMin: DRY_THRESHOLD,
-                                        yMax: DRY_THRESHOLD,
-                                        borderColor: 'red',
-                                        borderWidth: 2,
-                                    }
-                                }
-                            },
-                            legend: {
-                                labels: {
-                                    font: { size: 14 },
-                                    color: '#444'
-                                }
-                            },
-                            title: {
-                                display: false
-                            }
-                        }
-                    }
-                });
-
-                const miniChart2 = new Chart(miniCtx2, {
-                    type: 'line',
-                    data: {
-                        labels: [],
-                        datasets: [{
-                            label: 'Moisture Level',
-                            data: [],
-                            borderColor: 'rgba(240, 98, 146, 0.9)',      // Light pink
-                            backgroundColor: 'rgba(240, 98, 146, 0.1)',   // Very light pink
-                            borderWidth: 1,
-                            fill: true
-                        }]
-                    },
-                    options: {
-                        animation: {
-                            duration: 400,
-                            easing: 'easeOutQuart'
-                        },
-                        scales: {
-                            x: {
-                                type: 'category',
-                                title: { display: true, text: 'Time' }
-                            },
-                            y: {
-                                beginAtZero: true,
-                                title: { display: true, text: 'Soil Moisture' }
-                            }
-                        },
-                        plugins: {
-                            annotation: {
-                                annotations: {
-                                    threshold: {
-                                        type: 'line',
-                                        yMin: DRY_THRESHOLD,
-                                        yMax: DRY_THRESHOLD,
-                                        borderColor: 'red',
-                                        borderWidth: 2,
-                                    }
-                                }
-                            },
-                            legend: {
-                                labels: {
-                                    font: { size: 14 },
-                                    color: '#444'
-                                }
-                            }
-                        }
-                    }
-                });
-
-                async function fetchCSV(sensor) {
-                    const response = await fetch(`/log?sensor=${sensor}`);
-                    const text = await response.text();
-                    const lines = text.trim().split("\n");
-
-                    // Main chart: per-minute averages + smoothing
-                    const minuteBuckets = {};
-                    lines.forEach(line => {
-                        const [timestamp, value] = line.trim().split(",");
-                        const ts = parseInt(timestamp.trim()) * 1000;
-                        const date = new Date(ts);
-                        const roundedMinutes = Math.floor(date.getMinutes() / BUCKET_MINUTES) * BUCKET_MINUTES;
-                        const minuteKey = date.getFullYear() + "-" +
-                    String(date.getMonth() + 1).padStart(2, '0') + "-" +
-                    String(date.getDate()).padStart(2, '0') + " " +
-                    String(date.getHours()).padStart(2, '0') + ":" +
-                    String(roundedMinutes).padStart(2, '0');
-
-                        if (!minuteBuckets[minuteKey]) minuteBuckets[minuteKey] = [];
-                        minuteBuckets[minuteKey].push(parseInt(value));
-                    });
-
-                    const minuteAverages = Object.entries(minuteBuckets)
-                    .filter(([_, values]) => values.length > 0) // Remove empty buckets
-                    .map(([minute, values]) => ({
-                    label: minute,
-                     avg: values.reduce((a, b) => a + b, 0) / values.length
-                     }));
-
-                    const mainLabels = minuteAverages.map(item => item.label);
-                    const bucketedData = minuteAverages.map(item => item.avg);
-
-                    if (sensor === 1) {
-                        mainChart1.data.labels = mainLabels;
-                        mainChart1.data.datasets[0].data = bucketedData;  // Changed from smoothedData
-                        mainChart1.update();
-
-                        // Mini chart: last 20 raw entries
-                        const lastLines = lines.slice(-20);
-                        const miniLabels = [];
-                        const miniData = [];
-
-                        lastLines.forEach(line => {
-                            const [timestamp, value] = line.trim().split(",");
-                            const ts = parseInt(timestamp.trim()) * 1000;
-                            const date = new Date(ts);
-                            miniLabels.push(date.toLocaleTimeString());
-                            miniData.push(parseInt(value));
-                        });
-
-                        miniChart1.data.labels = miniLabels;
-                        miniChart1.data.datasets[0].data = miniData;
-                        miniChart1.update();
-                    } else {
-                        mainChart2.data.labels = mainLabels;
-                        mainChart2.data.datasets[0].data = bucketedData;  // Changed from smoothedData
-                        mainChart2.update();
-
-                        // Mini chart: last 20 raw entries
-                        const lastLines = lines.slice(-20);
-                        const miniLabels = [];
-                        const miniData = [];
-
-                        lastLines.forEach(line => {
-                            const [timestamp, value] = line.trim().split(",");
-                            const ts = parseInt(timestamp.trim()) * 1000;
-                            const date = new Date(ts);
-                            miniLabels.push(date.toLocaleTimeString());
-                            miniData.push(parseInt(value));
-                        });
-
-                        miniChart2.data.labels = miniLabels;
-                        miniChart2.data.datasets[0].data = miniData;
-                        miniChart2.update();
-                    }
-                }
-
-                setInterval(() => fetchCSV(1), 5000);
-                setInterval(() => fetchCSV(2), 5000);
-            </script>
-        </body>
-        </html>
-    )rawliteral";
-
-    // Replace the placeholder with the actual production mode value
-    html.replace("%PRODUCTION_MODE%", PRODUCTION_MODE ? "true" : "false");
-
-    server.send(200, "text/html", html);
+// Description: Reads every sensor once per LOG_INTERVAL_SECONDS on a fixed schedule and queues
+// the readings. This task does no I/O besides the ADC, so its timing only depends on the
+// scheduler; how late each round starts is recorded in samplerStats.
+void samplerTask(void*) {
+    const uint32_t periodMicros = LOG_INTERVAL_SECONDS * 1000000UL;
+    TickType_t lastWake = xTaskGetTickCount();
+    uint32_t dueMicros = micros();
+
+    for (;;) {
+        int32_t lateness = (int32_t)(micros() - dueMicros);
+        if (lateness < 0) lateness = 0;  // Tick rounding can wake the task slightly early
+        bool synced = clockSynced;
+        sampleSensors(synced ? (uint32_t)time(nullptr) : uptimeSeconds(), synced);
+
+        sampleLateness.record(lateness);
+        samplerStats.rounds++;
+        samplerStats.lastLatenessMicros = lateness;
+        if ((uint32_t)lateness > samplerStats.maxLatenessMicros) samplerStats.maxLatenessMicros = lateness;
+
+        vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(LOG_INTERVAL_SECONDS * 1000UL));
+        dueMicros += periodMicros;
+    }
 }
 
-void trimLogFile(const String& filename, int maxLines) {
-    File file = SPIFFS.open(filename, FILE_READ);
-    if (!file) {
-        Serial.println("Failed to open " + filename + " for trimming");
-        return;
+// Description: Feeds one logged reading to its sensor's AlertEngine and offers the alert it
+// causes, or one still pending, to the dispatcher. `timestamp` is wall-clock time, as logged.
+void checkAlerts(size_t sensor, uint32_t timestamp, int16_t value) {
+    // A newer event replaces one still waiting for room in the alert queue
+    AlertEngine& engine = alertEngines[sensor];
+    AlertEvent event = engine.update(timestamp, value);
+    if (event != ALERT_NONE) {
+        if (pendingAlerts[sensor] != ALERT_NONE) pendingAlertsDropped++;
+        pendingAlerts[sensor] = event;
     }
 
-    std::vector<String> lines;
-    while (file.available()) {
-        lines.push_back(file.readStringUntil('\n'));
+    if (pendingAlerts[sensor] == ALERT_RECOVERED) {
+        pendingAlerts[sensor] = ALERT_NONE;
+    } else if (pendingAlerts[sensor] == ALERT_DRY) {
+        if (alerts.enqueue(SENSORS[sensor].name, (int)engine.smoothed())) {
+            pendingAlerts[sensor] = ALERT_NONE;
+            dryAlerts++;
+        }
+    } else if (pendingAlerts[sensor] == ALERT_FORECAST) {
+        if (alerts.enqueue(SENSORS[sensor].name, (int)engine.smoothed(), engine.hoursToDry())) {
+            pendingAlerts[sensor] = ALERT_NONE;
+            forecastAlerts++;
+        }
     }
-    file.close();
+}
 
-    if (lines.size() <= maxLines) return;
+// Description: Writes the readings held since boot once the clock has been set, moving
+// their timestamps from seconds since boot to wall-clock time.
+void backfillPending() {
+    if (pendingCount == 0 || !clockSynced) return;
 
-    lines.erase(lines.begin(), lines.begin() + (lines.size() - maxLines));
+    logPrintf("Clock set, writing %u readings taken before it\n", (unsigned)pendingCount);
+    for (size_t i = 0; i < pendingCount; ++i) {
+        const Sample& sample = pendingSamples[i];
+        logMoisture(sample.sensor, bootEpoch + sample.timestamp, sample.value);
+        checkAlerts(sample.sensor, bootEpoch + sample.timestamp, sample.value);
+    }
+    pendingCount = 0;
+}
 
-    File trimmedFile = SPIFFS.open(filename, FILE_WRITE);
-    if (trimmedFile) {
-        for (const auto& line : lines) {
-            trimmedFile.println(line);
+// Description: Logs one reading and checks it for alerts, or holds it if it was taken before
+// the clock was set. Held readings are checked when they are written, so the alert engine
+// only ever sees wall-clock time.
+void storeSample(Sample sample) {
+    if (!sample.wallClock) {
+        if (!clockSynced) {
+            if (pendingCount < PENDING_SAMPLES) {
+                pendingSamples[pendingCount++] = sample;
+            } else {
+                pendingDropped++;
+            }
+            return;
         }
-        trimmedFile.close();
-        Serial.println("Trimmed " + filename + " to " + String(maxLines) + " lines (background).");
+        sample.timestamp += bootEpoch;
     }
+
+    // Held readings are older than this one, so they go first to keep the log in order
+    backfillPending();
+    logMoisture(sample.sensor, sample.timestamp, sample.value);
+    checkAlerts(sample.sensor, sample.timestamp, sample.value);
 }
 
-// Description: Initializes the ESP32, mounts SPIFFS, connects to Wi-Fi, and starts the web server.
-void setup() {
-    Serial.begin(115200);
+// Description: Drains the sample queue: writes each reading to flash, pushes it to the
+// dashboards and raises dry alerts. Returns whether anything was logged.
+bool processSamples() {
+    backfillPending();
+
+    Sample sample;
+    bool logged = false;
+    while (sampleQueue.pop(sample)) {
+        logPrintf("Moisture check %s: %d\n", SENSORS[sample.sensor].name, sample.value);
+        storeSample(sample);
+        logged = true;
+    }
+    return logged;
+}
 
-    // Format SPIFFS if forced
-    if (FORCE_SPIFFS_FORMAT) {
-        Serial.println("Forced SPIFFS format requested...");
-        if (SPIFFS.format()) {
-            Serial.println("SPIFFS formatted successfully.");
-        } else {
-            Serial.println("SPIFFS formatting failed!");
+// Description: Storage task: processes queued readings every STORAGE_POLL_MILLIS.
+void storageTask(void*) {
+    for (;;) {
+        if (processSamples()) {
+            logPrintf("Sampler: round %lu started %lu us late (max %lu us), %lu readings dropped\n",
+                      (unsigned long)samplerStats.rounds, (unsigned long)samplerStats.lastLatenessMicros,
+                      (unsigned long)samplerStats.maxLatenessMicros, (unsigned long)samplerStats.overflows);
         }
+        vTaskDelay(pdMS_TO_TICKS(STORAGE_POLL_MILLIS));
     }
+}
 
-    // Mount SPIFFS
-    if (!SPIFFS.begin(true)) {
-        Serial.println("SPIFFS Mount Failed");
+// Description: Serves one of the gzip-compressed dashboard files generated from web/ at build time.
+// The bytes are sent straight from flash; a matching If-None-Match gets 304 with no body.
+void serveAsset(const WebAsset& asset) {
+    server.sendHeader("ETag", asset.etag);
+    server.sendHeader("Cache-Control", asset.cacheControl);
+    if (strcmp(server.headerValue("If-None-Match"), asset.etag) == 0) {
+        server.send(304);
         return;
     }
-    Serial.println("SPIFFS mounted successfully");
+    server.sendHeader("Content-Encoding", "gzip");
+    server.send_P(200, asset.contentType, (const char*)asset.data, asset.length);
+}
+
+// Description: Query responses change only when a sample is logged. They carry an ETag built
+// from the history generations they read, a client that already holds that version gets
+// 304, and the latest bodies are kept in responseCache for other clients. Only the HTTP
+// server task uses these.
+typedef FixedFormat<64> ETag;
+typedef FixedFormat<ResponseCache::KEY_SIZE> RequestKey;
+ResponseCache responseCache;
+uint32_t notModifiedResponses = 0;
+
+// Description: ETag of a response that reads one sensor's history. The newest timestamp
+// keeps it unique should a wiped log count its generations up again. Hold a HistoryLock.
+ETag historyETag(size_t sensor) {
+    ETag etag;
+    etag.appendf("\"%u-%lu-%lu\"", (unsigned)(sensor + 1), (unsigned long)histories[sensor].generation(),
+                 (unsigned long)histories[sensor].newestTimestamp());
+    return etag;
+}
+
+// Description: Sends the ETag of the response about to follow and answers 304 instead if the
+// client already has it. Returns true if the request is done. A truncated ETag could match
+// an older version, so none is sent and the response is always built.
+bool notModified(const ETag& etag) {
+    server.sendHeader("Cache-Control", "no-cache");
+    if (etag.truncated()) return false;
+    server.sendHeader("ETag", etag.c_str());
+    if (strcmp(server.headerValue("If-None-Match"), etag.c_str()) != 0) return false;
+    server.send(304);
+    notModifiedResponses++;
+    return true;
+}
+
+// Description: Identifies a request by its path and the values of `params` that are present.
+RequestKey requestKey(const char* path, std::initializer_list<const char*> params) {
+    RequestKey key;
+    key.append(path);
+    for (const char* name : params) {
+        if (server.hasArg(name)) key.appendf("&%s=%s", name, server.argValue(name));
+    }
+    return key;
+}
+
+// Description: Answers from responseCache if it holds this request's body at `generation`.
+bool serveCached(const RequestKey& key, uint32_t generation, const char* contentType) {
+    if (key.truncated()) return false;
+    const ResponseCache::Slot* slot = responseCache.find(key.c_str(), generation);
+    if (!slot) return false;
+    server.send_P(200, contentType, slot->body, slot->length);
+    return true;
+}
 
-    Preferences preferences;
-    preferences.begin("PlantMonitor", false); // Open namespace "PlantMonitor"
+// Description: Copies the body `out` streams into a cache slot. Pass the returned slot to
+// responseCache.commit() once the response has ended.
+ResponseCache::Slot* recordResponse(ResponseStream& out, const RequestKey& key, uint32_t generation) {
+    ResponseCache::Slot* slot = key.truncated() ? nullptr : responseCache.claim(key.c_str(), generation);
+    if (slot) out.record(slot->body, sizeof(slot->body));
+    return slot;
+}
 
-    // Check if SPIFFS has already been formatted
-    bool isFormatted = preferences.getBool("isFormatted", false);
+// Description: Runtime settings the static dashboard needs, kept out of the cached page,
+// including the sensor table so the page can lay out one chart pair per sensor.
+void handleConfig() {
+    server.sendHeader("Cache-Control", "no-cache");
+    ResponseStream out(server);
+    out.begin(200, "application/json");
+    out.printf("{\"productionMode\":%s,\"logIntervalSeconds\":%d,\"seriesPoints\":%d,\"sensors\":[",
+               PRODUCTION_MODE ? "true" : "false", LOG_INTERVAL_SECONDS, PRODUCTION_MODE ? SERIES_DEFAULT_POINTS : 60);
+    for (size_t i = 0; i < SENSOR_COUNT; ++i) {
+        const SensorConfig& sensor = SENSORS[i];
+        out.printf("%s{\"id\":%u,\"name\":\"%s\",\"dryThreshold\":%d,\"rearmThreshold\":%d,\"airValue\":%d,\"waterValue\":%d}",
+                   i ? "," : "", (unsigned)(i + 1), sensor.name, sensor.dryThreshold, alertEngines[i].rearmThreshold(),
+                   sensor.airValue, sensor.waterValue);
+    }
+    out.print("]}");
+    out.end();
+}
 
-    if (FORCE_SPIFFS_FORMAT || !isFormatted) {
-        Serial.println("Formatting SPIFFS...");
-        if (SPIFFS.format()) {
-            Serial.println("SPIFFS formatted successfully.");
-            preferences.putBool("isFormatted", true); // Remember that we formatted
+// Description: Maps the 1-based "sensor" request parameter to an index into SENSORS.
+// Answers 404 and returns -1 if there is no such sensor.
+int sensorFromRequest() {
+    long id = strtol(server.argValue("sensor"), nullptr, 10);
+    if (id < 1 || id > (long)SENSOR_COUNT) {
+        server.send(404, "text/plain", "Unknown sensor");
+        return -1;
+    }
+    return id - 1;
+}
+
+// Description: Serves a downsampled view of one sensor's history in a single pass over the log.
+// Parameters: sensor, from/to (epoch seconds, default to the full history), points (max rows),
+// mode=lttb for Largest-Triangle-Three-Buckets "timestamp,value" rows; the default mode
+// returns fixed-width time buckets as "start,min,max,mean" rows. The coarsest rollup tier
+// that is still finer than the requested bucket width is read instead of raw samples.
+void handleSeries() {
+    int sensor = sensorFromRequest();
+    if (sensor < 0) return;
+    HistoryLock lock;
+    SensorHistory& history = histories[sensor];
+    if (notModified(historyETag(sensor))) return;
+    RequestKey key = requestKey("/series", {"sensor", "from", "to", "points", "mode"});
+    if (serveCached(key, history.generation(), "text/plain")) return;
+
+    // The defaults cost flash reads, so they are only looked up when needed
+    uint32_t from, to;
+    if (server.hasArg("from")) {
+        from = server.argUnsigned("from", 0);
+    } else {
+        from = history.oldestTimestamp();
+    }
+    if (server.hasArg("to")) {
+        to = server.argUnsigned("to", 0);
+    } else {
+        to = history.newestTimestamp();
+        if (to == 0) to = (uint32_t)time(nullptr);
+    }
+
+    uint32_t points = server.argUnsigned("points", SERIES_DEFAULT_POINTS);
+    if (points == 0 || points > SERIES_MAX_POINTS) points = SERIES_MAX_POINTS;
+
+    BucketDownsampler buckets(from, to, points);
+    int tier = history.tierFor(buckets.width());
+
+    SampleLog& raw = history.raw();
+    // fromSeq is looked up last so forEach() can reuse the block it found
+    uint32_t toSeq = (to == UINT32_MAX) ? raw.nextSeq() : raw.lowerBound(to + 1);
+    uint32_t fromSeq = raw.lowerBound(from);
+
+    ResponseStream out(server);
+    out.begin(200, "text/plain");
+    ResponseCache::Slot* slot = recordResponse(out, key, history.generation());
+
+    if (strcmp(server.argValue("mode"), "lttb") == 0) {
+        uint32_t count = (tier < 0) ? toSeq - fromSeq : history.rollupCount(tier, from, to);
+        LttbDownsampler lttb(count, points);
+        SeriesPoint point;
+        auto emit = [&](uint32_t timestamp, int16_t value) {
+            if (lttb.add(timestamp, value, point)) {
+                out.printf("%lu,%d\n", (unsigned long)point.timestamp, point.value);
+            }
+        };
+        if (tier < 0) {
+            raw.forEach(fromSeq, toSeq, [&](const LogRecord& r) { emit(r.timestamp, r.value); });
         } else {
-            Serial.println("SPIFFS formatting failed!");
+            history.forEachRollup(tier, from, to, [&](const RollupRecord& r) {
+                emit(r.timestamp, (int16_t)(r.sum / (int32_t)r.count));
+            });
+        }
+        SeriesPoint tail[LttbDownsampler::MAX_FINISH_POINTS];
+        size_t n = lttb.finish(tail);
+        for (size_t i = 0; i < n; ++i) {
+            out.printf("%lu,%d\n", (unsigned long)tail[i].timestamp, tail[i].value);
         }
     } else {
-        Serial.println("SPIFFS already formatted. Skipping format step.");
+        SeriesBucket bucket;
+        auto emit = [&]() {
+            out.printf("%lu,%d,%d,%.1f\n", (unsigned long)bucket.start, bucket.min, bucket.max, bucket.mean);
+        };
+        if (tier < 0) {
+            raw.forEach(fromSeq, toSeq, [&](const LogRecord& r) {
+                if (buckets.add(r.timestamp, r.value, bucket)) emit();
+            });
+        } else {
+            history.forEachRollup(tier, from, to, [&](const RollupRecord& r) {
+                if (buckets.add(r.timestamp, r.min, r.max, r.sum, r.count, bucket)) emit();
+            });
+        }
+        if (buckets.finish(bucket)) emit();
     }
+    out.end();
+    responseCache.commit(slot, out.recorded(), out.recordedAll());
+}
 
-    preferences.end(); // Close preferences
-
-    // Connect to Wi-Fi
-    WiFi.begin(ssid, password);
-    while (WiFi.status() != WL_CONNECTED) {
-        delay(500);
-        Serial.print(".");
-    }
-    Serial.println("\nWi-Fi Connected!");
-    Serial.print("ESP32 IP address: ");
-    Serial.println(WiFi.localIP());
-
-    // Initialize RTC with NTP
-    configTime(0, 0, "pool.ntp.org", "time.nist.gov");
-    struct tm timeinfo;
-    if (!getLocalTime(&timeinfo)) {
-        Serial.println("Failed to obtain time");
-        return;
+// Description: Streams one sensor's raw samples in the binary format of ExportFormat.h.
+// Parameters: sensor, after=<seq> (only records with a larger sequence number), limit=<N>
+// (at most N records, oldest first, so a collector can page through a large backlog).
+// A cursor beyond the newest sample comes from a log that was wiped since; the whole
+// log is sent again and the header's fromSeq tells the collector.
+void handleExport() {
+    int sensor = sensorFromRequest();
+    if (sensor < 0) return;
+    HistoryLock lock;
+    SampleLog& sampleLog = histories[sensor].raw();
+
+    uint32_t fromSeq = sampleLog.firstSeq();
+    if (server.hasArg("after")) {
+        uint32_t after = server.argUnsigned("after", 0);
+        if (after < sampleLog.nextSeq() && after >= fromSeq) fromSeq = after + 1;
+    }
+    uint32_t toSeq = sampleLog.nextSeq();
+    if (server.hasArg("limit")) {
+        uint32_t limit = server.argUnsigned("limit", 0);
+        if (toSeq - fromSeq > limit) toSeq = fromSeq + limit;
     }
-    Serial.println("Time initialized");
 
-    // Start the web server
-    server.on("/", handleRoot);
+    ExportHeader header = {EXPORT_MAGIC, EXPORT_VERSION, (uint8_t)(sensor + 1), sizeof(ExportRecord), fromSeq, toSeq};
+    if (notModified(historyETag(sensor))) return;
+    ResponseStream out(server);
+    out.begin(200, "application/octet-stream");
+    out.write((const char*)&header, sizeof(header));
+    sampleLog.forEach(fromSeq, toSeq, [&out](const LogRecord& rec) {
+        ExportRecord record = {rec.seq, rec.timestamp, rec.value, 0};
+        out.write((const char*)&record, sizeof(record));
+    });
+    out.end();
+}
 
-    server.on("/log", []() {
-        String sensor = server.arg("sensor");
-        String filename = (sensor == "1") ? "/data1.csv" : "/data2.csv";
-    
-        File file = SPIFFS.open(filename, FILE_READ);
-        if (!file) {
-            server.send(500, "text/plain", "Failed to open file");
-            return;
+// Description: Current reading and rolling statistics of every sensor, from RAM. Each
+// window ends at the sensor's newest reading:
+//   {"sensors":[{"id":1,"name":"Alfons","t":1700000000,"current":1873,
+//     "windows":{"1h":{"count":6,"mean":1870.5,"stddev":3.1,"min":1866,"max":1875},...}}]}
+void handleStats() {
+    // Only the summaries are copied, so the lock is not held while sending
+    RollingSummary summaries[SENSOR_COUNT][RollingStats::WINDOW_COUNT];
+    bool hasLatest[SENSOR_COUNT];
+    uint32_t latestTimestamps[SENSOR_COUNT];
+    int16_t latestValues[SENSOR_COUNT];
+    ETag etag;
+    {
+        HistoryLock lock;
+        // Generations only grow, so their sum changes with every sample logged on any
+        // sensor, and the ETag stays the same width however many sensors there are
+        uint32_t generations = 0;
+        uint32_t newest = 0;
+        for (size_t i = 0; i < SENSOR_COUNT; ++i) {
+            generations += histories[i].generation();
+            if (rollingStats[i].latestTimestamp() > newest) newest = rollingStats[i].latestTimestamp();
         }
-    
-        std::vector<String> lines;
-        while (file.available()) {
-            lines.push_back(file.readStringUntil('\n'));
+        etag.appendf("\"s%lu-%lu\"", (unsigned long)generations, (unsigned long)newest);
+        for (size_t i = 0; i < SENSOR_COUNT; ++i) {
+            for (size_t w = 0; w < RollingStats::WINDOW_COUNT; ++w) summaries[i][w] = rollingStats[i].summary(w);
+            hasLatest[i] = rollingStats[i].hasLatest();
+            latestTimestamps[i] = rollingStats[i].latestTimestamp();
+            latestValues[i] = rollingStats[i].latestValue();
         }
-        file.close();
-    
-        // Trim to the last entries if needed
-        const int MAX_LINES = MAX_LINES_TO_KEEP;
-        if (lines.size() > MAX_LINES) {
-            lines.erase(lines.begin(), lines.begin() + (lines.size() - MAX_LINES));
-        
-            File trimmedFile = SPIFFS.open(filename, FILE_WRITE);
-            if (trimmedFile) {
-                for (const auto& line : lines) {
-                    trimmedFile.println(line);
-                }
-                trimmedFile.close();
-                Serial.println("Trimmed " + filename + " to " + String(MAX_LINES) + " lines.");
+    }
+
+    if (notModified(etag)) return;
+    ResponseStream out(server);
+    out.begin(200, "application/json");
+    out.print("{\"sensors\":[");
+    for (size_t i = 0; i < SENSOR_COUNT; ++i) {
+        out.printf("%s{\"id\":%u,\"name\":\"%s\"", i ? "," : "", (unsigned)(i + 1), SENSORS[i].name);
+        if (hasLatest[i]) out.printf(",\"t\":%lu,\"current\":%d", (unsigned long)latestTimestamps[i], latestValues[i]);
+        out.print(",\"windows\":{");
+        for (size_t w = 0; w < RollingStats::WINDOW_COUNT; ++w) {
+            const RollingSummary& summary = summaries[i][w];
+            out.printf("%s\"%s\":{\"count\":%lu", w ? "," : "", RollingStats::WINDOW_NAMES[w], (unsigned long)summary.count);
+            if (summary.count > 0) {
+                out.printf(",\"mean\":%.1f,\"stddev\":%.1f,\"min\":%d,\"max\":%d", summary.mean,
+                           sqrtf(summary.variance()), summary.min, summary.max);
             }
-        }              
-    
-        // Serve the log data
-        String output;
-        for (const auto& line : lines) {
-            output += line + "\n";
+            out.print("}");
         }
-    
-        server.send(200, "text/plain", output);
-    });
-    
+        out.print("}}");
+    }
+    out.print("]}");
+    out.end();
+}
+
+// Description: Opens a Server-Sent Events stream. The newest samples of each sensor are sent
+// right away as a snapshot, after which the client receives every new sample as it is logged.
+void handleEvents() {
+    static FixedFormat<SENSOR_COUNT * SNAPSHOT_SAMPLES * EventStream::EVENT_SIZE> snapshot;   // loop() only
+    snapshot.clear();
+
+    HistoryLock lock;
+    for (size_t sensor = 0; sensor < SENSOR_COUNT; ++sensor) {
+        SampleLog& sampleLog = histories[sensor].raw();
+        uint32_t fromSeq = sampleLog.size() > SNAPSHOT_SAMPLES ? sampleLog.nextSeq() - SNAPSHOT_SAMPLES : sampleLog.firstSeq();
+        sampleLog.forEach(fromSeq, [&](const LogRecord& rec) {
+            char data[64];
+            snprintf(data, sizeof(data), "{\"sensor\":%u,\"t\":%lu,\"v\":%d}", (unsigned)(sensor + 1), (unsigned long)rec.timestamp, rec.value);
+            EventStream::format(snapshot, "sample", data);
+        });
+    }
+    EventsLock eventsLock;
+    lock.release();
 
-    server.begin();
-    Serial.println("Web server started.");
+    WiFiClient client = server.client();
+    if (!events.subscribe(client, snapshot.c_str(), snapshot.length())) {
+        eventsLock.release();
+        server.send(503, "text/plain", "Too many event stream clients");
+    }
 }
 
-// Description: Main loop that handles client requests and logs sensor data at regular intervals.
-void loop() {
-    if (WiFi.status() != WL_CONNECTED) {
+// Description: Health and performance figures in the Prometheus text format, so a fleet of
+// boards can be scraped and compared.
+void handleMetrics() {
+    size_t eventClients;
+    uint32_t eventsSkipped;
+    {
+        EventsLock lock;
+        eventClients = events.clientCount();
+        eventsSkipped = events.skippedCount();
+    }
+
+    ResponseStream out(server);
+    out.begin(200, "text/plain; version=0.0.4");
+
+    loopLatency.print(out, "plant_loop_seconds", "Duration of one loop() iteration");
+    handleClientLatency.print(out, "plant_http_handle_client_seconds", "Duration of server.handleClient()");
+    logMoistureLatency.print(out, "plant_log_moisture_seconds", "Duration of logMoisture(), including the flash write");
+    adcReadLatency.print(out, "plant_adc_read_seconds", "Duration of one oversampled, filtered sensor reading");
+    sampleLateness.print(out, "plant_sample_lateness_seconds", "How late each sampling round starts against its schedule");
+    alerts.sendLatency().print(out, "plant_telegram_send_seconds", "Duration of one Telegram send attempt");
+
+    printMetric(out, "plant_sample_rounds_total", "counter", "Sampling rounds taken", samplerStats.rounds);
+    printMetric(out, "plant_sample_overflows_total", "counter", "Readings lost to a full sample queue", samplerStats.overflows);
+    printMetric(out, "plant_sample_lateness_max_seconds", "gauge", "Worst sampling round lateness since boot",
+                samplerStats.maxLatenessMicros / 1e6);
+    printMetric(out, "plant_clock_synced", "gauge", "1 once NTP has set the clock", clockSynced ? 1 : 0);
+    printMetric(out, "plant_samples_pending", "gauge", "Readings held until the clock is set", pendingCount);
+    printMetric(out, "plant_samples_pending_dropped_total", "counter", "Readings lost while the clock was unset",
+                pendingDropped);
+    printMetric(out, "plant_dry_alerts_total", "counter", "Dry alerts raised", dryAlerts);
+    printMetric(out, "plant_forecast_alerts_total", "counter", "Early warnings raised before a sensor turned dry",
+                forecastAlerts);
+    out.print("# HELP plant_moisture_smoothed Smoothed raw reading the alerts act on\n# TYPE plant_moisture_smoothed gauge\n");
+    for (size_t i = 0; i < SENSOR_COUNT; ++i) {
+        out.printf("plant_moisture_smoothed{sensor=\"%s\"} %.1f\n", SENSORS[i].name, alertEngines[i].smoothed());
+    }
+    out.print("# HELP plant_moisture_percent Latest reading, calibrated between airValue and waterValue\n# TYPE plant_moisture_percent gauge\n");
+    for (size_t i = 0; i < SENSOR_COUNT; ++i) {
+        out.printf("plant_moisture_percent{sensor=\"%s\"} %.1f\n", SENSORS[i].name,
+                   AdcFilter::percent(SENSORS[i], adcReadings[i].value));
+    }
+    out.print("# HELP plant_adc_noise_counts Spread of one ADC conversion in the latest burst, as a standard deviation\n# TYPE plant_adc_noise_counts gauge\n");
+    for (size_t i = 0; i < SENSOR_COUNT; ++i) {
+        out.printf("plant_adc_noise_counts{sensor=\"%s\"} %.1f\n", SENSORS[i].name, adcReadings[i].noise);
+    }
+    out.print("# HELP plant_hours_to_dry Forecast hours until the dry threshold, -1 if not drying\n# TYPE plant_hours_to_dry gauge\n");
+    for (size_t i = 0; i < SENSOR_COUNT; ++i) {
+        out.printf("plant_hours_to_dry{sensor=\"%s\"} %.1f\n", SENSORS[i].name, alertEngines[i].hoursToDry());
+    }
+    printMetric(out, "plant_alerts_sent_total", "counter", "Telegram messages delivered", alerts.sentCount());
+    printMetric(out, "plant_alerts_failed_total", "counter", "Telegram send attempts that failed", alerts.failedAttempts());
+    printMetric(out, "plant_alerts_dropped_total", "counter", "Alerts dropped by a full batch or a rejected send", alerts.droppedCount());
+    printMetric(out, "plant_alerts_queue_full_total", "counter", "Alerts the full queue turned away, kept and offered again",
+                alerts.queueFullCount());
+    printMetric(out, "plant_alerts_pending_dropped_total", "counter", "Alerts replaced by a newer one while waiting for the queue",
+                pendingAlertsDropped);
+
+    printMetric(out, "plant_heap_free_bytes", "gauge", "Free heap", ESP.getFreeHeap());
+    printMetric(out, "plant_heap_min_free_bytes", "gauge", "Lowest free heap since boot", ESP.getMinFreeHeap());
+    printMetric(out, "plant_heap_largest_free_block_bytes", "gauge", "Largest allocatable heap block, low under fragmentation",
+                ESP.getMaxAllocHeap());
+    printMetric(out, "plant_spiffs_used_bytes", "gauge", "SPIFFS bytes in use", SPIFFS.usedBytes());
+    printMetric(out, "plant_spiffs_total_bytes", "gauge", "SPIFFS partition size", SPIFFS.totalBytes());
+    printMetric(out, "plant_wifi_reconnects_total", "counter", "Wi-Fi reconnect attempts", wifiReconnects);
+    printMetric(out, "plant_wifi_rssi_dbm", "gauge", "Wi-Fi signal strength", WiFi.RSSI());
+    printMetric(out, "plant_http_requests_total", "counter", "HTTP requests answered", server.requestCount());
+    printMetric(out, "plant_http_connections", "gauge", "Open HTTP connections, including idle keep-alive ones",
+                server.connectionCount());
+    printMetric(out, "plant_http_refused_total", "counter", "Connections turned away with 503, all busy",
+                server.refusedCount());
+    printMetric(out, "plant_http_not_modified_total", "counter", "Query responses answered with 304 Not Modified",
+                notModifiedResponses);
+    printMetric(out, "plant_response_cache_hits_total", "counter", "Query responses served from the response cache",
+                responseCache.hits());
+    printMetric(out, "plant_response_cache_misses_total", "counter", "Query responses built from flash",
+                responseCache.misses());
+    printMetric(out, "plant_event_stream_clients", "gauge", "Open /events connections", eventClients);
+    printMetric(out, "plant_events_skipped_total", "counter", "Events not sent to a client whose socket buffer was full",
+                eventsSkipped);
+    printMetric(out, "plant_uptime_seconds", "counter", "Seconds since boot", millis() / 1000);
+    out.end();
+}
+
+// Description: Sets clockSynced once NTP (or a clock kept across a soft reset) gives a
+// plausible time.
+void updateClock() {
+    if (clockSynced) return;
+    uint32_t now = (uint32_t)time(nullptr);
+    if (now < MIN_VALID_EPOCH) return;
+
+    bootEpoch = now - uptimeSeconds();
+    clockSynced = true;
+    logPrintf("Time initialized %lu ms after boot\n", (unsigned long)millis());
+}
+
+// Description: Advances the network bring-up without blocking. The web server and NTP are
+// started on the first Wi-Fi connection; a lost connection is retried every
+// WIFI_RETRY_MILLIS while sampling and logging carry on.
+void updateNetwork() {
+    bool connected = WiFi.status() == WL_CONNECTED;
+    if (connected && !wifiConnected) {
+        Serial.print("Wi-Fi connected, ESP32 IP address: ");
+        Serial.println(WiFi.localIP());
+        if (!serverStarted) {
+            configTime(0, 0, "pool.ntp.org", "time.nist.gov");
+            server.begin();
+            serverStarted = true;
+            logPrintf("Web server started %lu ms after boot\n", (unsigned long)millis());
+        }
+    } else if (!connected && wifiConnected) {
         Serial.println("Wi-Fi lost, reconnecting...");
+        wifiAttemptMillis = millis();
+    } else if (!connected && millis() - wifiAttemptMillis >= WIFI_RETRY_MILLIS) {
         WiFi.disconnect();
         WiFi.reconnect();
-        delay(1000);
-    }
-
-    server.handleClient();
-
-    static unsigned long lastTrimCheck = 0;
-    unsigned long nowMillis = millis();
-    
-    if (nowMillis - lastTrimCheck > TRIM_INTERVAL_MILLIS) {
-        // Only trim if file exceeds max lines
-        for (int i = 1; i <= 2; ++i) {
-            String filename = (i == 1) ? "/data1.csv" : "/data2.csv";
-            File file = SPIFFS.open(filename, FILE_READ);
-            if (!file) continue;
-    
-            int lineCount = 0;
-            while (file.available()) {
-                file.readStringUntil('\n');
-                lineCount++;
-            }
-            file.close();
-    
-            if (lineCount > MAX_LINES_TO_KEEP) {
-                trimLogFile(filename, MAX_LINES_TO_KEEP);
-            }
-        }
-    
-        lastTrimCheck = nowMillis;
+        wifiReconnects++;
+        wifiAttemptMillis = millis();
     }
-    
+    wifiConnected = connected;
 
-    time_t now;
-    time(&now); // Get the current RTC time
+    updateClock();
+}
 
-    // Log data if the logging interval has passed
-    if (now - lastLoggedTime >= LOG_INTERVAL_SECONDS) {
-        lastLoggedTime = now;
+// Description: Refills a sensor's rolling statistics after a reboot from its 10-minute
+// rollups, so /stats covers the last week straight away instead of a day later.
+void seedRollingStats(size_t sensor) {
+    SensorHistory& history = histories[sensor];
+    uint32_t newest = history.newestTimestamp();
+    if (newest == 0) return;
+    uint32_t week = RollingStats::WINDOW_SECONDS[RollingStats::WINDOW_COUNT - 1];
+    history.forEachRollup(0, newest > week ? newest - week : 0, newest, [sensor](const RollupRecord& rec) {
+        rollingStats[sensor].addAggregate(rec.timestamp, rec.count, rec.sum, rec.min, rec.max);
+    });
+    SampleLog& sampleLog = history.raw();
+    sampleLog.forEach(sampleLog.nextSeq() - 1, [sensor](const LogRecord& rec) {
+        rollingStats[sensor].setLatest(rec.timestamp, rec.value);
+    });
+}
 
-        int moisture1 = analogRead(SENSOR_PIN_1); // Read Alfons' sensor
-        int moisture2 = analogRead(SENSOR_PIN_2); // Read Milla's sensor
+// Description: Mounts SPIFFS, opens the histories and starts sampling straight away. Wi-Fi,
+// NTP and the web server come up afterwards from loop(), so nothing here waits on the network.
+void setup() {
+    Serial.begin(115200);
 
-        Serial.println("Moisture check Sensor 1: " + String(moisture1));
-        Serial.println("Moisture check Sensor 2: " + String(moisture2));
+    if (FORCE_SPIFFS_FORMAT) {
+        Serial.println("Forced SPIFFS format requested...");
+        Serial.println(SPIFFS.format() ? "SPIFFS formatted successfully." : "SPIFFS formatting failed!");
+    }
 
-        logMoisture(1, moisture1); // Log the moisture value for Alfons
-        logMoisture(2, moisture2); // Log the moisture value for Milla
+    // Existing history is kept; SPIFFS is only formatted if it cannot be mounted at all,
+    // as on the very first boot
+    if (SPIFFS.begin(true)) {
+        Serial.println("SPIFFS mounted successfully");
+    } else {
+        Serial.println("SPIFFS Mount Failed");
+    }
 
-        // Send a notification if the moisture exceeds the dry threshold
-        if (moisture1 > DRY_THRESHOLD && !notificationSent1) {
-            sendTelegramNotification(1, moisture1);
-            notificationSent1 = true;
-        }
-        if (moisture2 > DRY_THRESHOLD && !notificationSent2) {
-            sendTelegramNotification(2, moisture2);
-            notificationSent2 = true;
+    // Open the per-sensor histories and recover their write positions
+    historyMutex = xSemaphoreCreateMutex();
+    eventsMutex = xSemaphoreCreateMutex();
+    for (size_t i = 0; i < SENSOR_COUNT; ++i) {
+        alertEngines[i].begin(SENSORS[i].dryThreshold);
+        histories[i].raw().setWriteBack(&openBlocks[i], LOG_WRITE_BACK_MAX_AGE);
+        if (!histories[i].begin(SPIFFS, SENSORS[i].basePath, RAW_LOG_BLOCKS, ROLLUP_TIERS)) {
+            logPrintf("Failed to open the log for %s\n", SENSORS[i].name);
         }
+        seedRollingStats(i);
+    }
+
+    // Sampling gets core 1 at a priority above loop(), which only serves HTTP; flash
+    // writes and alerts run on core 0 next to the Wi-Fi stack. The clock may already be
+    // set after a soft reset, in which case the first readings get wall-clock time.
+    updateClock();
+    xTaskCreatePinnedToCore(samplerTask, "sampler", 4096, nullptr, 3, nullptr, 1);
+    xTaskCreatePinnedToCore(storageTask, "storage", 8192, nullptr, 1, nullptr, 0);
+    logPrintf("Sampling started %lu ms after boot\n", (unsigned long)millis());
 
-        // Reset notification flags if moisture is below the threshold
-        if (moisture1 <= DRY_THRESHOLD) {
-            notificationSent1 = false;
+    if (!alerts.begin(TELEGRAM_API_URL, telegramBotToken, telegramChatID)) {
+        Serial.println("Failed to start the alert dispatcher");
+    }
+
+    // Connect in the background; updateNetwork() takes it from here
+    WiFi.begin(ssid, password);
+    wifiAttemptMillis = millis();
+
+    // Register the web server routes; the server itself starts once Wi-Fi is up
+    for (size_t i = 0; i < WEB_ASSET_COUNT; ++i) {
+        const WebAsset& asset = WEB_ASSETS[i];
+        server.on(asset.path, [&asset]() { serveAsset(asset); });
+    }
+    const char* headerKeys[] = {"If-None-Match"};
+    server.collectHeaders(headerKeys, 1);
+    server.on("/config.json", handleConfig);
+    server.on("/series", handleSeries);
+    server.on("/events", handleEvents);
+    server.on("/metrics", handleMetrics);
+    server.on("/export", handleExport);
+    server.on("/stats", handleStats);
+
+    // Streams the log as "timestamp,value" lines, oldest first. Optional parameters:
+    //   since=<epoch>  only records logged after this time
+    //   limit=<N>      only the newest N matching records
+    server.on("/log", []() {
+        int sensor = sensorFromRequest();
+        if (sensor < 0) return;
+        HistoryLock lock;
+        SampleLog& sampleLog = histories[sensor].raw();
+        uint32_t generation = histories[sensor].generation();
+        if (notModified(historyETag(sensor))) return;
+        RequestKey key = requestKey("/log", {"sensor", "since", "limit"});
+        if (serveCached(key, generation, "text/plain")) return;
+
+        uint32_t fromSeq = sampleLog.firstSeq();
+        if (server.hasArg("since")) {
+            uint32_t since = server.argUnsigned("since", 0);
+            fromSeq = sampleLog.lowerBound(since + 1);
         }
-        if (moisture2 <= DRY_THRESHOLD) {
-            notificationSent2 = false;
+        if (server.hasArg("limit")) {
+            uint32_t limit = server.argUnsigned("limit", 0);
+            if (sampleLog.nextSeq() - fromSeq > limit) {
+                fromSeq = sampleLog.nextSeq() - limit;
+            }
         }
+
+        ResponseStream out(server);
+        out.begin(200, "text/plain");
+        ResponseCache::Slot* slot = recordResponse(out, key, generation);
+        sampleLog.forEach(fromSeq, [&out](const LogRecord& rec) {
+            out.printf("%lu,%d\n", (unsigned long)rec.timestamp, rec.value);
+        });
+        out.end();
+        responseCache.commit(slot, out.recorded(), out.recordedAll());
+    });
+}
+
+// Description: Main loop that keeps the network up and serves HTTP clients. Sampling and
+// logging run in their own tasks.
+void loop() {
+    ScopedLatency latency(loopLatency);
+
+    updateNetwork();
+    if (serverStarted) {
+        ScopedLatency handleLatency(handleClientLatency);
+        server.handleClient(HTTP_IDLE_WAIT_MILLIS);
     }
+
+    EventsLock lock;
+    events.loop();
 }
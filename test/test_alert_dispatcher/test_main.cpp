@@ -0,0 +1,301 @@
+// AlertDispatcher against a local stand-in for the Telegram Bot API on an http:// URL:
+// coalescing, message bodies that stay valid JSON, splitting a rejected message, backoff
+// on 5xx and 429, and connection reuse. Run with: pio test -e test
+
+#include <Arduino.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unity.h>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "AlertDispatcher.h"
+
+// Description: Answers each request with the next queued status code, 200 once the queue
+// is empty, and records when each request came in and over how many connections.
+class TelegramStub {
+public:
+    struct Request {
+        unsigned long millis;
+        std::string body;
+    };
+
+    bool start() {
+        listenFd_ = socket(AF_INET, SOCK_STREAM, 0);
+        struct sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t len = sizeof(addr);
+        if (bind(listenFd_, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(listenFd_, 4) != 0 ||
+            getsockname(listenFd_, (struct sockaddr*)&addr, &len) != 0) {
+            return false;
+        }
+        snprintf(url_, sizeof(url_), "http://127.0.0.1:%u", (unsigned)ntohs(addr.sin_port));
+        std::thread([this]() { serve(); }).detach();
+        return true;
+    }
+
+    void respondWith(int code) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        codes_.push_back(code);
+    }
+
+    const char* url() const { return url_; }
+
+    size_t requestCount() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return requests_.size();
+    }
+    Request request(size_t i) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return requests_[i];
+    }
+    int connections() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return connections_;
+    }
+
+private:
+    void serve() {
+        for (;;) {
+            int fd = accept(listenFd_, nullptr, nullptr);
+            if (fd < 0) continue;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                connections_++;
+            }
+            std::thread([this, fd]() { handle(fd); }).detach();
+        }
+    }
+
+    void handle(int fd) {
+        std::string in;
+        char buf[1024];
+        for (;;) {
+            size_t headerEnd;
+            while ((headerEnd = in.find("\r\n\r\n")) == std::string::npos) {
+                ssize_t n = recv(fd, buf, sizeof(buf), 0);
+                if (n <= 0) {
+                    close(fd);
+                    return;
+                }
+                in.append(buf, n);
+            }
+            size_t length = 0;
+            size_t at = in.find("Content-Length:");
+            if (at != std::string::npos && at < headerEnd) length = strtoul(in.c_str() + at + 15, nullptr, 10);
+            while (in.size() < headerEnd + 4 + length) {
+                ssize_t n = recv(fd, buf, sizeof(buf), 0);
+                if (n <= 0) {
+                    close(fd);
+                    return;
+                }
+                in.append(buf, n);
+            }
+
+            int code = 200;
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                requests_.push_back({millis(), in.substr(headerEnd + 4, length)});
+                if (!codes_.empty()) {
+                    code = codes_.front();
+                    codes_.pop_front();
+                }
+            }
+            in.erase(0, headerEnd + 4 + length);
+
+            char response[128];
+            int n = snprintf(response, sizeof(response), "HTTP/1.1 %d Stub\r\nContent-Type: application/json\r\n"
+                             "Content-Length: 2\r\n\r\n{}", code);
+            send(fd, response, n, MSG_NOSIGNAL);
+        }
+    }
+
+    int listenFd_ = -1;
+    char url_[32] = {};
+    std::mutex mutex_;
+    std::deque<int> codes_;
+    std::vector<Request> requests_;
+    int connections_ = 0;
+};
+
+// The dispatcher task runs for the rest of the process, so each test gets its own
+// dispatcher and stub, never destroyed
+static TelegramStub* stub;
+static AlertDispatcher* alerts;
+
+static const char* const BASIL = "Basil";
+static const char* const FERN = "Fern";
+static const char* const MINT = "Mint";
+
+// Names with characters JSON must escape, longer than a message line allows
+static const char* const ODD_NAMES[AlertDispatcher::MAX_BATCH] = {
+    "The \"big\" fig by the window, the one that came from grandma's kitchen in 2003",
+    "Back\\slash\\cactus\\Back\\slash\\cactus\\Back\\slash\\cactus\\Back\\slash\\cactus",
+    "Tab\tand\nnewline",
+    "\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"\"",
+    "Monstera deliciosa Thai Constellation, repotted last spring, north-facing shelf",
+    "Pilea",
+    "Calathea \"prayer plant\" \\ living room \\ left of the sofa \\ do not overwater",
+    "Aloe",
+};
+
+// Description: Whether `body` is exactly {"chat_id":"...","text":"..."} with valid string escapes.
+static bool isMessageJson(const std::string& body) {
+    size_t i = 0;
+    auto expect = [&](const char* text) {
+        if (body.compare(i, strlen(text), text) != 0) return false;
+        i += strlen(text);
+        return true;
+    };
+    auto string = [&]() {
+        while (i < body.size() && body[i] != '"') {
+            if ((unsigned char)body[i] < 0x20) return false;
+            if (body[i] == '\\') {
+                if (++i >= body.size()) return false;
+                if (body[i] == 'u') {
+                    if (i + 4 >= body.size()) return false;
+                    for (int k = 1; k <= 4; ++k) {
+                        if (!isxdigit((unsigned char)body[i + k])) return false;
+                    }
+                    i += 4;
+                } else if (!strchr("\"\\/bfnrt", body[i])) {
+                    return false;
+                }
+            }
+            ++i;
+        }
+        return i < body.size();
+    };
+    return expect("{\"chat_id\":\"") && string() && expect("\",\"text\":\"") && string() && expect("\"}") &&
+           i == body.size();
+}
+
+template <typename Condition>
+static bool waitFor(uint32_t timeoutMillis, Condition condition) {
+    unsigned long start = millis();
+    while (!condition()) {
+        if (millis() - start > timeoutMillis) return false;
+        delay(10);
+    }
+    return true;
+}
+
+void setUp() {
+    Serial.quiet = true;
+    stub = new TelegramStub();
+    TEST_ASSERT_TRUE(stub->start());
+    alerts = new AlertDispatcher();
+    TEST_ASSERT_TRUE(alerts->begin(stub->url(), "TOKEN", "42"));
+}
+
+void tearDown() {}
+
+void test_alerts_that_fire_together_are_one_message() {
+    alerts->enqueue(BASIL, 2100);
+    alerts->enqueue(FERN, 2050);
+    alerts->enqueue(MINT, 1900, 5.0f);
+    alerts->enqueue(BASIL, 2150);   // Replaces Basil's pending reading
+
+    TEST_ASSERT_TRUE(waitFor(5000, []() { return stub->requestCount() >= 1; }));
+    delay(AlertDispatcher::COALESCE_MILLIS + 500);
+    TEST_ASSERT_EQUAL(1, stub->requestCount());
+    TEST_ASSERT_EQUAL_UINT32(1, alerts->sentCount());
+
+    std::string body = stub->request(0).body;
+    TEST_ASSERT_TRUE(body.find("\"chat_id\":\"42\"") != std::string::npos);
+    TEST_ASSERT_TRUE(body.find("3 plants need water soon!") != std::string::npos);
+    TEST_ASSERT_TRUE(body.find("Basil is too dry! Moisture: 2150") != std::string::npos);
+    TEST_ASSERT_TRUE(body.find("Fern is too dry! Moisture: 2050") != std::string::npos);
+    TEST_ASSERT_TRUE(body.find("Mint will be dry in about 5 hours") != std::string::npos);
+}
+
+void test_full_batch_with_odd_names_is_valid_json() {
+    for (size_t i = 0; i < AlertDispatcher::MAX_BATCH; ++i) alerts->enqueue(ODD_NAMES[i], 2100 + (int)i);
+
+    TEST_ASSERT_TRUE(waitFor(5000, []() { return alerts->sentCount() >= 1; }));
+    delay(AlertDispatcher::COALESCE_MILLIS + 500);
+    TEST_ASSERT_EQUAL(1, stub->requestCount());
+    std::string body = stub->request(0).body;
+    TEST_ASSERT_TRUE(isMessageJson(body));
+    TEST_ASSERT_TRUE(body.find("8 plants need water soon!") != std::string::npos);
+    TEST_ASSERT_TRUE(body.find("Aloe is too dry! Moisture: 2107") != std::string::npos);
+    TEST_ASSERT_TRUE(body.find("The \\\"big\\\" fig") != std::string::npos);
+}
+
+void test_rejected_message_is_split_not_dropped() {
+    stub->respondWith(400);   // The whole message
+    stub->respondWith(200);   // Basil alone
+    stub->respondWith(400);   // Fern alone: rejected for good
+    alerts->enqueue(BASIL, 2100);
+    alerts->enqueue(FERN, 2050);
+    alerts->enqueue(MINT, 2000);
+
+    TEST_ASSERT_TRUE(waitFor(5000, []() { return alerts->sentCount() == 2; }));
+    TEST_ASSERT_EQUAL(4, stub->requestCount());
+    TEST_ASSERT_TRUE(stub->request(0).body.find("3 plants need water soon!") != std::string::npos);
+    TEST_ASSERT_TRUE(stub->request(1).body.find("Basil is too dry!") != std::string::npos);
+    TEST_ASSERT_TRUE(stub->request(2).body.find("Fern is too dry!") != std::string::npos);
+    TEST_ASSERT_TRUE(stub->request(3).body.find("Mint is too dry!") != std::string::npos);
+    TEST_ASSERT_EQUAL_UINT32(1, alerts->droppedCount());
+    TEST_ASSERT_EQUAL_UINT32(0, alerts->failedAttempts());
+
+    // The next message batches again
+    alerts->enqueue(BASIL, 2100);
+    alerts->enqueue(FERN, 2050);
+    TEST_ASSERT_TRUE(waitFor(5000, []() { return alerts->sentCount() == 3; }));
+    TEST_ASSERT_TRUE(stub->request(4).body.find("2 plants need water soon!") != std::string::npos);
+}
+
+void test_turned_away_alert_is_not_counted_as_dropped() {
+    AlertDispatcher idle;   // Never started, so its queue takes nothing
+    TEST_ASSERT_FALSE(idle.enqueue(BASIL, 2100));
+    TEST_ASSERT_FALSE(idle.enqueue(BASIL, 2100));
+    TEST_ASSERT_EQUAL_UINT32(2, idle.queueFullCount());
+    TEST_ASSERT_EQUAL_UINT32(0, idle.droppedCount());
+}
+
+void test_retry_delay_grows_on_5xx_and_429() {
+    stub->respondWith(503);
+    stub->respondWith(429);
+    alerts->enqueue(BASIL, 2100);
+
+    uint32_t longest = AlertDispatcher::INITIAL_BACKOFF_MILLIS * 3 + AlertDispatcher::COALESCE_MILLIS + 5000;
+    TEST_ASSERT_TRUE(waitFor(longest, []() { return stub->requestCount() >= 3; }));
+    unsigned long first = stub->request(1).millis - stub->request(0).millis;
+    unsigned long second = stub->request(2).millis - stub->request(1).millis;
+    TEST_ASSERT_GREATER_OR_EQUAL(AlertDispatcher::INITIAL_BACKOFF_MILLIS - 50, first);
+    TEST_ASSERT_GREATER_OR_EQUAL(2 * AlertDispatcher::INITIAL_BACKOFF_MILLIS - 50, second);
+    TEST_ASSERT_GREATER_THAN(first, second);
+
+    TEST_ASSERT_TRUE(waitFor(1000, []() { return alerts->sentCount() == 1; }));
+    TEST_ASSERT_EQUAL_UINT32(2, alerts->failedAttempts());
+    TEST_ASSERT_EQUAL_UINT32(0, alerts->droppedCount());
+    TEST_ASSERT_EQUAL_STRING(stub->request(0).body.c_str(), stub->request(2).body.c_str());
+}
+
+void test_connection_is_reused_between_messages() {
+    alerts->enqueue(BASIL, 2100);
+    TEST_ASSERT_TRUE(waitFor(5000, []() { return alerts->sentCount() == 1; }));
+    alerts->enqueue(FERN, 2050);
+    TEST_ASSERT_TRUE(waitFor(5000, []() { return alerts->sentCount() == 2; }));
+    alerts->enqueue(MINT, 2000);
+    TEST_ASSERT_TRUE(waitFor(5000, []() { return alerts->sentCount() == 3; }));
+
+    TEST_ASSERT_EQUAL(3, stub->requestCount());
+    TEST_ASSERT_EQUAL(1, stub->connections());
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_alerts_that_fire_together_are_one_message);
+    RUN_TEST(test_full_batch_with_odd_names_is_valid_json);
+    RUN_TEST(test_rejected_message_is_split_not_dropped);
+    RUN_TEST(test_turned_away_alert_is_not_counted_as_dropped);
+    RUN_TEST(test_retry_delay_grows_on_5xx_and_429);
+    RUN_TEST(test_connection_is_reused_between_messages);
+    return UNITY_END();
+}
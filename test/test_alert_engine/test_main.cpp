@@ -0,0 +1,103 @@
+// AlertEngine: a single low glitch while the plant is dry must not count as a watering,
+// while a real watering recovers the alert and starts a new trend. After a start or a
+// long gap, one high reading must not raise a dry alert on its own.
+// Run with: pio test -e test
+
+#include <unity.h>
+#include "AlertEngine.h"
+
+static const uint32_t FIRST_TIMESTAMP = 1700000000;
+static const uint32_t INTERVAL = 600;
+static const int16_t DRY_THRESHOLD = 2000;
+
+void setUp() {}
+void tearDown() {}
+
+// Description: Feeds `count` readings of `value` and returns how many of them caused `event`.
+static int feed(AlertEngine& engine, uint32_t& timestamp, int16_t value, int count, AlertEvent event) {
+    int seen = 0;
+    for (int i = 0; i < count; ++i, timestamp += INTERVAL) {
+        if (engine.update(timestamp, value) == event) seen++;
+    }
+    return seen;
+}
+
+static void driveDry(AlertEngine& engine, uint32_t& timestamp) {
+    engine.begin(DRY_THRESHOLD);
+    feed(engine, timestamp, 1500, 12, ALERT_DRY);
+    TEST_ASSERT_EQUAL_INT(1, feed(engine, timestamp, 2100, 24, ALERT_DRY));
+}
+
+void test_single_low_glitch_keeps_dry_alert() {
+    AlertEngine engine;
+    uint32_t timestamp = FIRST_TIMESTAMP;
+    driveDry(engine, timestamp);
+    float before = engine.smoothed();
+
+    // One reading far below the EWMA, as from a loose contact, then dry again
+    TEST_ASSERT_EQUAL_INT(ALERT_NONE, engine.update(timestamp, 2100 - 3 * AlertEngine::WATERING_DROP));
+    timestamp += INTERVAL;
+    TEST_ASSERT_EQUAL_FLOAT(before, engine.smoothed());
+    TEST_ASSERT_EQUAL_INT(0, feed(engine, timestamp, 2100, 12, ALERT_RECOVERED));
+    TEST_ASSERT_EQUAL_INT(0, feed(engine, timestamp, 2100, 12, ALERT_DRY));
+}
+
+void test_glitches_between_dry_readings_never_rearm() {
+    AlertEngine engine;
+    uint32_t timestamp = FIRST_TIMESTAMP;
+    driveDry(engine, timestamp);
+
+    int recovered = 0, dry = 0;
+    for (int i = 0; i < 100; ++i, timestamp += INTERVAL) {
+        int16_t value = i % 5 == 0 ? 1700 : 2100;
+        AlertEvent event = engine.update(timestamp, value);
+        if (event == ALERT_RECOVERED) recovered++;
+        if (event == ALERT_DRY) dry++;
+    }
+    TEST_ASSERT_EQUAL_INT(0, recovered);
+    TEST_ASSERT_EQUAL_INT(0, dry);
+}
+
+void test_watering_recovers_and_rearms() {
+    AlertEngine engine;
+    uint32_t timestamp = FIRST_TIMESTAMP;
+    driveDry(engine, timestamp);
+
+    TEST_ASSERT_EQUAL_INT(1, feed(engine, timestamp, 1400, AlertEngine::WATERING_SAMPLES, ALERT_RECOVERED));
+    TEST_ASSERT_EQUAL_FLOAT(1400, engine.smoothed());
+    TEST_ASSERT_EQUAL_INT(0, feed(engine, timestamp, 1400, 12, ALERT_RECOVERED));
+
+    // Drying out again fires a new alert
+    TEST_ASSERT_EQUAL_INT(1, feed(engine, timestamp, 2100, 24, ALERT_DRY));
+}
+
+void test_first_high_reading_does_not_fire() {
+    AlertEngine engine;
+    uint32_t timestamp = FIRST_TIMESTAMP;
+    engine.begin(DRY_THRESHOLD);
+    TEST_ASSERT_EQUAL_INT(0, feed(engine, timestamp, 2600, 1, ALERT_DRY));
+    TEST_ASSERT_EQUAL_INT(0, feed(engine, timestamp, 1500, 24, ALERT_DRY));
+
+    // The same after a gap long enough to start over
+    timestamp += AlertEngine::MAX_GAP_SECONDS + INTERVAL;
+    TEST_ASSERT_EQUAL_INT(0, feed(engine, timestamp, 2600, 1, ALERT_DRY));
+    TEST_ASSERT_EQUAL_INT(0, feed(engine, timestamp, 1500, 24, ALERT_DRY));
+}
+
+void test_dry_start_fires_after_min_samples() {
+    AlertEngine engine;
+    uint32_t timestamp = FIRST_TIMESTAMP;
+    engine.begin(DRY_THRESHOLD);
+    TEST_ASSERT_EQUAL_INT(0, feed(engine, timestamp, 2100, AlertEngine::MIN_SAMPLES - 1, ALERT_DRY));
+    TEST_ASSERT_EQUAL_INT(ALERT_DRY, engine.update(timestamp, 2100));
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_single_low_glitch_keeps_dry_alert);
+    RUN_TEST(test_glitches_between_dry_readings_never_rearm);
+    RUN_TEST(test_watering_recovers_and_rearms);
+    RUN_TEST(test_first_high_reading_does_not_fire);
+    RUN_TEST(test_dry_start_fires_after_min_samples);
+    return UNITY_END();
+}
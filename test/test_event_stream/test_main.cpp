@@ -0,0 +1,87 @@
+// EventStream writes never wait: a subscriber that stopped reading has events skipped
+// while the others keep receiving every event.
+// Run with: pio test -e test
+
+#include <Arduino.h>
+#include <unity.h>
+#include <fcntl.h>
+#include <string>
+#include <sys/socket.h>
+#include "EventStream.h"
+
+// Description: A subscriber connection as HttpServer::client() hands it over: the server
+// end is non-blocking, the browser end is returned in `peer`.
+static WiFiClient subscriber(int* peer) {
+    int fds[2];
+    TEST_ASSERT_EQUAL(0, socketpair(AF_UNIX, SOCK_STREAM, 0, fds));
+    fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL, 0) | O_NONBLOCK);
+    *peer = fds[1];
+    return WiFiClient(fds[0]);
+}
+
+static std::string drain(int fd) {
+    std::string text;
+    char buf[4096];
+    ssize_t n;
+    while ((n = recv(fd, buf, sizeof(buf), MSG_DONTWAIT)) > 0) text.append(buf, n);
+    return text;
+}
+
+void setUp() {
+    Serial.quiet = true;
+}
+
+void tearDown() {}
+
+void test_snapshot_follows_headers() {
+    EventStream events;
+    int peer;
+    WiFiClient client = subscriber(&peer);
+    FixedFormat<256> snapshot;
+    TEST_ASSERT_TRUE(EventStream::format(snapshot, "sample", "{\"v\":1}"));
+    TEST_ASSERT_TRUE(events.subscribe(client, snapshot.c_str(), snapshot.length()));
+    events.broadcast("sample", "{\"v\":2}");
+
+    std::string text = drain(peer);
+    size_t first = text.find("data: {\"v\":1}\n\n");
+    TEST_ASSERT_TRUE(text.compare(0, 15, "HTTP/1.1 200 OK") == 0);
+    TEST_ASSERT_TRUE(first != std::string::npos);
+    TEST_ASSERT_TRUE(text.find("data: {\"v\":2}\n\n") > first);
+    TEST_ASSERT_EQUAL(1, events.clientCount());
+    close(peer);
+}
+
+void test_stalled_subscriber_does_not_block() {
+    EventStream events;
+    int stalledPeer, activePeer;
+    WiFiClient stalled = subscriber(&stalledPeer);
+    WiFiClient active = subscriber(&activePeer);
+    TEST_ASSERT_TRUE(events.subscribe(stalled, "", 0));
+    TEST_ASSERT_TRUE(events.subscribe(active, "", 0));
+
+    // Far more than the socket buffers hold; the stalled peer never reads
+    char data[64];
+    size_t received = 0;
+    unsigned long start = millis();
+    for (int i = 0; i < 20000; ++i) {
+        snprintf(data, sizeof(data), "{\"sensor\":1,\"t\":%d,\"v\":2000}", i);
+        events.broadcast("sample", data);
+        std::string text = drain(activePeer);
+        for (size_t at = text.find("event: sample"); at != std::string::npos; at = text.find("event: sample", at + 1)) {
+            received++;
+        }
+    }
+    TEST_ASSERT_TRUE(millis() - start < 2000);
+    TEST_ASSERT_EQUAL(20000, received);
+    TEST_ASSERT_TRUE(events.skippedCount() > 0);
+    TEST_ASSERT_EQUAL(2, events.clientCount());
+    close(stalledPeer);
+    close(activePeer);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_snapshot_follows_headers);
+    RUN_TEST(test_stalled_subscriber_does_not_block);
+    return UNITY_END();
+}
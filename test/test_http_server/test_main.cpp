@@ -0,0 +1,94 @@
+// HttpServer connection limits: idle keep-alive connections make way for newcomers, and
+// when every connection is busy a newcomer is refused with 503 instead of holding a
+// socket. Run with: pio test -e test
+
+#include <Arduino.h>
+#include <unity.h>
+#include <atomic>
+#include <string>
+#include <thread>
+#include "BenchClient.h"
+#include "HttpServer.h"
+
+static HttpServer* server;
+static std::atomic<bool> stop(false);
+static std::thread* serverThread;
+
+// Description: A raw connection that sends only the start of a request, keeping its
+// server connection busy.
+static int openBusy(uint16_t port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    if (connect(fd, (sockaddr*)&addr, sizeof(addr)) < 0) return -1;
+    const char partial[] = "GET /hello HTTP/1.1\r\nHost: test\r\n";
+    send(fd, partial, sizeof(partial) - 1, MSG_NOSIGNAL);
+    return fd;
+}
+
+void setUp() {
+    Serial.quiet = true;
+    server = new HttpServer(0);
+    server->on("/hello", []() { server->send(200, "text/plain", "hello"); });
+    TEST_ASSERT_TRUE(server->begin(0));
+    stop = false;
+    serverThread = new std::thread([]() {
+        while (!stop) server->handleClient(10);
+    });
+}
+
+void tearDown() {
+    stop = true;
+    serverThread->join();
+    delete serverThread;
+}
+
+void test_idle_connection_makes_way() {
+    BenchClient idle[HttpServer::MAX_CONNECTIONS];
+    int status = 0;
+    for (BenchClient& client : idle) {
+        TEST_ASSERT_TRUE(client.connect(server->port()));
+        TEST_ASSERT_EQUAL(5, client.get("/hello", &status));
+        TEST_ASSERT_EQUAL(200, status);
+    }
+
+    BenchClient newcomer;
+    TEST_ASSERT_TRUE(newcomer.connect(server->port()));
+    TEST_ASSERT_EQUAL(5, newcomer.get("/hello", &status));
+    TEST_ASSERT_EQUAL(200, status);
+    TEST_ASSERT_EQUAL_UINT32(0, server->refusedCount());
+}
+
+void test_newcomer_is_refused_while_all_are_busy() {
+    int busy[HttpServer::MAX_CONNECTIONS];
+    for (int& fd : busy) TEST_ASSERT_TRUE((fd = openBusy(server->port())) >= 0);
+    delay(100);
+    TEST_ASSERT_EQUAL_size_t(HttpServer::MAX_CONNECTIONS, server->connectionCount());
+
+    BenchClient newcomer;
+    TEST_ASSERT_TRUE(newcomer.connect(server->port()));
+    int status = 0;
+    TEST_ASSERT_EQUAL(0, newcomer.get("/hello", &status));
+    TEST_ASSERT_EQUAL(503, status);
+    TEST_ASSERT_EQUAL_UINT32(1, server->refusedCount());
+
+    // Busy connections are still served once their request is complete
+    for (int fd : busy) {
+        send(fd, "\r\n", 2, MSG_NOSIGNAL);
+        char buf[256];
+        int n = recv(fd, buf, sizeof(buf) - 1, 0);
+        TEST_ASSERT_GREATER_THAN(0, n);
+        buf[n] = '\0';
+        TEST_ASSERT_TRUE(strstr(buf, "HTTP/1.1 200") == buf);
+        close(fd);
+    }
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_idle_connection_makes_way);
+    RUN_TEST(test_newcomer_is_refused_while_all_are_busy);
+    return UNITY_END();
+}
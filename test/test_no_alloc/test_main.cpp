@@ -0,0 +1,176 @@
+// The paths that run on every sample or request must not touch the heap: weeks of
+// uptime would fragment it and leave no room for the TLS handshake of an alert. This
+// fails if logPrintf(), a sampling round or any request in the dashboard mix allocates
+// once warmed up. The replay reports the same counts as figures; here they are
+// assertions. Run with: pio test -e test
+
+#include <Arduino.h>
+#include <SPIFFS.h>
+#include <freertos/task.h>
+#include <stdlib.h>
+#include <unity.h>
+#include <atomic>
+#include <new>
+#include <string>
+#include <thread>
+#include "BenchClient.h"
+#include "FixedFormat.h"
+#include "HttpServer.h"
+
+void setup();
+void loop();
+void sampleSensors(uint32_t timestamp, bool wallClock);
+bool processSamples();
+extern HttpServer server;
+
+// Description: Allocation counting, only on threads that ask for it.
+static thread_local bool countAllocations = false;
+static std::atomic<uint64_t> allocations(0);
+
+void* operator new(size_t size) {
+    if (countAllocations) allocations++;
+    void* p = malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+void* operator new[](size_t size) { return operator new(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    if (countAllocations) allocations++;
+    return malloc(size ? size : 1);
+}
+void* operator new[](size_t size, const std::nothrow_t& tag) noexcept { return operator new(size, tag); }
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { free(p); }
+
+static const uint32_t FIRST_TIMESTAMP = 1700000000;
+static const uint32_t INTERVAL = 600;
+static const uint32_t ROUNDS_PER_DAY = 86400 / INTERVAL;
+static uint32_t nextRound = 0;
+
+// Requests with arguments and conditional headers, as the dashboard and scrapers send them
+static const char* const REQUESTS[] = {
+    "/",
+    "/config.json",
+    "/log?sensor=1&limit=100",
+    "/log?sensor=2&since=1700040000",
+    "/series?sensor=1",
+    "/series?sensor=2&from=1700010000&to=1700050000&points=50&mode=lttb",
+    "/export?sensor=1&after=10",
+    "/stats",
+    "/metrics",
+};
+
+static void runRounds(uint32_t count) {
+    for (uint32_t end = nextRound + count; nextRound < end; ++nextRound) {
+        sampleSensors(FIRST_TIMESTAMP + nextRound * INTERVAL, true);
+        processSamples();
+    }
+}
+
+void setUp() {}
+void tearDown() {}
+
+// Description: Captures what `fn` writes to Serial, through stdout.
+template <typename Fn>
+static std::string captureSerial(Fn fn) {
+    fflush(stdout);
+    FILE* capture = tmpfile();
+    int saved = dup(fileno(stdout));
+    dup2(fileno(capture), fileno(stdout));
+    Serial.quiet = false;
+    fn();
+    fflush(stdout);
+    Serial.quiet = true;
+    dup2(saved, fileno(stdout));
+    close(saved);
+
+    std::string out;
+    rewind(capture);
+    int c;
+    while ((c = fgetc(capture)) != EOF) out += (char)c;
+    fclose(capture);
+    return out;
+}
+
+void test_log_printf_does_not_allocate() {
+    char name[LOG_LINE_SIZE * 2];
+    memset(name, 'x', sizeof(name) - 1);
+    name[sizeof(name) - 1] = '\0';
+
+    std::string out = captureSerial([&name]() {
+        allocations = 0;
+        countAllocations = true;
+        logPrintf("Short line %d\n", 42);
+        logPrintf("A line longer than the 64 bytes the core formats on the stack: %s %d\n", "padding", 123456);
+        logPrintf("A line longer than LOG_LINE_SIZE: %s\n", name);
+        countAllocations = false;
+    });
+    TEST_ASSERT_EQUAL(0, allocations.load());
+
+    // A line cut short still ends the line, so the next one starts on its own
+    TEST_ASSERT_TRUE(out.find("Short line 42\n") == 0);
+    TEST_ASSERT_TRUE(out.find("123456\n") != std::string::npos);
+    TEST_ASSERT_EQUAL('\n', out[out.size() - 1]);
+    TEST_ASSERT_TRUE(out.find("...\n") == out.size() - 4);
+}
+
+void test_sampling_rounds_do_not_allocate() {
+    runRounds(ROUNDS_PER_DAY);   // Opens files and fills the first blocks
+    allocations = 0;
+    countAllocations = true;
+    runRounds(ROUNDS_PER_DAY);
+    countAllocations = false;
+    TEST_ASSERT_EQUAL(0, allocations.load());
+}
+
+void test_requests_do_not_allocate() {
+    runRounds(ROUNDS_PER_DAY);
+    std::atomic<bool> counting(false);
+    std::atomic<bool> done(false);
+    std::thread serverThread([&]() {
+        while (!done) {
+            countAllocations = counting;
+            loop();
+        }
+        countAllocations = false;
+    });
+
+    BenchClient client;
+    TEST_ASSERT_TRUE(client.connect(server.port()));
+    for (int pass = 0; pass < 3; ++pass) {
+        if (pass == 1) {
+            allocations = 0;
+            counting = true;
+        }
+        for (const char* target : REQUESTS) {
+            int status = 0;
+            TEST_ASSERT_TRUE(client.get(target, &status) >= 0);
+            TEST_ASSERT_EQUAL(200, status);
+            std::string etag = client.etag();
+            if (etag.empty()) continue;
+            TEST_ASSERT_TRUE(client.get(target, &status, etag) >= 0);
+            TEST_ASSERT_EQUAL(304, status);
+        }
+        runRounds(1);   // New data between passes, so responses change
+    }
+    counting = false;
+    done = true;
+    serverThread.join();
+    client.close();
+    TEST_ASSERT_EQUAL(0, allocations.load());
+}
+
+int main(int argc, char** argv) {
+    Serial.quiet = true;
+    hostTasksEnabled = false;   // Rounds and requests are driven from here
+    setup();
+    if (!server.begin(0)) return 1;
+
+    UNITY_BEGIN();
+    RUN_TEST(test_log_printf_does_not_allocate);
+    RUN_TEST(test_sampling_rounds_do_not_allocate);
+    RUN_TEST(test_requests_do_not_allocate);
+    return UNITY_END();
+}
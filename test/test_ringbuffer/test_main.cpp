@@ -0,0 +1,211 @@
+// RingBuffer on the in-memory filesystem stand-in: wraparound, recovery from torn record
+// and header writes, and time lookups after a reboot. Run with: pio test -e test
+
+#include <Arduino.h>
+#include <FS.h>
+#include <unity.h>
+#include "RingBuffer.h"
+
+struct TestRecord {
+    uint32_t seq;
+    uint32_t timestamp;
+    int16_t value;
+    uint16_t crc;
+};
+
+static const char* const PATH = "/ring";
+static const size_t HEADER_BYTES = 2 * sizeof(RingBufferHeader);
+static fs::FS flash;
+
+void setUp() {
+    Serial.quiet = true;
+    flash.clear();
+}
+
+void tearDown() {}
+
+static void appendRecords(RingBuffer<TestRecord>& ring, uint32_t count, uint32_t firstTimestamp = 1000) {
+    for (uint32_t i = 0; i < count; ++i) {
+        TestRecord rec = {};
+        rec.timestamp = firstTimestamp + ring.nextSeq() * 10;
+        rec.value = (int16_t)ring.nextSeq();
+        TEST_ASSERT_TRUE(ring.append(rec));
+    }
+}
+
+// Flips one byte of the file, as a write cut short by a power loss leaves it
+static void corrupt(size_t offset) {
+    std::vector<uint8_t>* bytes = flash.raw(PATH);
+    TEST_ASSERT_NOT_NULL(bytes);
+    (*bytes)[offset] ^= 0xFF;
+}
+
+static size_t slotOffset(uint32_t slot) { return HEADER_BYTES + slot * sizeof(TestRecord); }
+
+static uint32_t headerGeneration(int slot) {
+    RingBufferHeader header;
+    memcpy(&header, flash.raw(PATH)->data() + slot * sizeof(RingBufferHeader), sizeof(header));
+    return header.generation;
+}
+
+// Sequence number of the first record a reader starting at `seq` gets
+static uint32_t firstReadable(RingBuffer<TestRecord>& ring, uint32_t seq) {
+    uint32_t found = UINT32_MAX;
+    ring.forEach(seq, [&](const TestRecord& r) {
+        if (found == UINT32_MAX) found = r.seq;
+    });
+    return found;
+}
+
+void test_wraps_past_capacity() {
+    RingBuffer<TestRecord> ring;
+    TEST_ASSERT_TRUE(ring.begin(flash, PATH, 10, 4));
+    appendRecords(ring, 25);
+
+    TEST_ASSERT_EQUAL_UINT32(25, ring.nextSeq());
+    TEST_ASSERT_EQUAL_UINT32(15, ring.firstSeq());
+    TEST_ASSERT_EQUAL_UINT32(10, ring.size());
+
+    TestRecord rec;
+    TEST_ASSERT_FALSE(ring.read(14, rec));
+    TEST_ASSERT_TRUE(ring.read(24, rec));
+    TEST_ASSERT_EQUAL_INT16(24, rec.value);
+
+    uint32_t expected = 15;
+    ring.forEach([&](const TestRecord& r) {
+        TEST_ASSERT_EQUAL_UINT32(expected, r.seq);
+        TEST_ASSERT_EQUAL_UINT32(1000 + expected * 10, r.timestamp);
+        expected++;
+    });
+    TEST_ASSERT_EQUAL_UINT32(25, expected);
+
+    // The file never grows: appends overwrite slots in place
+    TEST_ASSERT_EQUAL(slotOffset(10), flash.raw(PATH)->size());
+}
+
+void test_rolls_forward_past_last_checkpoint() {
+    {
+        RingBuffer<TestRecord> ring;
+        TEST_ASSERT_TRUE(ring.begin(flash, PATH, 10, 4));
+        appendRecords(ring, 7);   // Checkpointed at 4, then three more
+    }
+    RingBuffer<TestRecord> ring;
+    TEST_ASSERT_TRUE(ring.begin(flash, PATH, 10, 4));
+    TEST_ASSERT_EQUAL_UINT32(7, ring.nextSeq());
+
+    // After a wrap the roll-forward stops at the first slot holding an older record
+    appendRecords(ring, 8);
+    RingBuffer<TestRecord> reopened;
+    TEST_ASSERT_TRUE(reopened.begin(flash, PATH, 10, 4));
+    TEST_ASSERT_EQUAL_UINT32(15, reopened.nextSeq());
+    TEST_ASSERT_EQUAL_UINT32(5, reopened.firstSeq());
+}
+
+void test_torn_last_record_is_dropped() {
+    {
+        RingBuffer<TestRecord> ring;
+        TEST_ASSERT_TRUE(ring.begin(flash, PATH, 10, 100));
+        appendRecords(ring, 5);
+    }
+    corrupt(slotOffset(4) + offsetof(TestRecord, value));   // CRC no longer matches
+
+    RingBuffer<TestRecord> ring;
+    TEST_ASSERT_TRUE(ring.begin(flash, PATH, 10, 100));
+    TEST_ASSERT_EQUAL_UINT32(4, ring.nextSeq());
+    TestRecord rec;
+    TEST_ASSERT_FALSE(ring.read(4, rec));
+    TEST_ASSERT_TRUE(ring.read(3, rec));
+
+    // The torn slot is simply written again
+    appendRecords(ring, 1);
+    TEST_ASSERT_TRUE(ring.read(4, rec));
+    TEST_ASSERT_EQUAL_INT16(4, rec.value);
+}
+
+void test_header_copies_alternate() {
+    RingBuffer<TestRecord> ring;
+    TEST_ASSERT_TRUE(ring.begin(flash, PATH, 10, 1));
+    uint32_t a = headerGeneration(0), b = headerGeneration(1);
+    appendRecords(ring, 1);
+    uint32_t a2 = headerGeneration(0), b2 = headerGeneration(1);
+
+    // Exactly one copy changed, and it is now the newer one
+    TEST_ASSERT_TRUE((a2 != a) != (b2 != b));
+    TEST_ASSERT_EQUAL_UINT32((a > b ? a : b) + 1, a2 > b2 ? a2 : b2);
+
+    // The next checkpoint goes to the other copy
+    bool firstChanged = a2 != a;
+    appendRecords(ring, 1);
+    TEST_ASSERT_EQUAL(firstChanged, headerGeneration(1) != b2);
+    TEST_ASSERT_EQUAL(firstChanged, headerGeneration(0) == a2);
+}
+
+void test_torn_header_falls_back_to_other_copy() {
+    {
+        RingBuffer<TestRecord> ring;
+        TEST_ASSERT_TRUE(ring.begin(flash, PATH, 10, 1));
+        appendRecords(ring, 6);
+    }
+    int newest = headerGeneration(0) > headerGeneration(1) ? 0 : 1;
+    corrupt(newest * sizeof(RingBufferHeader) + offsetof(RingBufferHeader, nextSeq));
+
+    // The older copy is one record behind; the roll-forward finds the rest
+    RingBuffer<TestRecord> ring;
+    TEST_ASSERT_TRUE(ring.begin(flash, PATH, 10, 1));
+    TEST_ASSERT_EQUAL_UINT32(6, ring.nextSeq());
+    TestRecord rec;
+    TEST_ASSERT_TRUE(ring.read(5, rec));
+
+    // With both copies gone the file is recreated empty
+    corrupt(offsetof(RingBufferHeader, crc));
+    corrupt(sizeof(RingBufferHeader) + offsetof(RingBufferHeader, crc));
+    RingBuffer<TestRecord> fresh;
+    TEST_ASSERT_TRUE(fresh.begin(flash, PATH, 10, 1));
+    TEST_ASSERT_EQUAL_UINT32(0, fresh.size());
+}
+
+void test_lower_bound_after_recovery() {
+    // More records than index entries, so lookups go through the sparse index
+    const uint32_t capacity = 100;
+    {
+        RingBuffer<TestRecord> ring;
+        TEST_ASSERT_TRUE(ring.begin(flash, PATH, capacity, 16));
+        appendRecords(ring, 250);
+        TEST_ASSERT_TRUE(ring.indexStride() > 1);
+    }
+    RingBuffer<TestRecord> ring;
+    TEST_ASSERT_TRUE(ring.begin(flash, PATH, capacity, 16));
+    TEST_ASSERT_EQUAL_UINT32(250, ring.nextSeq());
+
+    TEST_ASSERT_EQUAL_UINT32(ring.firstSeq(), ring.lowerBound(0));
+    TEST_ASSERT_EQUAL_UINT32(250, ring.lowerBound(1000 + 250 * 10));
+    for (uint32_t seq = ring.firstSeq(); seq < ring.nextSeq(); ++seq) {
+        TEST_ASSERT_EQUAL_UINT32(seq, ring.lowerBound(1000 + seq * 10));
+        TEST_ASSERT_EQUAL_UINT32(seq + 1, ring.lowerBound(1000 + seq * 10 + 5));
+    }
+
+    // An unreadable record before the checkpoint reads as older than any target
+    corrupt(slotOffset(200 % capacity) + offsetof(TestRecord, timestamp));
+    RingBuffer<TestRecord> damaged;
+    TEST_ASSERT_TRUE(damaged.begin(flash, PATH, capacity, 16));
+    TEST_ASSERT_EQUAL_UINT32(250, damaged.nextSeq());
+    TestRecord rec;
+    TEST_ASSERT_FALSE(damaged.read(200, rec));
+    TEST_ASSERT_EQUAL_UINT32(199, damaged.lowerBound(1000 + 199 * 10));
+    TEST_ASSERT_EQUAL_UINT32(201, firstReadable(damaged, damaged.lowerBound(1000 + 200 * 10)));
+    TEST_ASSERT_EQUAL_UINT32(201, firstReadable(damaged, damaged.lowerBound(1000 + 201 * 10)));
+    TEST_ASSERT_EQUAL_UINT32(202, damaged.lowerBound(1000 + 202 * 10));
+    TEST_ASSERT_EQUAL_UINT32(203, damaged.lowerBound(1000 + 202 * 10 + 5));
+    TEST_ASSERT_EQUAL_UINT32(240, damaged.lowerBound(1000 + 240 * 10));
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_wraps_past_capacity);
+    RUN_TEST(test_rolls_forward_past_last_checkpoint);
+    RUN_TEST(test_torn_last_record_is_dropped);
+    RUN_TEST(test_header_copies_alternate);
+    RUN_TEST(test_torn_header_falls_back_to_other_copy);
+    RUN_TEST(test_lower_bound_after_recovery);
+    return UNITY_END();
+}
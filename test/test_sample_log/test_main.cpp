@@ -0,0 +1,164 @@
+// SampleLog write-back: the open block is patched in place on flash rather than
+// rewritten, and still reads back whole after a soft reset, a power loss, or a reset
+// that tore a patch.
+// Run with: pio test -e test
+
+#include <Arduino.h>
+#include <FS.h>
+#include <unity.h>
+#include <vector>
+#include "SampleLog.h"
+
+static const uint32_t FIRST_TIMESTAMP = 1700000000;
+static const uint32_t INTERVAL = 600;
+static const uint32_t MAX_AGE = 3600;
+static const uint32_t BLOCKS = 8;
+static fs::FS flash;
+static SampleBlock rtcBlock;   // Stands in for RTC_NOINIT_ATTR memory
+
+void setUp() {
+    Serial.quiet = true;
+    flash.clear();
+    memset(&rtcBlock, 0, sizeof(rtcBlock));
+}
+
+void tearDown() {}
+
+static int16_t sample(uint32_t i) { return (int16_t)(1500 + (int)(i * 7919 % 33) - 16); }
+
+static void fill(SampleLog& log, uint32_t from, uint32_t to) {
+    for (uint32_t i = from; i < to; ++i) {
+        TEST_ASSERT_TRUE(log.append(FIRST_TIMESTAMP + i * INTERVAL, sample(i)));
+    }
+}
+
+static void assertSamples(SampleLog& log, uint32_t count) {
+    TEST_ASSERT_EQUAL_UINT32(0, log.firstSeq());
+    TEST_ASSERT_EQUAL_UINT32(count, log.nextSeq());
+    uint32_t expected = 0;
+    log.forEach([&](const LogRecord& rec) {
+        TEST_ASSERT_EQUAL_UINT32(expected, rec.seq);
+        TEST_ASSERT_EQUAL_UINT32(FIRST_TIMESTAMP + expected * INTERVAL, rec.timestamp);
+        TEST_ASSERT_EQUAL_INT16(sample(expected), rec.value);
+        expected++;
+    });
+    TEST_ASSERT_EQUAL_UINT32(count, expected);
+}
+
+void test_write_back_patches_only_new_bytes() {
+    SampleLog log;
+    log.setWriteBack(&rtcBlock, MAX_AGE);
+    TEST_ASSERT_TRUE(log.begin(flash, "/raw", BLOCKS));
+
+    // The first write-back appends the block; the next one, an hour of samples later,
+    // writes the count, those samples' bytes and the crc
+    fill(log, 0, 7);
+    size_t before = flash.bytesWritten;
+    fill(log, 7, 14);
+    size_t written = flash.bytesWritten - before;
+    TEST_ASSERT_TRUE(written > 0);
+    TEST_ASSERT_TRUE(written <= 2 + 7 * SampleLog::MAX_SAMPLE_BYTES + 2);
+}
+
+void test_patched_block_survives_power_loss() {
+    const uint32_t count = 200;   // Spans a full block and a patched open one
+    {
+        SampleLog log;
+        log.setWriteBack(&rtcBlock, MAX_AGE);
+        TEST_ASSERT_TRUE(log.begin(flash, "/raw", BLOCKS));
+        fill(log, 0, count);
+    }
+
+    // Power loss wipes the write-back memory: only what was flushed comes back
+    memset(&rtcBlock, 0, sizeof(rtcBlock));
+    SampleLog log;
+    log.setWriteBack(&rtcBlock, MAX_AGE);
+    TEST_ASSERT_TRUE(log.begin(flash, "/raw", BLOCKS));
+    uint32_t flushed = log.nextSeq();
+    TEST_ASSERT_TRUE(flushed > count - MAX_AGE / INTERVAL - 1);
+    assertSamples(log, flushed);
+
+    // The reopened block keeps being patched, and reads back whole after another reset
+    fill(log, flushed, count + 50);
+    log.flush();
+    memset(&rtcBlock, 0, sizeof(rtcBlock));
+    SampleLog again;
+    again.setWriteBack(&rtcBlock, MAX_AGE);
+    TEST_ASSERT_TRUE(again.begin(flash, "/raw", BLOCKS));
+    assertSamples(again, count + 50);
+}
+
+void test_soft_reset_keeps_unflushed_samples() {
+    const uint32_t count = 150;
+    {
+        SampleLog log;
+        log.setWriteBack(&rtcBlock, MAX_AGE);
+        TEST_ASSERT_TRUE(log.begin(flash, "/raw", BLOCKS));
+        fill(log, 0, count);
+    }
+
+    // The write-back memory survives a soft reset and extends the flash copy
+    SampleLog log;
+    log.setWriteBack(&rtcBlock, MAX_AGE);
+    TEST_ASSERT_TRUE(log.begin(flash, "/raw", BLOCKS));
+    assertSamples(log, count);
+    fill(log, count, count + 20);
+    log.flush();
+
+    memset(&rtcBlock, 0, sizeof(rtcBlock));
+    SampleLog again;
+    again.setWriteBack(&rtcBlock, MAX_AGE);
+    TEST_ASSERT_TRUE(again.begin(flash, "/raw", BLOCKS));
+    assertSamples(again, count + 20);
+}
+
+// Description: The newest block's slot in the ring file, found by its header fields.
+static uint8_t* openSlot(const SampleBlock& open) {
+    std::vector<uint8_t>& file = *flash.raw("/raw");
+    const uint8_t* key = (const uint8_t*)&open + offsetof(SampleBlock, timestamp);
+    size_t keyLength = offsetof(SampleBlock, count) - offsetof(SampleBlock, timestamp);
+    uint8_t* found = nullptr;
+    for (size_t i = 0; i + sizeof(SampleBlock) <= file.size(); ++i) {
+        if (memcmp(&file[i] + offsetof(SampleBlock, timestamp), key, keyLength) == 0) found = &file[i];
+    }
+    return found;
+}
+
+void test_torn_patch_keeps_write_back_samples() {
+    const uint32_t count = 150;
+    {
+        SampleLog log;
+        log.setWriteBack(&rtcBlock, MAX_AGE);
+        TEST_ASSERT_TRUE(log.begin(flash, "/raw", BLOCKS));
+        fill(log, 0, count);
+        log.flush();
+        fill(log, count, count + 3);
+    }
+
+    // A reset in the middle of the next patch: the new count reached flash, the samples
+    // and the crc did not
+    uint8_t* slot = openSlot(rtcBlock);
+    TEST_ASSERT_NOT_NULL(slot);
+    slot[offsetof(SampleBlock, count)] = rtcBlock.count;
+
+    SampleLog log;
+    log.setWriteBack(&rtcBlock, MAX_AGE);
+    TEST_ASSERT_TRUE(log.begin(flash, "/raw", BLOCKS));
+    assertSamples(log, count + 3);
+
+    // The slot was rewritten whole, so the samples survive a power loss too
+    memset(&rtcBlock, 0, sizeof(rtcBlock));
+    SampleLog again;
+    again.setWriteBack(&rtcBlock, MAX_AGE);
+    TEST_ASSERT_TRUE(again.begin(flash, "/raw", BLOCKS));
+    assertSamples(again, count + 3);
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_write_back_patches_only_new_bytes);
+    RUN_TEST(test_patched_block_survives_power_loss);
+    RUN_TEST(test_soft_reset_keeps_unflushed_samples);
+    RUN_TEST(test_torn_patch_keeps_write_back_samples);
+    return UNITY_END();
+}
@@ -0,0 +1,91 @@
+// SensorHistory rollup tiers after a reboot: open windows, and closed windows lost to a
+// torn write, are rebuilt from the raw log. Run with: pio test -e test
+
+#include <Arduino.h>
+#include <FS.h>
+#include <unity.h>
+#include "SensorHistory.h"
+
+static const RollupTierConfig TIERS[ROLLUP_TIER_COUNT] = {
+    {600, 100, "10m"},
+    {3600, 100, "1h"},
+    {86400, 30, "1d"},
+};
+static const uint32_t FIRST_TIMESTAMP = 1699999800;   // On a 10-minute boundary
+static const uint32_t STEP = 300;                     // Two samples per 10-minute window
+static fs::FS flash;
+
+void setUp() {
+    Serial.quiet = true;
+    flash.clear();
+}
+
+void tearDown() {}
+
+static void fill(SensorHistory& history, uint32_t samples) {
+    for (uint32_t i = 0; i < samples; ++i) {
+        TEST_ASSERT_TRUE(history.append(FIRST_TIMESTAMP + i * STEP, (int16_t)(1000 + i % 50)));
+    }
+}
+
+// Every 10-minute window is present, in order, with both of its samples
+static void assertWindowsComplete(SensorHistory& history, uint32_t lastWindow) {
+    uint32_t expected = 0;
+    uint32_t windows = 0;
+    history.tier(0).forEach([&](const RollupRecord& rec) {
+        if (expected != 0) TEST_ASSERT_EQUAL_UINT32(expected, rec.timestamp);
+        TEST_ASSERT_EQUAL_UINT32(2, rec.count);
+        expected = rec.timestamp + 600;
+        windows++;
+    });
+    TEST_ASSERT_EQUAL_UINT32(history.tier(0).size(), windows);
+    TEST_ASSERT_EQUAL_UINT32(lastWindow + 600, expected);
+}
+
+void test_open_windows_survive_a_reboot() {
+    {
+        SensorHistory history;
+        TEST_ASSERT_TRUE(history.begin(flash, "/s", 20, TIERS));
+        fill(history, 500);
+    }
+    SensorHistory history;
+    TEST_ASSERT_TRUE(history.begin(flash, "/s", 20, TIERS));
+    uint32_t newest = FIRST_TIMESTAMP + 499 * STEP;
+    assertWindowsComplete(history, newest - newest % 600 - 600);
+
+    // The open hour holds the 10-minute windows written since it started
+    uint32_t hourSamples = 0;
+    history.forEachRollup(1, newest - newest % 3600, newest, [&](const RollupRecord& rec) { hourSamples += rec.count; });
+    TEST_ASSERT_EQUAL_UINT32((newest % 3600) / STEP + 1, hourSamples);
+}
+
+void test_torn_window_is_rebuilt_from_raw_log() {
+    {
+        SensorHistory history;
+        TEST_ASSERT_TRUE(history.begin(flash, "/s", 20, TIERS));
+        fill(history, 500);
+        TEST_ASSERT_EQUAL_UINT32(249, history.tier(0).nextSeq());
+    }
+    // Tear the newest 10-minute record, written after the tier's last checkpoint
+    std::vector<uint8_t>* bytes = flash.raw("/s.10m");
+    TEST_ASSERT_NOT_NULL(bytes);
+    (*bytes)[2 * sizeof(RingBufferHeader) + (248 % 100) * sizeof(RollupRecord) + offsetof(RollupRecord, sum)] ^= 0xFF;
+
+    SensorHistory history;
+    TEST_ASSERT_TRUE(history.begin(flash, "/s", 20, TIERS));
+    TEST_ASSERT_EQUAL_UINT32(249, history.tier(0).nextSeq());
+    uint32_t newest = FIRST_TIMESTAMP + 499 * STEP;
+    assertWindowsComplete(history, newest - newest % 600 - 600);
+
+    // Appending carries on from there
+    history.append(newest + STEP, 1000);
+    history.append(newest + 2 * STEP, 1000);
+    TEST_ASSERT_EQUAL_UINT32(250, history.tier(0).nextSeq());
+}
+
+int main(int argc, char** argv) {
+    UNITY_BEGIN();
+    RUN_TEST(test_open_windows_survive_a_reboot);
+    RUN_TEST(test_torn_window_is_rebuilt_from_raw_log);
+    return UNITY_END();
+}